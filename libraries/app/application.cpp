@@ -10,6 +10,7 @@
 #include <graphene/chain/db_with.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <graphene/protocol/transaction.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/egenesis/egenesis.hpp>
@@ -488,7 +489,51 @@ void application_impl::open_chain_database() const
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
-   if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
+   if( _options->count("block-log-chunk-size") > 0 )
+      _chain_db->enable_block_log_compression( _options->at("block-log-chunk-size").as<uint32_t>() );
+
+   if( _options->count("memory-usage-log-interval") > 0 )
+      _chain_db->set_memory_usage_log_interval( _options->at("memory-usage-log-interval").as<uint32_t>() );
+
+   if( _options->count("reindex-queue-depth") > 0 || _options->count("reindex-threads") > 0 )
+      _chain_db->set_reindex_pipeline( _options->at("reindex-queue-depth").as<uint32_t>(),
+                                       _options->at("reindex-threads").as<uint32_t>() );
+
+   const uint32_t state_hash_log_interval = _options->count("state-hash-log-interval") > 0 ?
+                                            _options->at("state-hash-log-interval").as<uint32_t>() : 0;
+   if( state_hash_log_interval > 0
+         || ( _options->count("track-state-hash") > 0 && _options->at("track-state-hash").as<bool>() ) )
+      _chain_db->track_state_hash( state_hash_log_interval );
+
+   if( _options->count("optimistic-execution") > 0 )
+      _chain_db->enable_optimistic_execution( _options->at("optimistic-execution").as<bool>() );
+
+   if( _options->count("mempool-max-size") > 0 || _options->count("mempool-max-per-account") > 0 )
+      _chain_db->set_mempool_limits( uint64_t( _options->at("mempool-max-size").as<uint32_t>() ) * 1024 * 1024,
+                                     _options->at("mempool-max-per-account").as<uint32_t>() );
+
+   if( _options->count("signature-cache-size") > 0 )
+      graphene::protocol::set_recovered_key_cache_size( _options->at("signature-cache-size").as<uint32_t>() );
+
+   if( _options->count("authority-cache-size") > 0 )
+      _chain_db->set_authority_cache_size( _options->at("authority-cache-size").as<uint32_t>() );
+
+   if( _options->count("fork-switch-reuse-changes") > 0 )
+      _chain_db->enable_fork_change_reuse( _options->at("fork-switch-reuse-changes").as<bool>() );
+
+   if( _options->count("state-snapshot-interval") > 0 && _options->at("state-snapshot-interval").as<uint32_t>() > 0 )
+   {
+      fc::path snapshot_dir = _options->at("state-snapshot-dir").as<boost::filesystem::path>();
+      if( snapshot_dir.is_relative() )
+         snapshot_dir = _data_dir / snapshot_dir;
+      _chain_db->set_state_snapshots( snapshot_dir, _options->at("state-snapshot-interval").as<uint32_t>() );
+   }
+
+   if( _options->count("load-state-snapshot") > 0 )
+      _chain_db->load_state_snapshot( _options->at("load-state-snapshot").as<boost::filesystem::path>(),
+                                      _data_dir / "blockchain", initialize_genesis_state().compute_chain_id(),
+                                      GRAPHENE_CURRENT_DB_VERSION );
+   else if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
    try
@@ -1141,6 +1186,42 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("block-log-chunk-size", bpo::value<uint32_t>()->default_value(0),
+          "Number of blocks per compressed chunk when creating a new block log, 0 for the uncompressed format. "
+          "Existing block logs keep their format, convert them with the compress_block_log tool.")
+         ("memory-usage-log-interval", bpo::value<uint32_t>()->default_value(28800),
+          "Number of blocks between log lines with the memory used by the object database, 0 to disable")
+         ("reindex-queue-depth", bpo::value<uint32_t>()->default_value(256),
+          "Number of blocks read and decoded ahead of the block being applied during replay")
+         ("reindex-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads decoding blocks during replay, 0 for one less than the number of hardware threads")
+         ("track-state-hash", bpo::value<bool>()->default_value(false),
+          "Maintain a hash of the chain state after every block, see the get_state_hash database API")
+         ("state-hash-log-interval", bpo::value<uint32_t>()->default_value(0),
+          "Number of blocks between log lines with the state hash, 0 to disable. Enables track-state-hash")
+         ("optimistic-execution", bpo::value<bool>()->default_value(false),
+          "Experimental: verify the authorities of non-conflicting transactions of a block in parallel "
+          "ahead of applying it")
+         ("mempool-max-size", bpo::value<uint32_t>()->default_value(64),
+          "Maximum total size of pending transactions in MiB, 0 for no limit. When full, new transactions evict "
+          "the ones paying the lowest fee per byte")
+         ("mempool-max-per-account", bpo::value<uint32_t>()->default_value(0),
+          "Maximum number of pending transactions paid for by one account, 0 for no limit")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(65536),
+          "Number of recovered signature keys to remember, so that transactions seen before in the mempool "
+          "are not recovered again when they arrive in a block. 0 to disable")
+         ("authority-cache-size", bpo::value<uint32_t>()->default_value(65536),
+          "Number of authority verifications of pending transactions to remember, so that they are not verified "
+          "again when the transactions arrive in a block. 0 to disable")
+         ("fork-switch-reuse-changes", bpo::value<bool>()->default_value(false),
+          "Record the state changes of reversible blocks, so that switching back to their branch after a fork switch "
+          "does not execute them again. Costs memory for a copy of the objects each reversible block modified")
+         ("state-snapshot-interval", bpo::value<uint32_t>()->default_value(0),
+          "Write a binary state snapshot whenever the last irreversible block passes a multiple of this number, "
+          "0 to disable. Block processing pauses while the state is copied to memory, the file is written in the "
+          "background")
+         ("state-snapshot-dir", bpo::value<boost::filesystem::path>()->default_value("snapshots"),
+          "Directory for state snapshots, relative to the data directory unless absolute")
          ("api-limit-get-account-history-operations",
           bpo::value<uint64_t>()->default_value(default_opts.api_limit_get_account_history_operations),
           "For history_api::get_account_history_operations to set max limit value")
@@ -1240,6 +1321,8 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("replay-blockchain", "Rebuild object graph by replaying all blocks without validation")
          ("revalidate-blockchain", "Rebuild object graph by replaying all blocks with full validation")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
+         ("load-state-snapshot", bpo::value<boost::filesystem::path>(),
+          "Replace the database with a state snapshot and continue syncing from the block after it")
          ("force-validate", "Force validation of all transactions during normal operation")
          ("genesis-timestamp", bpo::value<uint32_t>(),
           "Replace timestamp from genesis.json with current time plus this many seconds (experts only!)")
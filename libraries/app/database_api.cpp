@@ -463,6 +463,26 @@ witness_schedule_object database_api_impl::get_witness_schedule()const
    return _db.get_witness_schedule_object();
 }
 
+graphene::db::database_memory_usage database_api::get_memory_usage()const
+{
+   return my->get_memory_usage();
+}
+
+graphene::db::database_memory_usage database_api_impl::get_memory_usage()const
+{
+   return _db.get_memory_usage();
+}
+
+block_state_hash database_api::get_state_hash()const
+{
+   return my->get_state_hash();
+}
+
+block_state_hash database_api_impl::get_state_hash()const
+{
+   return _db.get_block_state_hash();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Keys                                                             //
@@ -1871,31 +1891,37 @@ order_book database_api_impl::get_order_book( const string& base, const string&
 
    auto base_id = assets[0]->id;
    auto quote_id = assets[1]->id;
-   auto orders = get_limit_orders( base_id, quote_id, limit );
+   const limit_order_book_index& book = _db.get_limit_order_book();
+
+   result.bids.reserve( limit );
+   unsigned count = 0;
+   book.visit_side( base_id, quote_id, [&]( const limit_order_object& o ) {
+      if( count++ >= limit )
+         return false;
+      order ord;
+      ord.price = price_to_string( o.sell_price, *assets[0], *assets[1] );
+      ord.quote = assets[1]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
+                                                           * o.sell_price.quote.amount.value
+                                                           / o.sell_price.base.amount.value ) );
+      ord.base = assets[0]->amount_to_string( o.for_sale );
+      result.bids.push_back( ord );
+      return true;
+   });
 
-   for( const auto& o : orders )
-   {
-      if( o.sell_price.base.asset_id == base_id )
-      {
-         order ord;
-         ord.price = price_to_string( o.sell_price, *assets[0], *assets[1] );
-         ord.quote = assets[1]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
-                                                              * o.sell_price.quote.amount.value
-                                                              / o.sell_price.base.amount.value ) );
-         ord.base = assets[0]->amount_to_string( o.for_sale );
-         result.bids.push_back( ord );
-      }
-      else
-      {
-         order ord;
-         ord.price = price_to_string( o.sell_price, *assets[0], *assets[1] );
-         ord.quote = assets[1]->amount_to_string( o.for_sale );
-         ord.base = assets[0]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
-                                                             * o.sell_price.quote.amount.value
-                                                             / o.sell_price.base.amount.value ) );
-         result.asks.push_back( ord );
-      }
-   }
+   result.asks.reserve( limit );
+   count = 0;
+   book.visit_side( quote_id, base_id, [&]( const limit_order_object& o ) {
+      if( count++ >= limit )
+         return false;
+      order ord;
+      ord.price = price_to_string( o.sell_price, *assets[0], *assets[1] );
+      ord.quote = assets[1]->amount_to_string( o.for_sale );
+      ord.base = assets[0]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
+                                                          * o.sell_price.quote.amount.value
+                                                          / o.sell_price.base.amount.value ) );
+      result.asks.push_back( ord );
+      return true;
+   });
 
    return result;
 }
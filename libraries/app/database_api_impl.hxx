@@ -44,6 +44,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       chain_id_type get_chain_id()const;
       dynamic_global_property_object get_dynamic_global_properties()const;
       witness_schedule_object get_witness_schedule()const;
+      graphene::db::database_memory_usage get_memory_usage()const;
+      block_state_hash get_state_hash()const;
 
       // Keys
       vector<flat_set<account_id_type>> get_key_references( vector<public_key_type> key )const;
@@ -247,6 +247,20 @@ class database_api
        */
       witness_schedule_object get_witness_schedule()const;
 
+      /**
+       * @brief Get the object count and approximate memory usage of every index and of the undo history
+       * @return the memory usage report, memory owned by members of objects (strings, vectors) is not included
+       */
+      graphene::db::database_memory_usage get_memory_usage()const;
+
+      /**
+       * @brief Get the hash of the chain state as of the head block, to compare the state of nodes
+       * @return the block number and id, the hash and the digests of the single indexes it is made of
+       *
+       * The node must be started with track-state-hash. Pending transactions are not included.
+       */
+      block_state_hash get_state_hash()const;
+
       //////////
       // Keys //
       //////////
@@ -1547,6 +1561,8 @@ FC_API(graphene::app::database_api,
    (get_chain_id)
    (get_dynamic_global_properties)
    (get_witness_schedule)
+   (get_memory_usage)
+   (get_state_hash)
 
    // Keys
    (get_key_references)
@@ -294,6 +294,12 @@ const account_balance_object* balances_by_account_index::get_account_balance( co
 }
 
 } } // graphene::chain
+GRAPHENE_IMPLEMENT_FIELD_UNDO( graphene::chain::account_balance_object )
+GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS( graphene::chain::account_statistics_object,
+                                   (total_core_inactive)(total_core_pob)(total_core_pol)
+                                   (total_pob_value)(total_pol_value) )
+GRAPHENE_IMPLEMENT_FIELD_UNDO( graphene::chain::account_statistics_object )
+
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_object )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_balance_object )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_statistics_object )
@@ -366,6 +366,8 @@ string asset_object::amount_to_string(share_type amount) const
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::asset_dynamic_data_object, (graphene::db::object),
                     (current_supply)(accumulated_fees)(accumulated_collateral_fees)(fee_pool) )
+GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS( graphene::chain::asset_dynamic_data_object, (sweeps_tickets_sold) )
+GRAPHENE_IMPLEMENT_FIELD_UNDO( graphene::chain::asset_dynamic_data_object )
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::asset_bitasset_data_object, (graphene::db::object),
                     (asset_id)
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/authority_cache.hpp>
+
+namespace graphene { namespace chain {
+
+void authority_cache::set_max_size( size_t max_size )
+{
+   _max_size = max_size;
+   while( _entries.size() > _max_size )
+      _entries.pop_back();
+}
+
+void authority_cache::insert( const signed_transaction& trx, const block_id_type& head_block,
+                              flat_set<account_id_type> consulted )
+{
+   if( !enabled() )
+      return;
+   authority_cache_entry entry;
+   entry.trx_id = trx.id();
+   entry.signatures_digest = digest_type::hash( trx.signatures );
+   entry.head_block = head_block;
+   entry.consulted = std::move( consulted );
+
+   auto& by_id = _entries.get<by_trx_id>();
+   auto itr = by_id.find( entry.trx_id );
+   if( itr != by_id.end() )
+   {
+      by_id.replace( itr, std::move(entry) );
+      _entries.relocate( _entries.begin(), _entries.project<0>( itr ) );
+   }
+   else
+   {
+      _entries.push_front( std::move(entry) );
+      if( _entries.size() > _max_size )
+         _entries.pop_back();
+   }
+}
+
+const authority_cache_entry* authority_cache::find( const signed_transaction& trx, const block_id_type& head_block )
+{
+   auto& by_id = _entries.get<by_trx_id>();
+   auto itr = by_id.find( trx.id() );
+   if( itr == by_id.end() )
+   {
+      ++_misses;
+      return nullptr;
+   }
+   if( itr->head_block != head_block || itr->signatures_digest != digest_type::hash( trx.signatures ) )
+   {
+      // verified on another state or with other signatures, it will not be of use again
+      by_id.erase( itr );
+      ++_misses;
+      return nullptr;
+   }
+   ++_hits;
+   _entries.relocate( _entries.begin(), _entries.project<0>( itr ) );
+   return &*itr;
+}
+
+void authority_cache::remove( const transaction_id_type& trx_id )
+{
+   _entries.get<by_trx_id>().erase( trx_id );
+}
+
+void authority_cache::clear()
+{
+   _entries.clear();
+}
+
+authority_cache_stats authority_cache::get_stats()const
+{
+   authority_cache_stats result;
+   result.size = _entries.size();
+   result.hits = _hits;
+   result.misses = _misses;
+   return result;
+}
+
+} } // graphene::chain
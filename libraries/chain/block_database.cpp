@@ -22,9 +22,12 @@
  * THE SOFTWARE.
  */
 #include <graphene/chain/block_database.hpp>
+#include <graphene/chain/chunked_block_log.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/io/datastream.hpp>
 #include <boost/endian/buffers.hpp>
+#include <cstring>
 
 namespace graphene { namespace chain {
 
@@ -43,42 +46,154 @@ FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
 namespace graphene { namespace chain {
 
+void mapped_block_file::map( const fc::path& filename )
+{
+   unmap();
+   const size_t file_size = fc::file_size( filename );
+   if( file_size == 0 )
+      return; // an empty file can not be mapped
+   _file.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_only ) );
+   _region.reset( new fc::mapped_region( *_file, fc::read_only, 0, file_size ) );
+   _data = (const char*)_region->get_address();
+   _size = _region->get_size();
+}
+
+void mapped_block_file::unmap()
+{
+   _region.reset();
+   _file.reset();
+   _data = nullptr;
+   _size = 0;
+}
+
+block_database::block_database() {}
+block_database::~block_database() {}
+
 void block_database::open( const fc::path& dbdir )
 { try {
+   if( chunked_block_log::exists( dbdir ) || ( _blocks_per_chunk > 0 && !fc::exists( dbdir / "index" ) ) )
+   {
+      _chunked.reset( new chunked_block_log() );
+      _chunked->open( dbdir, _blocks_per_chunk > 0 ? _blocks_per_chunk : chunked_block_log::default_blocks_per_chunk );
+      return;
+   }
+   if( _blocks_per_chunk > 0 )
+      wlog( "Block database in ${d} is not compressed, convert it with compress_block_log", ("d", dbdir) );
+
    fc::create_directories(dbdir);
    _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
+
+   std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
+   _index_file_size = fc::file_size( _index_filename );
+   _blocks_file_size = fc::file_size( _blocks_filename );
+   _last_read_position = 0;
+   remap();
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
 bool block_database::is_open()const
 {
+  if( _chunked )
+     return _chunked->is_open();
   return _blocks.is_open();
 }
 
 void block_database::close()
 {
+  if( _chunked )
+  {
+     _chunked->close();
+     _chunked.reset();
+     return;
+  }
+  std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
+  _index_map.unmap();
+  _blocks_map.unmap();
   _blocks.close();
   _block_num_to_pos.close();
+  _index_file_size = 0;
+  _blocks_file_size = 0;
 }
 
 void block_database::flush()
 {
+  if( _chunked )
+     return _chunked->flush();
+  std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
   _blocks.flush();
   _block_num_to_pos.flush();
 }
 
+void block_database::remap()const
+{
+   _index_map.map( _index_filename );
+   _blocks_map.map( _blocks_filename );
+}
+
+bool block_database::ensure_mapped( std::shared_lock<std::shared_timed_mutex>& lock,
+                                    size_t index_size, size_t blocks_size )const
+{
+   if( _index_map.size() >= index_size && _blocks_map.size() >= blocks_size )
+      return true;
+   if( _index_file_size < index_size || _blocks_file_size < blocks_size )
+      return false;
+
+   lock.unlock();
+   {
+      std::unique_lock<std::shared_timed_mutex> exclusive( _map_mutex );
+      // another reader may have remapped in the meantime
+      if( _index_map.size() < index_size || _blocks_map.size() < blocks_size )
+         remap();
+   }
+   lock.lock();
+   return _index_map.size() >= index_size && _blocks_map.size() >= blocks_size;
+}
+
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e )const
+{
+   const size_t index_pos = sizeof(e) * size_t(block_num);
+   if( _index_map.size() < index_pos + sizeof(e) )
+      return false;
+   memcpy( (char*)&e, _index_map.data() + index_pos, sizeof(e) );
+   return true;
+}
+
+optional<signed_block> block_database::read_block( const index_entry& e )const
+{
+   const size_t block_end = e.block_pos.value() + e.block_size.value();
+   FC_ASSERT( block_end <= _blocks_map.size(), "Block ${id} is beyond the end of the block database",
+              ("id", e.block_id) );
+   fc::datastream<const char*> ds( _blocks_map.data() + e.block_pos.value(), e.block_size.value() );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.id() == e.block_id );
+   _last_read_position = block_end;
+   return result;
+}
+
+optional<packed_block> block_database::read_packed_block( const index_entry& e )const
+{
+   const size_t block_end = e.block_pos.value() + e.block_size.value();
+   FC_ASSERT( block_end <= _blocks_map.size(), "Block ${id} is beyond the end of the block database",
+              ("id", e.block_id) );
+   const char* data = _blocks_map.data() + e.block_pos.value();
+   _last_read_position = block_end;
+   return packed_block{ e.block_id, vector<char>( data, data + e.block_size.value() ) };
+}
+
 void block_database::store( const block_id_type& _id, const signed_block& b )
 {
    if (true == replay_mode){
@@ -90,33 +205,50 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
-   _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
-   index_entry e;
-   _blocks.seekp( 0, _blocks.end );
+   if( _chunked )
+      return _chunked->store( id, b );
    auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+
+   std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
+   const size_t index_pos = sizeof( index_entry ) * size_t(block_header::num_from_id(id));
+   index_entry e;
+   e.block_pos  = _blocks_file_size.load();
    e.block_size = vec.size();
    e.block_id   = id;
+   _blocks.seekp( e.block_pos.value() );
    _blocks.write( vec.data(), vec.size() );
+   _block_num_to_pos.seekp( index_pos );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   // make the new data visible to the mappings, they pick it up on the next out of range read
+   _blocks.flush();
+   _block_num_to_pos.flush();
+   _blocks_file_size += vec.size();
+   if( _index_file_size < index_pos + sizeof(e) )
+      _index_file_size = index_pos + sizeof(e);
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
+   if( _chunked )
+      return _chunked->remove( id );
+   std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   const uint32_t block_num = block_header::num_from_id(id);
+   const size_t index_pos = sizeof(e) * size_t(block_num);
+   if ( _index_file_size <= index_pos )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   if( _index_map.size() < index_pos + sizeof(e) )
+      remap();
+   FC_ASSERT( read_index_entry( block_num, e ) );
 
    if( e.block_id == id )
    {
       e.block_size = 0;
-      _block_num_to_pos.seekp( sizeof(e) * int64_t(block_header::num_from_id(id)) );
+      // the mapping is shared with the file, so the flushed write is visible to readers right away
+      _block_num_to_pos.seekp( index_pos );
       _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      _block_num_to_pos.flush();
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -124,14 +256,16 @@ bool block_database::contains( const block_id_type& id )const
 {
    if( id == block_id_type() )
       return false;
+   if( _chunked )
+      return _chunked->contains( id );
 
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
+   const uint32_t block_num = block_header::num_from_id(id);
+   std::shared_lock<std::shared_timed_mutex> lock( _map_mutex );
+   if( !ensure_mapped( lock, sizeof(e) * size_t(block_num + 1), 0 ) )
+      return false;
+   if( !read_index_entry( block_num, e ) )
       return false;
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
    return e.block_id == id && e.block_size.value() > 0;
 }
@@ -139,41 +273,34 @@ bool block_database::contains( const block_id_type& id )const
 block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
+   if( _chunked )
+      return _chunked->fetch_block_id( block_num );
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_num);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   std::shared_lock<std::shared_timed_mutex> lock( _map_mutex );
+   if( !ensure_mapped( lock, sizeof(e) * size_t(block_num + 1), 0 ) || !read_index_entry( block_num, e ) )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
    return e.block_id;
 }
 
 optional<signed_block> block_database::fetch_optional( const block_id_type& id )const
 {
+   if( _chunked )
+      return _chunked->fetch_optional( id );
    try
    {
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      const uint32_t block_num = block_header::num_from_id(id);
+      std::shared_lock<std::shared_timed_mutex> lock( _map_mutex );
+      if( !ensure_mapped( lock, sizeof(e) * size_t(block_num + 1), 0 ) || !read_index_entry( block_num, e ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      if (e.block_size.value())
-         _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      if( !ensure_mapped( lock, 0, e.block_pos.value() + e.block_size.value() ) )
+         return {};
+      return read_block( e );
    }
    catch (const fc::exception&)
    {
@@ -186,23 +313,18 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 
 optional<signed_block> block_database::fetch_by_number( uint32_t block_num )const
 {
+   if( _chunked )
+      return _chunked->fetch_by_number( block_num );
    try
    {
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_num);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      std::shared_lock<std::shared_timed_mutex> lock( _map_mutex );
+      if( !ensure_mapped( lock, sizeof(e) * size_t(block_num + 1), 0 ) || !read_index_entry( block_num, e ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      if( !ensure_mapped( lock, 0, e.block_pos.value() + e.block_size.value() ) )
+         return {};
+      return read_block( e );
    }
    catch (const fc::exception&)
    {
@@ -213,37 +335,60 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
-optional<index_entry> block_database::last_index_entry()const {
+optional<packed_block> block_database::fetch_packed_by_number( uint32_t block_num )const
+{
+   if( _chunked )
+      return _chunked->fetch_packed_by_number( block_num );
    try
    {
       index_entry e;
+      std::shared_lock<std::shared_timed_mutex> lock( _map_mutex );
+      if( !ensure_mapped( lock, sizeof(e) * size_t(block_num + 1), 0 ) || !read_index_entry( block_num, e ) )
+         return {};
+      // removed blocks keep their index entry with a size of 0
+      if( e.block_size == 0 )
+         return {};
+
+      if( !ensure_mapped( lock, 0, e.block_pos.value() + e.block_size.value() ) )
+         return {};
+      return read_packed_block( e );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<packed_block>();
+}
 
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      std::streampos pos = _block_num_to_pos.tellg();
-      if( pos < long(sizeof(index_entry)) )
-         return optional<index_entry>();
+optional<index_entry> block_database::last_index_entry()const {
+   try
+   {
+      std::unique_lock<std::shared_timed_mutex> lock( _map_mutex );
+      remap();
 
+      index_entry e;
+      size_t pos = _index_map.size();
       pos -= pos % sizeof(index_entry);
+      const size_t index_size = pos;
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
+      optional<index_entry> result;
       while( pos > 0 )
       {
          pos -= sizeof(index_entry);
-         _block_num_to_pos.seekg( pos );
-         _block_num_to_pos.read( (char*)&e, sizeof(e) );
-         if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size.value() > 0
-                && int64_t(e.block_pos.value() + e.block_size.value()) <= blocks_size )
+         memcpy( (char*)&e, _index_map.data() + pos, sizeof(e) );
+         if( e.block_size.value() > 0 && e.block_pos.value() + e.block_size.value() <= _blocks_map.size() )
             try
             {
-               vector<char> data( e.block_size.value() );
-               _blocks.seekg( e.block_pos.value() );
-               _blocks.read( data.data(), e.block_size.value() );
-               if( _blocks.gcount() == long(e.block_size.value()) )
+               fc::datastream<const char*> ds( _blocks_map.data() + e.block_pos.value(), e.block_size.value() );
+               signed_block block;
+               fc::raw::unpack( ds, block );
+               if( block.id() == e.block_id )
                {
-                  const signed_block block = fc::raw::unpack<signed_block>(data);
-                  if( block.id() == e.block_id )
-                     return e;
+                  result = e;
+                  pos += sizeof(index_entry);
+                  break;
                }
             }
             catch (const fc::exception&)
@@ -252,8 +397,18 @@ optional<index_entry> block_database::last_index_entry()const {
             catch (const std::exception&)
             {
             }
+      }
+
+      if( pos < index_size )
+      {
+         // drop the invalid tail, the mapping must be released before the file shrinks underneath it
+         _index_map.unmap();
+         _block_num_to_pos.flush();
          fc::resize_file( _index_filename, pos );
+         _index_file_size = pos;
+         _index_map.map( _index_filename );
       }
+      return result;
    }
    catch (const fc::exception&)
    {
@@ -266,6 +421,12 @@ optional<index_entry> block_database::last_index_entry()const {
 
 optional<signed_block> block_database::last()const
 {
+   if( _chunked )
+   {
+      optional<block_id_type> id = _chunked->last_id();
+      if( id.valid() ) return _chunked->fetch_optional( *id );
+      return optional<signed_block>();
+   }
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return fetch_by_number( block_header::num_from_id(entry->block_id) );
    return optional<signed_block>();
@@ -273,6 +434,8 @@ optional<signed_block> block_database::last()const
 
 optional<block_id_type> block_database::last_id()const
 {
+   if( _chunked )
+      return _chunked->last_id();
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return entry->block_id;
    return optional<block_id_type>();
@@ -280,13 +443,22 @@ optional<block_id_type> block_database::last_id()const
 
 size_t block_database::blocks_current_position()const
 {
-   return (size_t)_blocks.tellg();
+   if( _chunked )
+      return _chunked->blocks_current_position();
+   return _last_read_position;
 }
 
 size_t block_database::total_block_size()const
 {
-   _blocks.seekg( 0, _blocks.end );
-   return (size_t)_blocks.tellg();
+   if( _chunked )
+      return _chunked->total_block_size();
+   return _blocks_file_size;
+}
+
+void block_database::set_last_irreversible_block( uint32_t block_num )
+{
+   if( _chunked )
+      _chunked->set_last_irreversible_block( block_num );
 }
 
 void block_database::set_replay_mode(bool mode)
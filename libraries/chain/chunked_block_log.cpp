@@ -0,0 +1,737 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/chunked_block_log.hpp>
+#include <graphene/chain/config.hpp>
+#include <graphene/protocol/fee_schedule.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/io/datastream.hpp>
+
+#include <boost/endian/buffers.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+const uint32_t chunk_log_magic   = 0x4b434247; // "GBCK"
+const uint32_t chunk_log_version = 1;
+const size_t   max_cached_chunks = 8;
+
+struct chunk_log_header
+{
+   boost::endian::little_uint32_buf_t magic;
+   boost::endian::little_uint32_buf_t version;
+   boost::endian::little_uint32_buf_t blocks_per_chunk;
+   boost::endian::little_uint32_buf_t reserved;
+};
+
+/** Record in chunk_index, one per chunk. A chunk without blocks has data_size == 0 */
+struct chunk_index_entry
+{
+   chunk_index_entry() {
+      table_pos = 0;
+      data_size = 0;
+      raw_size = 0;
+      codec = uint8_t(block_chunk_codec::none);
+   }
+   boost::endian::little_uint64_buf_t table_pos;
+   boost::endian::little_uint32_buf_t data_size;
+   boost::endian::little_uint32_buf_t raw_size;
+   uint8_t                            codec;
+   uint8_t                            reserved[3] = { 0, 0, 0 };
+};
+
+/** Entry of the table in front of every chunk, one per block number. Missing blocks have size == 0 */
+struct chunk_block_entry
+{
+   chunk_block_entry() {
+      offset = 0;
+      size = 0;
+   }
+   block_id_type                      block_id;
+   boost::endian::little_uint32_buf_t offset;
+   boost::endian::little_uint32_buf_t size;
+};
+
+/** Header of a record in the tail file. A record with size == 0 marks the block as removed */
+struct tail_record_header
+{
+   tail_record_header() {
+      size = 0;
+   }
+   block_id_type                      block_id;
+   boost::endian::little_uint32_buf_t size;
+};
+
+vector<char> zlib_deflate( const vector<char>& in )
+{
+   vector<char> out;
+   boost::iostreams::filtering_ostream os;
+   os.push( boost::iostreams::zlib_compressor( boost::iostreams::zlib::default_compression ) );
+   os.push( boost::iostreams::back_inserter( out ) );
+   os.write( in.data(), in.size() );
+   os.reset(); // flushes the compressor into out
+   return out;
+}
+
+void zlib_inflate( const char* in, size_t size, vector<char>& out )
+{
+   boost::iostreams::filtering_istream is;
+   is.push( boost::iostreams::zlib_decompressor() );
+   is.push( boost::iostreams::array_source( in, size ) );
+   boost::iostreams::copy( is, boost::iostreams::back_inserter( out ) );
+}
+
+void open_stream( std::fstream& stream, const fc::path& filename )
+{
+   stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   auto mode = std::fstream::binary | std::fstream::in | std::fstream::out;
+   if( !fc::exists( filename ) )
+      mode |= std::fstream::trunc;
+   stream.open( filename.generic_string().c_str(), mode );
+}
+
+} // anonymous namespace
+
+bool chunked_block_log::exists( const fc::path& dbdir )
+{
+   return fc::exists( dbdir / "chunk_index" );
+}
+
+void chunked_block_log::open( const fc::path& dbdir, uint32_t blocks_per_chunk )
+{ try {
+   fc::create_directories(dbdir);
+   _dbdir = dbdir;
+   const bool is_new = !exists( dbdir );
+
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   open_stream( _chunk_index, dbdir / "chunk_index" );
+   open_stream( _chunks, dbdir / "chunks" );
+   open_stream( _tail, dbdir / "tail" );
+
+   std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+   if( is_new )
+   {
+      FC_ASSERT( blocks_per_chunk > 0, "Chunk size of the block log must not be zero" );
+      chunk_log_header header;
+      header.magic = chunk_log_magic;
+      header.version = chunk_log_version;
+      header.blocks_per_chunk = blocks_per_chunk;
+      header.reserved = 0;
+      _chunk_index.write( (const char*)&header, sizeof(header) );
+      _chunk_index.flush();
+   }
+
+   _chunk_index_file_size = fc::file_size( dbdir / "chunk_index" );
+   _chunks_file_size = fc::file_size( dbdir / "chunks" );
+   _tail_file_size = fc::file_size( dbdir / "tail" );
+   remap();
+
+   FC_ASSERT( _chunk_index_map.size() >= sizeof(chunk_log_header), "Chunk index of the block log is truncated" );
+   chunk_log_header header;
+   memcpy( (char*)&header, _chunk_index_map.data(), sizeof(header) );
+   FC_ASSERT( header.magic.value() == chunk_log_magic && header.version.value() == chunk_log_version,
+              "Unsupported block log format" );
+   _blocks_per_chunk = header.blocks_per_chunk.value();
+   FC_ASSERT( _blocks_per_chunk > 0, "Chunk size of the block log must not be zero" );
+
+   // drop a partially written index record and the data of a chunk that was not indexed before a crash
+   const uint64_t index_size = sizeof(chunk_log_header) + sealed_chunks() * sizeof(chunk_index_entry);
+   uint64_t chunks_size = 0;
+   for( uint64_t c = sealed_chunks(); c > 0 && chunks_size == 0; --c )
+   {
+      chunk_index_entry e;
+      memcpy( (char*)&e, _chunk_index_map.data() + sizeof(chunk_log_header) + (c-1) * sizeof(e), sizeof(e) );
+      if( e.data_size.value() > 0 )
+         chunks_size = e.table_pos.value() + _blocks_per_chunk * sizeof(chunk_block_entry) + e.data_size.value();
+   }
+   FC_ASSERT( chunks_size <= _chunks_file_size, "Chunks of the block log are truncated" );
+   if( index_size < _chunk_index_file_size || chunks_size < _chunks_file_size )
+   {
+      wlog( "Dropping incomplete chunk from block log in ${d}", ("d", dbdir) );
+      _chunk_index_map.unmap();
+      _chunks_map.unmap();
+      fc::resize_file( dbdir / "chunk_index", index_size );
+      fc::resize_file( dbdir / "chunks", chunks_size );
+      _chunk_index_file_size = index_size;
+      _chunks_file_size = chunks_size;
+      remap();
+   }
+
+   load_tail();
+   _last_read_position = 0;
+} FC_CAPTURE_AND_RETHROW( (dbdir) ) }
+
+bool chunked_block_log::is_open()const
+{
+   return _chunks.is_open();
+}
+
+void chunked_block_log::close()
+{
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+   _chunk_index_map.unmap();
+   _chunks_map.unmap();
+   _tail_map.unmap();
+   _chunk_index.close();
+   _chunks.close();
+   _tail.close();
+   _tail_blocks.clear();
+   _chunk_index_file_size = 0;
+   _chunks_file_size = 0;
+   _tail_file_size = 0;
+
+   std::lock_guard<std::mutex> cache_lock( _cache_mutex );
+   _chunk_cache.clear();
+}
+
+void chunked_block_log::flush()
+{
+   // the streams are only used by writers
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   _chunk_index.flush();
+   _chunks.flush();
+   _tail.flush();
+}
+
+void chunked_block_log::remap()const
+{
+   _chunk_index_map.map( _dbdir / "chunk_index" );
+   _chunks_map.map( _dbdir / "chunks" );
+   _tail_map.map( _dbdir / "tail" );
+}
+
+bool chunked_block_log::ensure_tail_mapped( std::shared_lock<std::shared_timed_mutex>& lock, uint64_t size )const
+{
+   if( _tail_map.size() >= size )
+      return true;
+   if( _tail_file_size < size )
+      return false;
+
+   lock.unlock();
+   {
+      std::unique_lock<std::shared_timed_mutex> exclusive( _mutex );
+      // another reader may have remapped in the meantime
+      if( _tail_map.size() < size )
+         _tail_map.map( _dbdir / "tail" );
+   }
+   lock.lock();
+   return _tail_map.size() >= size;
+}
+
+uint64_t chunked_block_log::sealed_chunks()const
+{
+   if( _chunk_index_file_size < sizeof(chunk_log_header) )
+      return 0;
+   return ( _chunk_index_file_size - sizeof(chunk_log_header) ) / sizeof(chunk_index_entry);
+}
+
+void chunked_block_log::load_tail()
+{
+   const uint32_t first_unsealed = uint32_t( sealed_chunks() * _blocks_per_chunk );
+   _tail_blocks.clear();
+
+   uint64_t pos = 0;
+   while( pos + sizeof(tail_record_header) <= _tail_map.size() )
+   {
+      tail_record_header header;
+      memcpy( (char*)&header, _tail_map.data() + pos, sizeof(header) );
+      const uint64_t data_pos = pos + sizeof(header);
+      if( data_pos + header.size.value() > _tail_map.size() )
+         break;
+
+      const uint32_t block_num = block_header::num_from_id( header.block_id );
+      if( header.size.value() == 0 )
+      {
+         auto itr = _tail_blocks.find( block_num );
+         if( itr != _tail_blocks.end() && itr->second.id == header.block_id )
+            _tail_blocks.erase( itr );
+      }
+      else if( block_num >= first_unsealed ) // records of chunks sealed right before a crash are skipped
+      {
+         tail_entry& entry = _tail_blocks[block_num];
+         entry.id = header.block_id;
+         entry.pos = data_pos;
+         entry.size = header.size.value();
+      }
+      pos = data_pos + header.size.value();
+   }
+
+   if( pos < _tail_file_size )
+   {
+      wlog( "Dropping partially written block from block log in ${d}", ("d", _dbdir) );
+      _tail_map.unmap();
+      fc::resize_file( _dbdir / "tail", pos );
+      _tail_file_size = pos;
+      _tail_map.map( _dbdir / "tail" );
+   }
+}
+
+void chunked_block_log::append_tail_record( const block_id_type& id, const char* data, uint32_t size )
+{
+   tail_record_header header;
+   header.block_id = id;
+   header.size = size;
+   _tail.seekp( _tail_file_size );
+   _tail.write( (const char*)&header, sizeof(header) );
+   if( size > 0 )
+      _tail.write( data, size );
+   _tail.flush();
+
+   const uint32_t block_num = block_header::num_from_id( id );
+   if( size > 0 )
+   {
+      tail_entry& entry = _tail_blocks[block_num];
+      entry.id = id;
+      entry.pos = _tail_file_size + sizeof(header);
+      entry.size = size;
+   }
+   else
+      _tail_blocks.erase( block_num );
+   _tail_file_size += sizeof(header) + size;
+}
+
+void chunked_block_log::seal_ready_chunks()
+{
+   bool sealed = false;
+   while( !_tail_blocks.empty() )
+   {
+      const uint64_t chunk_num = _tail_blocks.begin()->first / _blocks_per_chunk;
+      // blocks above the last irreversible block may still be replaced or removed by fork switches
+      if( ( chunk_num + 1 ) * _blocks_per_chunk > uint64_t( _last_irreversible_block ) + 1 )
+         break;
+      seal_chunk( chunk_num );
+      sealed = true;
+   }
+   if( sealed )
+      rewrite_tail();
+}
+
+void chunked_block_log::seal_chunk( uint64_t chunk_num )
+{
+   // only readers run concurrently, they may remap the tail but do not change _tail_blocks or the files
+   const uint32_t first = uint32_t( chunk_num * _blocks_per_chunk );
+   vector<chunk_block_entry> table( _blocks_per_chunk );
+   vector<char> payload;
+   {
+      std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+      FC_ASSERT( ensure_tail_mapped( lock, _tail_file_size ), "Tail of the block log is truncated" );
+      for( auto itr = _tail_blocks.begin(); itr != _tail_blocks.end() && itr->first < first + _blocks_per_chunk; ++itr )
+      {
+         chunk_block_entry& entry = table[ itr->first - first ];
+         entry.block_id = itr->second.id;
+         entry.offset = payload.size();
+         entry.size = itr->second.size;
+         payload.insert( payload.end(), _tail_map.data() + itr->second.pos,
+                         _tail_map.data() + itr->second.pos + itr->second.size );
+      }
+   }
+
+   const vector<char> compressed = zlib_deflate( payload );
+   chunk_index_entry index_entry;
+   index_entry.table_pos = _chunks_file_size;
+   index_entry.data_size = compressed.size();
+   index_entry.raw_size = payload.size();
+   index_entry.codec = uint8_t(block_chunk_codec::zlib);
+
+   // readers do not look past the file sizes below, so the chunk is appended before it is published
+   const size_t table_size = table.size() * sizeof(chunk_block_entry);
+   _chunks.seekp( _chunks_file_size );
+   _chunks.write( (const char*)table.data(), table_size );
+   _chunks.write( compressed.data(), compressed.size() );
+   _chunks.flush();
+
+   // chunks without any blocks are left empty in the index
+   _chunk_index.seekp( _chunk_index_file_size );
+   const chunk_index_entry empty_entry;
+   for( uint64_t c = sealed_chunks(); c < chunk_num; ++c )
+      _chunk_index.write( (const char*)&empty_entry, sizeof(empty_entry) );
+   _chunk_index.write( (const char*)&index_entry, sizeof(index_entry) );
+   _chunk_index.flush();
+
+   std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+   _tail_blocks.erase( _tail_blocks.begin(), _tail_blocks.lower_bound( first + _blocks_per_chunk ) );
+   _chunks_file_size += table_size + compressed.size();
+   _chunk_index_file_size = sizeof(chunk_log_header) + ( chunk_num + 1 ) * sizeof(chunk_index_entry);
+   _chunk_index_map.map( _dbdir / "chunk_index" );
+   _chunks_map.map( _dbdir / "chunks" );
+}
+
+void chunked_block_log::rewrite_tail()
+{
+   const fc::path tail_filename = _dbdir / "tail";
+   const fc::path tmp_filename = _dbdir / "tail.tmp";
+   std::map<uint32_t, tail_entry> moved_blocks;
+   {
+      std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+      FC_ASSERT( ensure_tail_mapped( lock, _tail_file_size ), "Tail of the block log is truncated" );
+      std::ofstream out( tmp_filename.generic_string().c_str(),
+                         std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out );
+      uint64_t pos = 0;
+      for( const auto& item : _tail_blocks )
+      {
+         tail_record_header header;
+         header.block_id = item.second.id;
+         header.size = item.second.size;
+         out.write( (const char*)&header, sizeof(header) );
+         out.write( _tail_map.data() + item.second.pos, item.second.size );
+         tail_entry& entry = moved_blocks[item.first];
+         entry = item.second;
+         entry.pos = pos + sizeof(header);
+         pos += sizeof(header) + item.second.size;
+      }
+      out.flush();
+      FC_ASSERT( out );
+   }
+
+   std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+   _tail_map.unmap();
+   _tail.close();
+   fc::rename( tmp_filename, tail_filename );
+   open_stream( _tail, tail_filename );
+   _tail_file_size = fc::file_size( tail_filename );
+   _tail_map.map( tail_filename );
+   _tail_blocks.swap( moved_blocks );
+}
+
+void chunked_block_log::store( const block_id_type& id, const signed_block& b )
+{ try {
+   const uint32_t block_num = block_header::num_from_id( id );
+   auto vec = fc::raw::pack( b );
+
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   {
+      std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+      FC_ASSERT( block_num >= sealed_chunks() * _blocks_per_chunk,
+                 "Block ${n} belongs to a sealed chunk of the block log", ("n", block_num) );
+      append_tail_record( id, vec.data(), vec.size() );
+   }
+   seal_ready_chunks();
+} FC_CAPTURE_AND_RETHROW( (id) ) }
+
+void chunked_block_log::set_last_irreversible_block( uint32_t block_num )
+{ try {
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   if( block_num <= _last_irreversible_block )
+      return;
+   _last_irreversible_block = block_num;
+   seal_ready_chunks();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void chunked_block_log::remove( const block_id_type& id )
+{ try {
+   const uint32_t block_num = block_header::num_from_id( id );
+   std::lock_guard<std::mutex> write_lock( _write_mutex );
+   std::unique_lock<std::shared_timed_mutex> lock( _mutex );
+
+   auto itr = _tail_blocks.find( block_num );
+   if( itr != _tail_blocks.end() )
+   {
+      if( itr->second.id == id )
+         append_tail_record( id, nullptr, 0 );
+      return;
+   }
+   if( _tail_blocks.empty() || block_num > _tail_blocks.rbegin()->first )
+      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
+   FC_ASSERT( block_num >= sealed_chunks() * _blocks_per_chunk,
+              "Block ${n} belongs to a sealed chunk of the block log", ("n", block_num) );
+} FC_CAPTURE_AND_RETHROW( (id) ) }
+
+bool chunked_block_log::find_sealed( uint32_t block_num, block_id_type& id, uint32_t& offset, uint32_t& size )const
+{
+   const uint64_t chunk_num = block_num / _blocks_per_chunk;
+   if( chunk_num >= sealed_chunks() )
+      return false;
+
+   chunk_index_entry index_entry;
+   memcpy( (char*)&index_entry,
+           _chunk_index_map.data() + sizeof(chunk_log_header) + chunk_num * sizeof(index_entry),
+           sizeof(index_entry) );
+   if( index_entry.data_size.value() == 0 )
+      return false;
+
+   chunk_block_entry entry;
+   const uint64_t entry_pos = index_entry.table_pos.value()
+                              + ( block_num - chunk_num * _blocks_per_chunk ) * sizeof(entry);
+   FC_ASSERT( entry_pos + sizeof(entry) <= _chunks_map.size(), "Chunks of the block log are truncated" );
+   memcpy( (char*)&entry, _chunks_map.data() + entry_pos, sizeof(entry) );
+   if( entry.size.value() == 0 )
+      return false;
+
+   id = entry.block_id;
+   offset = entry.offset.value();
+   size = entry.size.value();
+   return true;
+}
+
+std::shared_ptr<const chunked_block_log::chunk_data> chunked_block_log::load_chunk( uint64_t chunk_num )const
+{
+   {
+      std::lock_guard<std::mutex> cache_lock( _cache_mutex );
+      for( auto itr = _chunk_cache.begin(); itr != _chunk_cache.end(); ++itr )
+         if( (*itr)->chunk_num == chunk_num )
+         {
+            auto result = *itr;
+            _chunk_cache.splice( _chunk_cache.begin(), _chunk_cache, itr );
+            return result;
+         }
+   }
+
+   chunk_index_entry index_entry;
+   memcpy( (char*)&index_entry,
+           _chunk_index_map.data() + sizeof(chunk_log_header) + chunk_num * sizeof(index_entry),
+           sizeof(index_entry) );
+   const uint64_t data_pos = index_entry.table_pos.value() + _blocks_per_chunk * sizeof(chunk_block_entry);
+   FC_ASSERT( data_pos + index_entry.data_size.value() <= _chunks_map.size(),
+              "Chunks of the block log are truncated" );
+
+   auto result = std::make_shared<chunk_data>();
+   result->chunk_num = chunk_num;
+   result->payload.reserve( index_entry.raw_size.value() );
+   const char* data = _chunks_map.data() + data_pos;
+   switch( block_chunk_codec( index_entry.codec ) )
+   {
+      case block_chunk_codec::none:
+         result->payload.assign( data, data + index_entry.data_size.value() );
+         break;
+      case block_chunk_codec::zlib:
+         zlib_inflate( data, index_entry.data_size.value(), result->payload );
+         break;
+      default:
+         FC_THROW( "Unknown codec ${c} of chunk ${n} in block log", ("c", index_entry.codec)("n", chunk_num) );
+   }
+   FC_ASSERT( result->payload.size() == index_entry.raw_size.value(), "Corrupted chunk ${n} in block log",
+              ("n", chunk_num) );
+
+   std::lock_guard<std::mutex> cache_lock( _cache_mutex );
+   _chunk_cache.push_front( result );
+   if( _chunk_cache.size() > max_cached_chunks )
+      _chunk_cache.pop_back();
+   return result;
+}
+
+template<typename Reader>
+bool chunked_block_log::read_data_by_number( uint32_t block_num, const block_id_type* expected_id,
+                                             Reader&& reader )const
+{
+   std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+
+   auto itr = _tail_blocks.find( block_num );
+   if( itr != _tail_blocks.end() )
+   {
+      const tail_entry entry = itr->second;
+      if( expected_id != nullptr && entry.id != *expected_id )
+         return false;
+      if( !ensure_tail_mapped( lock, entry.pos + entry.size ) )
+         return false;
+      // the tail may have been rewritten while the lock was released, so look the block up again
+      itr = _tail_blocks.find( block_num );
+      if( itr == _tail_blocks.end() || itr->second.id != entry.id
+            || itr->second.pos + itr->second.size > _tail_map.size() )
+         return false;
+      reader( entry.id, _tail_map.data() + itr->second.pos, itr->second.size );
+      _last_read_position = _chunks_file_size + itr->second.pos + itr->second.size;
+      return true;
+   }
+
+   block_id_type id;
+   uint32_t offset = 0;
+   uint32_t size = 0;
+   if( !find_sealed( block_num, id, offset, size ) )
+      return false;
+   if( expected_id != nullptr && id != *expected_id )
+      return false;
+
+   auto chunk = load_chunk( block_num / _blocks_per_chunk );
+   FC_ASSERT( uint64_t(offset) + size <= chunk->payload.size(), "Corrupted chunk in block log" );
+   reader( id, chunk->payload.data() + offset, size );
+
+   chunk_index_entry index_entry;
+   memcpy( (char*)&index_entry,
+           _chunk_index_map.data() + sizeof(chunk_log_header) + chunk->chunk_num * sizeof(index_entry),
+           sizeof(index_entry) );
+   _last_read_position = index_entry.table_pos.value()
+                         + uint64_t(offset) * index_entry.data_size.value() / std::max( 1u, index_entry.raw_size.value() );
+   return true;
+}
+
+optional<signed_block> chunked_block_log::read_by_number( uint32_t block_num, const block_id_type* expected_id )const
+{
+   optional<signed_block> result;
+   read_data_by_number( block_num, expected_id, [&result]( const block_id_type& id, const char* data, uint32_t size ) {
+      fc::datastream<const char*> ds( data, size );
+      result = signed_block();
+      fc::raw::unpack( ds, *result );
+      FC_ASSERT( result->id() == id );
+   });
+   return result;
+}
+
+bool chunked_block_log::contains( const block_id_type& id )const
+{
+   if( id == block_id_type() )
+      return false;
+
+   const uint32_t block_num = block_header::num_from_id( id );
+   std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+   auto itr = _tail_blocks.find( block_num );
+   if( itr != _tail_blocks.end() )
+      return itr->second.id == id;
+
+   block_id_type sealed_id;
+   uint32_t offset = 0;
+   uint32_t size = 0;
+   return find_sealed( block_num, sealed_id, offset, size ) && sealed_id == id;
+}
+
+block_id_type chunked_block_log::fetch_block_id( uint32_t block_num )const
+{
+   std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+   auto itr = _tail_blocks.find( block_num );
+   if( itr != _tail_blocks.end() )
+      return itr->second.id;
+
+   block_id_type id;
+   uint32_t offset = 0;
+   uint32_t size = 0;
+   if( !find_sealed( block_num, id, offset, size ) )
+      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+   return id;
+}
+
+optional<signed_block> chunked_block_log::fetch_optional( const block_id_type& id )const
+{
+   try
+   {
+      return read_by_number( block_header::num_from_id( id ), &id );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<signed_block>();
+}
+
+optional<signed_block> chunked_block_log::fetch_by_number( uint32_t block_num )const
+{
+   try
+   {
+      return read_by_number( block_num, nullptr );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<signed_block>();
+}
+
+optional<packed_block> chunked_block_log::fetch_packed_by_number( uint32_t block_num )const
+{
+   try
+   {
+      optional<packed_block> result;
+      read_data_by_number( block_num, nullptr, [&result]( const block_id_type& id, const char* data, uint32_t size ) {
+         result = packed_block{ id, vector<char>( data, data + size ) };
+      });
+      return result;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<packed_block>();
+}
+
+optional<block_id_type> chunked_block_log::last_id()const
+{
+   std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+   if( !_tail_blocks.empty() )
+      return _tail_blocks.rbegin()->second.id;
+
+   for( uint64_t c = sealed_chunks(); c > 0; --c )
+      for( uint32_t i = _blocks_per_chunk; i > 0; --i )
+      {
+         block_id_type id;
+         uint32_t offset = 0;
+         uint32_t size = 0;
+         if( find_sealed( uint32_t( (c-1) * _blocks_per_chunk + i - 1 ), id, offset, size ) )
+            return id;
+      }
+   return optional<block_id_type>();
+}
+
+size_t chunked_block_log::blocks_current_position()const
+{
+   return _last_read_position;
+}
+
+size_t chunked_block_log::total_block_size()const
+{
+   std::shared_lock<std::shared_timed_mutex> lock( _mutex );
+   return _chunks_file_size + _tail_file_size;
+}
+
+void chunked_block_log::import( const block_database& source, const fc::path& dbdir, uint32_t blocks_per_chunk )
+{ try {
+   FC_ASSERT( !exists( dbdir ) && !fc::exists( dbdir / "index" ), "${d} already contains a block log", ("d", dbdir) );
+
+   optional<block_id_type> last = source.last_id();
+   chunked_block_log log;
+   log.open( dbdir, blocks_per_chunk );
+   if( last.valid() )
+   {
+      const uint32_t last_num = block_header::num_from_id( *last );
+      ilog( "Importing ${n} blocks into chunked block log in ${d}", ("n", last_num)("d", dbdir) );
+      for( uint32_t block_num = 1; block_num <= last_num; ++block_num )
+      {
+         optional<signed_block> block = source.fetch_by_number( block_num );
+         if( block.valid() )
+            log.store( block->id(), *block );
+         // the blocks within the undo history of the source may still be replaced once the node runs again
+         if( block_num > GRAPHENE_MAX_UNDO_HISTORY )
+            log.set_last_irreversible_block( block_num - GRAPHENE_MAX_UNDO_HISTORY );
+         if( block_num % 100000 == 0 )
+            ilog( "   ${n} of ${t} blocks imported", ("n", block_num)("t", last_num) );
+      }
+   }
+   log.close();
+} FC_CAPTURE_AND_RETHROW( (dbdir)(blocks_per_chunk) ) }
+
+} }
@@ -174,6 +174,13 @@ asset database::get_market_fee_vesting_balance(const account_id_type &account_id
    return vbo_it->balance;
 }
 
+bool database::has_market_fee_vesting_balance(const account_id_type &account_id, const asset_id_type &asset_id)const
+{
+   auto& vesting_balances = get_index_type<vesting_balance_index>().indices().get<by_vesting_type>();
+   const auto& key = detail::vbo_mfs_key{account_id, asset_id};
+   return vesting_balances.find(key, key, key) != vesting_balances.end();
+}
+
 void database::deposit_market_fee_vesting_balance(const account_id_type &account_id, const asset &delta)
 { try {
    FC_ASSERT( delta.amount >= 0, "Invalid negative value for balance");
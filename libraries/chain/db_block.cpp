@@ -3,6 +3,7 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/db_with.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/impacted.hpp>
 
 #include <graphene/chain/block_summary_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
@@ -25,6 +26,8 @@
 #include <fc/crypto/digest.hpp>
 #include <fc/thread/non_preemptable_scope_check.hpp>
 
+#include <future>
+
 namespace {
 
    struct proposed_operations_digest_accumulator
@@ -143,9 +146,16 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
    detail::with_skip_flags( *this, skip, [&]()
    {
       detail::without_pending_transactions( *this, std::move(_pending_tx),
-      [&]()
+      [&]( mempool& pending )
       {
          result = _push_block(new_block);
+         _block_id_to_block.set_last_irreversible_block( get_dynamic_global_properties().last_irreversible_block_num );
+         // drop what the new head block included, the rest is applied again afterwards
+         if( head_block_id() == new_block.id() )
+            for( const auto& trx : new_block.transactions )
+               pending.remove( trx.id() );
+         if( _state_snapshot_interval > 0 )
+            check_state_snapshot();
       });
    });
    return result;
@@ -174,13 +184,26 @@ bool database::_push_block(const signed_block& new_block)
       if( new_head->data.block_num() > head_block_num() )
       {
          wlog( "Switching to fork: ${id}", ("id",new_head->data.id()) );
+         const fc::time_point switch_start = fc::time_point::now();
+         const fork_switch_stats stats_before = _fork_switch_stats;
+         auto finish_switch = [this,&switch_start,&stats_before]() {
+            const uint64_t elapsed = ( fc::time_point::now() - switch_start ).count();
+            ++_fork_switch_stats.switches;
+            _fork_switch_stats.total_time_us += elapsed;
+            _fork_switch_stats.max_time_us = std::max( _fork_switch_stats.max_time_us, elapsed );
+            _fork_switch_stats.last_time_us = elapsed;
+            ilog( "Fork switch took ${t} ms, ${p} blocks popped, ${n} pushed, ${r} of them from retained changes",
+                  ("t",elapsed/1000)("p",_fork_switch_stats.blocks_popped - stats_before.blocks_popped)
+                  ("n",_fork_switch_stats.blocks_pushed - stats_before.blocks_pushed)
+                  ("r",_fork_switch_stats.blocks_reused - stats_before.blocks_reused) );
+         };
          auto branches = _fork_db.fetch_branch_from(new_head->data.id(), head_block_id());
 
          // pop blocks until we hit the forked block
          while( head_block_id() != branches.second.back()->data.previous )
          {
             ilog( "popping block #${n} ${id}", ("n",head_block_num())("id",head_block_id()) );
-            pop_block();
+            pop_block_for_fork_switch();
          }
 
          // push all blocks on the new fork
@@ -189,11 +212,7 @@ bool database::_push_block(const signed_block& new_block)
                ilog( "pushing block from fork #${n} ${id}", ("n",(*ritr)->data.block_num())("id",(*ritr)->id) );
                optional<fc::exception> except;
                try {
-                  undo_database::session session = _undo_db.start_undo_session();
-                  apply_block( (*ritr)->data, skip );
-                  update_witnesses( **ritr );
-                  _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
-                  session.commit();
+                  push_block_for_fork_switch( **ritr, skip );
                }
                catch ( const fc::exception& e ) { except = e; }
                if( except )
@@ -212,7 +231,7 @@ bool database::_push_block(const signed_block& new_block)
                   while( head_block_id() != branches.second.back()->data.previous )
                   {
                      ilog( "popping block #${n} ${id}", ("n",head_block_num())("id",head_block_id()) );
-                     pop_block();
+                     pop_block_for_fork_switch();
                   }
 
                   ilog( "Switching back to fork: ${id}", ("id",branches.second.front()->data.id()) );
@@ -220,14 +239,13 @@ bool database::_push_block(const signed_block& new_block)
                   for( auto ritr2 = branches.second.rbegin(); ritr2 != branches.second.rend(); ++ritr2 )
                   {
                      ilog( "pushing block #${n} ${id}", ("n",(*ritr2)->data.block_num())("id",(*ritr2)->id) );
-                     auto session = _undo_db.start_undo_session();
-                     apply_block( (*ritr2)->data, skip );
-                     _block_id_to_block.store( (*ritr2)->id, (*ritr2)->data );
-                     session.commit();
+                     push_block_for_fork_switch( **ritr2, skip );
                   }
+                  finish_switch();
                   throw *except;
                }
          }
+         finish_switch();
          return true;
       }
       else return false;
@@ -236,6 +254,7 @@ bool database::_push_block(const signed_block& new_block)
    try {
       auto session = _undo_db.start_undo_session();
       apply_block(new_block, skip);
+      new_head->changes = std::move( _applied_block_changes );
       if( new_block.timestamp.sec_since_epoch() > now - 86400 )
          update_witnesses( *new_head );
       _block_id_to_block.store(new_block.id(), new_block);
@@ -249,6 +268,40 @@ bool database::_push_block(const signed_block& new_block)
    return false;
 } FC_CAPTURE_AND_RETHROW( (new_block) ) }
 
+void database::pop_block_for_fork_switch()
+{ try {
+   pop_block();
+   ++_fork_switch_stats.blocks_popped;
+} FC_CAPTURE_AND_RETHROW() }
+
+void database::push_block_for_fork_switch( fork_item& item, uint32_t skip )
+{ try {
+   undo_database::session session = _undo_db.start_undo_session();
+   if( item.changes )
+   {
+      // the block was applied on top of the same state before, its changes are the same without executing it
+      const block_changes& changes = *item.changes;
+      _undo_db.redo( changes.changes );
+      _random_number_generator = changes.random_number_generator;
+      _current_block_num = item.num;
+      _applied_ops = changes.applied_ops;
+      notify_applied_block( item.data );
+      _applied_ops.clear();
+      notify_changed_objects();
+      update_block_state_hash();
+      ++_fork_switch_stats.blocks_reused;
+   }
+   else
+   {
+      apply_block( item.data, skip );
+      item.changes = std::move( _applied_block_changes );
+   }
+   update_witnesses( item );
+   _block_id_to_block.store( item.id, item.data );
+   session.commit();
+   ++_fork_switch_stats.blocks_pushed;
+} FC_CAPTURE_AND_RETHROW( (item.id) ) }
+
 void database::verify_signing_witness( const signed_block& new_block, const fork_item& fork_entry )const
 {
    FC_ASSERT( new_block.timestamp >= fork_entry.next_block_time );
@@ -299,30 +352,116 @@ processed_transaction database::push_transaction( const precomputable_transactio
    return result;
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
+namespace {
+   /// Collects the accounts @p trx may modify, @return whether it executes proposals, which may modify any account
+   bool get_modified_accounts( const transaction& trx, flat_set<account_id_type>& modified )
+   {
+      transaction_get_impacted_accounts( trx, modified, false );
+      return std::any_of( trx.operations.begin(), trx.operations.end(), []( const operation& op ) {
+         return op.is_type<proposal_update_operation>();
+      } );
+   }
+}
+
 processed_transaction database::_push_transaction( const precomputable_transaction& trx )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
+   // Check the mempool limits before spending time on applying the transaction
+   mempool_entry entry = make_mempool_entry( trx );
+   const vector<transaction_id_type> evicted = _pending_tx.make_room( entry );
+
    if( !_pending_tx_session.valid() )
+   {
       _pending_tx_session = _undo_db.start_undo_session();
+      _pending_tx_applied = 0;
+      _pending_tx_skip = 0;
+      _pending_tx_modified_accounts.clear();
+      _pending_tx_executes_proposals = false;
+      _pending_tx_first_new_account = account_id_type( get_index_type<account_index>().get_next_id() );
+   }
 
    // Create a temporary undo session as a child of _pending_tx_session.
    // The temporary session will be discarded by the destructor if
    // _apply_transaction fails.  If we make it to merge(), we
    // apply the changes.
 
+   const bool cache_authority = _authority_cache.enabled()
+                                && !( get_node_properties().skip_flags & skip_transaction_signatures );
+   flat_set<account_id_type> consulted;
+
    auto temp_session = _undo_db.start_undo_session();
-   auto processed_trx = _apply_transaction( trx );
-   _pending_tx.push_back(processed_trx);
+   auto processed_trx = _apply_transaction( trx, cache_authority ? &consulted : nullptr );
+   // The changes of evicted transactions stay in the pending state until it is rebuilt, which happens at the latest
+   // when the next block is generated or received
+   for( const auto& id : evicted )
+      _pending_tx.remove( id );
+   entry.trx = processed_trx;
+   _pending_tx.insert( std::move(entry) );
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
    temp_session.merge();
+   ++_pending_tx_applied;
+   _pending_tx_skip |= get_node_properties().skip_flags;
+   _pending_tx_change_count = _undo_db.change_count();
+
+   if( _authority_cache.enabled() )
+   {
+      // The verification gives the same result on top of the head block if it did not depend on earlier pending
+      // transactions
+      if( cache_authority && !_pending_tx_executes_proposals
+            && std::none_of( consulted.begin(), consulted.end(), [this]( account_id_type id ) {
+                  return !( id < _pending_tx_first_new_account ) || _pending_tx_modified_accounts.count( id ) > 0;
+               } ) )
+         _authority_cache.insert( trx, head_block_id(), std::move(consulted) );
+      if( get_modified_accounts( trx, _pending_tx_modified_accounts ) )
+         _pending_tx_executes_proposals = true;
+   }
 
    // notify anyone listening to pending transactions
    notify_on_pending_transaction( trx );
    return processed_trx;
 }
+
+namespace {
+   struct fee_payer_and_fee_visitor
+   {
+      typedef std::pair<account_id_type, asset> result_type;
+      template<typename Operation>
+      result_type operator()( const Operation& op )const { return std::make_pair( op.fee_payer(), op.fee ); }
+   };
+}
+
+mempool_entry database::make_mempool_entry( const precomputable_transaction& trx )const
+{
+   trx.validate();
+   mempool_entry entry;
+   entry.id = trx.id();
+   entry.expiration = trx.expiration;
+   entry.size = trx.get_packed_size();
+   fc::uint128_t core_fees = 0;
+   for( const auto& op : trx.operations )
+   {
+      const auto payer_and_fee = op.visit( fee_payer_and_fee_visitor() );
+      if( &op == &trx.operations.front() )
+         entry.fee_payer = payer_and_fee.first;
+      const asset& fee = payer_and_fee.second;
+      if( fee.amount <= 0 )
+         continue;
+      if( fee.asset_id == asset_id_type() )
+         core_fees += fee.amount.value;
+      else
+      {
+         // an unknown fee asset makes the transaction fail when it is applied
+         const asset_object* fee_asset = find( fee.asset_id );
+         if( fee_asset != nullptr )
+            core_fees += ( fee * fee_asset->options.core_exchange_rate ).amount.value;
+      }
+   }
+   entry.fee_per_kb = static_cast<uint64_t>( core_fees * 1024 / std::max<uint64_t>( entry.size, 1 ) );
+   return entry;
+}
 class undo_session_nesting_guard {
 public:
    undo_session_nesting_guard( uint32_t& nesting_counter, const database& db )
@@ -438,9 +577,35 @@ signed_block database::_generate_block(
    // the value of the "when" variable is known, which means we need to
    // re-apply pending transactions in this method.
    //
+   // Transactions are evaluated against the head block state though, so
+   // the rebuild is skipped when the pending state still is the result of
+   // applying exactly the pending transactions to the head block.
+   //
 
-   // pop pending state (reset to head block state)
-   _pending_tx_session.reset();
+   static const size_t max_partial_block_header_size = fc::raw::pack_size( signed_block_header() )
+                                                       - fc::raw::pack_size( witness_id_type() ) // witness_id
+                                                       + 3; // max space to store size of transactions (out of block header),
+                                                            // +3 means 3*7=21 bits so it's practically safe
+   const size_t max_block_header_size = max_partial_block_header_size + fc::raw::pack_size( witness_id );
+   auto maximum_block_size = get_global_properties().parameters.maximum_block_size;
+   size_t total_block_size = max_block_header_size;
+
+   // Fast path: if all pending transactions fit into the block, and the pending state is the result of applying them
+   // on top of the head block with at least the checks required here, and nothing else changed it since, applying them
+   // again in the same order would give the same results, so the pending state is used as is.
+   size_t pending_size = total_block_size;
+   _pending_tx.for_each( [&pending_size]( const mempool_entry& entry ) {
+      pending_size += fc::raw::pack_size( entry.trx );
+   });
+   const bool all_pending_fit = ( pending_size <= maximum_block_size );
+   const bool reuse_pending_state = all_pending_fit && _pending_tx_session.valid()
+                                    && _pending_tx_applied == _pending_tx.size()
+                                    && _pending_tx_change_count == _undo_db.change_count()
+                                    && !( _pending_tx_skip & ~skip );
+
+   // pop pending state (reset to head block state), unless it can be used as is
+   if( !reuse_pending_state )
+      _pending_tx_session.reset();
 
    // Check witness signing key
    if( !(skip & skip_witness_signature) )
@@ -453,57 +618,65 @@ signed_block database::_generate_block(
       FC_ASSERT( witness_id(*this).signing_key == block_signing_private_key.get_public_key() );
    }
 
-   static const size_t max_partial_block_header_size = fc::raw::pack_size( signed_block_header() )
-                                                       - fc::raw::pack_size( witness_id_type() ) // witness_id
-                                                       + 3; // max space to store size of transactions (out of block header),
-                                                            // +3 means 3*7=21 bits so it's practically safe
-   const size_t max_block_header_size = max_partial_block_header_size + fc::raw::pack_size( witness_id );
-   auto maximum_block_size = get_global_properties().parameters.maximum_block_size;
-   size_t total_block_size = max_block_header_size;
-
    signed_block pending_block;
 
-   _pending_tx_session = _undo_db.start_undo_session();
-
    uint64_t postponed_tx_count = 0;
-   for( const processed_transaction& tx : _pending_tx )
+   if( reuse_pending_state )
    {
-      size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
-
-      // postpone transaction if it would make block too big
-      if( new_total_size > maximum_block_size )
-      {
-         postponed_tx_count++;
-         continue;
-      }
+      pending_block.transactions.reserve( _pending_tx.size() );
+      _pending_tx.for_each( [&pending_block]( const mempool_entry& entry ) {
+         pending_block.transactions.push_back( entry.trx );
+      });
+   }
+   else
+   {
+      _pending_tx_session = _undo_db.start_undo_session();
 
-      try
+      auto apply_pending = [&]( const mempool_entry& entry )
       {
-         auto temp_session = _undo_db.start_undo_session();
-         processed_transaction ptx = _apply_transaction( tx );
+         const processed_transaction& tx = entry.trx;
+         size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
-         // We have to recompute pack_size(ptx) because it may be different
-         // than pack_size(tx) (i.e. if one or more results increased
-         // their size)
-         new_total_size = total_block_size + fc::raw::pack_size( ptx );
          // postpone transaction if it would make block too big
          if( new_total_size > maximum_block_size )
          {
             postponed_tx_count++;
-            continue;
+            return;
          }
 
-         temp_session.merge();
-
-         total_block_size = new_total_size;
-         pending_block.transactions.push_back( ptx );
-      }
-      catch ( const fc::exception& e )
-      {
-         // Do nothing, transaction will not be re-applied
-         wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
-         wlog( "The transaction was ${t}", ("t", tx) );
-      }
+         try
+         {
+            auto temp_session = _undo_db.start_undo_session();
+            processed_transaction ptx = _apply_transaction( tx );
+
+            // We have to recompute pack_size(ptx) because it may be different
+            // than pack_size(tx) (i.e. if one or more results increased
+            // their size)
+            new_total_size = total_block_size + fc::raw::pack_size( ptx );
+            // postpone transaction if it would make block too big
+            if( new_total_size > maximum_block_size )
+            {
+               postponed_tx_count++;
+               return;
+            }
+
+            temp_session.merge();
+
+            total_block_size = new_total_size;
+            pending_block.transactions.push_back( ptx );
+         }
+         catch ( const fc::exception& e )
+         {
+            // Do nothing, transaction will not be re-applied
+            wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
+            wlog( "The transaction was ${t}", ("t", tx) );
+         }
+      };
+      // When the block cannot take all pending transactions, the ones paying the most per byte go first
+      if( all_pending_fit )
+         _pending_tx.for_each( apply_pending );
+      else
+         _pending_tx.for_each_by_priority( apply_pending );
    }
    if( postponed_tx_count > 0 )
    {
@@ -549,6 +722,7 @@ void database::pop_block()
    }
    pop_undo();
    _popped_tx.insert( _popped_tx.begin(), fork_db_head->data.transactions.begin(), fork_db_head->data.transactions.end() );
+   update_block_state_hash();
 } FC_CAPTURE_AND_RETHROW() }
 
 void database::clear_pending()
@@ -611,15 +785,26 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    return;
 }
 
+struct database::speculative_authority_check
+{
+   /// Accounts whose authorities the verification depends on
+   flat_set<account_id_type> consulted;
+   /// Accounts the transaction may modify
+   flat_set<account_id_type> modified;
+   bool                      executes_proposals = false;
+   bool                      verified = false;
+};
+
 void database::_apply_block( const signed_block& next_block )
 { try {
    uint32_t next_block_num = next_block.block_num();
    uint32_t skip = get_node_properties().skip_flags;
    _applied_ops.clear();
+   _applied_block_changes.reset();
 
    if( !(skip & skip_block_size_check) )
    {
-      FC_ASSERT( fc::raw::pack_size(next_block) <= get_global_properties().parameters.maximum_block_size );
+      FC_ASSERT( next_block.get_packed_size() <= get_global_properties().parameters.maximum_block_size );
    }
 
    FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root(),
@@ -643,6 +828,18 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
+   vector<speculative_authority_check> speculated;
+   if( _optimistic_execution && !(skip & skip_transaction_signatures) && next_block.transactions.size() > 1 )
+      speculate_authorities( next_block, speculated );
+   const bool use_authority_cache = _authority_cache.enabled() && !(skip & skip_transaction_signatures);
+   // accounts possibly modified by the transactions applied so far, invalidating earlier verifications
+   flat_set<account_id_type> modified_accounts;
+   bool modifications_known = true;
+   auto unmodified = [&modified_accounts]( const flat_set<account_id_type>& accounts ) {
+      return std::none_of( accounts.begin(), accounts.end(),
+                           [&modified_accounts]( account_id_type id ) { return modified_accounts.count(id) > 0; } );
+   };
+
    for( const auto& trx : next_block.transactions )
    {
       /* We do not need to push the undo state for each transaction
@@ -651,7 +848,39 @@ void database::_apply_block( const signed_block& next_block )
        * for transactions when validating broadcast transactions or
        * when building a block.
        */
-      apply_transaction( trx, skip );
+      uint32_t trx_skip = skip;
+      const speculative_authority_check* check = speculated.empty() ? nullptr : &speculated[_current_trx_in_block];
+      bool verified = false;
+      if( check )
+      {
+         verified = modifications_known && check->verified && unmodified( check->consulted );
+         if( verified )
+            ++_optimistic_stats.speculated;
+         else
+            ++_optimistic_stats.reverified;
+      }
+      if( use_authority_cache )
+      {
+         // an entry made on top of the current head block holds unless an earlier transaction changed its accounts
+         const authority_cache_entry* entry = _authority_cache.find( trx, head_block_id() );
+         if( entry )
+         {
+            verified = verified || ( modifications_known && unmodified( entry->consulted ) );
+            _authority_cache.remove( trx.id() );
+         }
+      }
+      if( verified )
+         trx_skip |= skip_transaction_signatures;
+
+      if( check )
+      {
+         // nested proposals may modify any account
+         modifications_known = modifications_known && !check->executes_proposals;
+         modified_accounts.insert( check->modified.begin(), check->modified.end() );
+      }
+      else if( use_authority_cache && get_modified_accounts( trx, modified_accounts ) )
+         modifications_known = false;
+      apply_transaction( trx, trx_skip );
       ++_current_trx_in_block;
    }
 
@@ -693,14 +922,138 @@ void database::_apply_block( const signed_block& next_block )
    if( !_node_property_object.debug_updates.empty() )
       apply_debug_updates();
 
+   // what the block did so far, the changes made by the handlers of applied_block are theirs to make again
+   if( _reuse_fork_changes && _undo_db.enabled() )
+   {
+      auto changes = std::make_shared<block_changes>( _random_number_generator );
+      _undo_db.capture_head( changes->changes );
+      changes->applied_ops = _applied_ops;
+      _applied_block_changes = std::move( changes );
+   }
+
    // notify observers that the block has been applied
    notify_applied_block( next_block ); //emit
    _applied_ops.clear();
 
    notify_changed_objects();
+
+   if( _memory_usage_log_interval > 0 && next_block.block_num() % _memory_usage_log_interval == 0 )
+      log_memory_usage();
+
+   update_block_state_hash();
+   if( _state_hash_log_interval > 0 && next_block.block_num() % _state_hash_log_interval == 0 )
+      ilog( "State hash at block ${b}: ${h}", ("b",next_block.block_num())("h",_block_state_hash.state_hash) );
 } FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
 
+void database::update_block_state_hash()
+{
+   if( !state_hash_enabled() ) return;
+   _block_state_hash.block_num = head_block_num();
+   _block_state_hash.block_id = head_block_id();
+   _block_state_hash.indexes = get_index_state_digests();
+   _block_state_hash.state_hash = fc::sha256::hash( _block_state_hash.indexes );
+}
+
+
+
+void database::verify_transaction_authority( const signed_transaction& trx,
+                                             flat_set<account_id_type>* consulted )const
+{
+   bool allow_non_immediate_owner = true;
+   auto get_active = [this,consulted]( account_id_type id ) {
+      if( consulted ) consulted->insert( id );
+      return &id(*this).active;
+   };
+   auto get_owner  = [this,consulted]( account_id_type id ) {
+      if( consulted ) consulted->insert( id );
+      return &id(*this).owner;
+   };
+   auto get_custom = [this,consulted]( account_id_type id, const operation& op, rejected_predicate_map* rejects ) {
+      if( consulted ) consulted->insert( id );
+      return get_viable_custom_authorities(id, op, rejects);
+   };
 
+   trx.verify_authority(get_chain_id(), get_active, get_owner, get_custom, allow_non_immediate_owner,
+                        false, get_global_properties().parameters.max_authority_depth);
+}
+
+void database::speculate_authorities( const signed_block& block, vector<speculative_authority_check>& checks )const
+{ try {
+   const size_t count = block.transactions.size();
+   checks.clear();
+   checks.resize( count );
+
+   // Transactions sharing an account are verified by the same worker: they read the same custom authorities,
+   // which cache their predicates on first use.
+   vector<size_t> group( count );
+   auto find_group = [&group]( size_t i ) {
+      while( group[i] != i )
+         i = group[i] = group[group[i]];
+      return i;
+   };
+   flat_map<account_id_type, size_t> account_group;
+   for( size_t i = 0; i < count; ++i )
+   {
+      group[i] = i;
+      auto& check = checks[i];
+      check.executes_proposals = get_modified_accounts( block.transactions[i], check.modified );
+      for( const auto& account : check.modified )
+      {
+         auto itr = account_group.find( account );
+         if( itr == account_group.end() )
+            account_group[account] = i;
+         else
+            group[ find_group(i) ] = find_group( itr->second );
+      }
+   }
+
+   const uint32_t num_workers = std::max( fc::asio::default_io_service_scope::get_num_threads(), 1u );
+   vector<vector<size_t>> work( num_workers );
+   flat_map<size_t, uint32_t> group_worker;
+   uint32_t next_worker = 0;
+   for( size_t i = 0; i < count; ++i )
+   {
+      auto itr = group_worker.find( find_group(i) );
+      if( itr == group_worker.end() )
+      {
+         itr = group_worker.emplace( find_group(i), next_worker ).first;
+         next_worker = ( next_worker + 1 ) % num_workers;
+      }
+      work[itr->second].push_back( i );
+   }
+
+   // This runs while the block is being applied. Waiting on an fc::future would let other tasks of this thread run
+   // and modify the database the workers read, so the thread is blocked on std::promise instead.
+   ASSERT_TASK_NOT_PREEMPTED();
+   std::vector<fc::future<void>> workers;
+   std::vector<std::promise<void>> done( num_workers );
+   workers.reserve( num_workers );
+   for( uint32_t w = 0; w < num_workers; ++w )
+   {
+      const auto& trxs = work[w];
+      if( trxs.empty() )
+      {
+         done[w].set_value();
+         continue;
+      }
+      workers.push_back( fc::do_parallel( [this,&block,&checks,&trxs,&finished=done[w]] () {
+         for( size_t i : trxs )
+         {
+            try {
+               verify_transaction_authority( block.transactions[i], &checks[i].consulted );
+               checks[i].verified = true;
+            } catch( const fc::exception& ) {
+               // redone when the transaction is applied, which reports the error
+            } catch( const std::exception& ) {
+            } catch( ... ) {
+            }
+         }
+         finished.set_value();
+      }) );
+   }
+   for( auto& finished : done )
+      finished.get_future().wait();
+} FC_CAPTURE_AND_RETHROW( (block.block_num()) ) }
 
 processed_transaction database::apply_transaction(const signed_transaction& trx, uint32_t skip)
 {
@@ -712,14 +1065,14 @@ processed_transaction database::apply_transaction(const signed_transaction& trx,
    return result;
 }
 
-processed_transaction database::_apply_transaction(const signed_transaction& trx)
+processed_transaction database::_apply_transaction( const signed_transaction& trx,
+                                                     flat_set<account_id_type>* consulted )
 { try {
    uint32_t skip = get_node_properties().skip_flags;
 
    trx.validate();
 
    auto& trx_idx = get_mutable_index_type<transaction_index>();
-   const chain_id_type& chain_id = get_chain_id();
    if( !(skip & skip_transaction_dupe_check) )
    {
       GRAPHENE_ASSERT( trx_idx.indices().get<by_trx_id>().find(trx.id()) == trx_idx.indices().get<by_trx_id>().end(),
@@ -732,17 +1085,7 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    eval_state._trx = &trx;
 
    if( !(skip & skip_transaction_signatures) )
-   {
-      bool allow_non_immediate_owner = true;
-      auto get_active = [this]( account_id_type id ) { return &id(*this).active; };
-      auto get_owner  = [this]( account_id_type id ) { return &id(*this).owner;  };
-      auto get_custom = [this]( account_id_type id, const operation& op, rejected_predicate_map* rejects ) {
-         return get_viable_custom_authorities(id, op, rejects);
-      };
-
-      trx.verify_authority(chain_id, get_active, get_owner, get_custom, allow_non_immediate_owner,
-                           false, get_global_properties().parameters.max_authority_depth);
-   }
+      verify_transaction_authority( trx, consulted );
 
    //Skip all manner of expiration and TaPoS checking if we're on block 1; It's impossible that the transaction is
    //expired, and TaPoS makes no sense as no blocks exist.
@@ -879,6 +1222,12 @@ bool database::before_last_checkpoint()const
 static const uint32_t skip_expensive = database::skip_transaction_signatures | database::skip_witness_signature
                                        | database::skip_merkle_check | database::skip_transaction_dupe_check;
 
+namespace {
+   // Merkle digests only exist for transactions that are already part of a block
+   inline void precompute_merkle_digest( const processed_transaction& trx ) { trx.merkle_digest(); }
+   inline void precompute_merkle_digest( const precomputable_transaction& ) {}
+}
+
 template<typename Trx>
 void database::_precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const
 {
@@ -891,46 +1240,77 @@ void database::_precompute_parallel( const Trx* trx, const size_t count, const u
          trx->id();
       if( !(skip&skip_transaction_signatures) )
          trx->get_signature_keys( get_chain_id() );
+      if( !(skip&skip_merkle_check) )
+         precompute_merkle_digest( *trx );
    }
 }
 
 fc::future<void> database::precompute_parallel( const signed_block& block, const uint32_t skip )const
 { try {
    std::vector<fc::future<void>> workers;
+   fc::optional<fc::future<void>> signee_worker;
+   if( !(skip&skip_witness_signature) )
+      signee_worker = fc::do_parallel( [&block] () { block.signee(); } );
+
    if( !block.transactions.empty() )
    {
       if( (skip & skip_expensive) == skip_expensive )
          _precompute_parallel( &block.transactions[0], block.transactions.size(), skip );
       else
       {
+         // Key recovery is the bulk of the work, so the chunks get about the same number of signatures rather than
+         // the same number of transactions
+         const size_t count = block.transactions.size();
          uint32_t chunks = fc::asio::default_io_service_scope::get_num_threads();
-         uint32_t chunk_size = ( block.transactions.size() + chunks - 1 ) / chunks;
-         workers.reserve( chunks + 1 );
-         for( size_t base = 0; base < block.transactions.size(); base += chunk_size )
-            workers.push_back( fc::do_parallel( [this,&block,base,chunk_size,skip] () {
-               _precompute_parallel( &block.transactions[base],
-                                     base + chunk_size < block.transactions.size() ? chunk_size : block.transactions.size() - base,
-                                     skip );
+         size_t total_weight = 0;
+         for( const auto& trx : block.transactions )
+            total_weight += trx.signatures.size() + 1;
+         const size_t chunk_weight = ( total_weight + chunks - 1 ) / chunks;
+         workers.reserve( chunks + 2 );
+         size_t base = 0;
+         size_t weight = 0;
+         for( size_t i = 0; i < count; ++i )
+         {
+            weight += block.transactions[i].signatures.size() + 1;
+            if( weight < chunk_weight && i + 1 < count )
+               continue;
+            workers.push_back( fc::do_parallel( [this,&block,base,end=i+1,skip] () {
+               _precompute_parallel( &block.transactions[base], end - base, skip );
             }) );
+            base = i + 1;
+            weight = 0;
+         }
       }
    }
+   if( !(skip & skip_block_size_check) )
+      workers.push_back( fc::do_parallel( [&block] () { block.get_packed_size(); } ) );
 
-   if( !(skip&skip_witness_signature) )
-      workers.push_back( fc::do_parallel( [&block] () { block.signee(); } ) );
-   if( !(skip&skip_merkle_check) )
-      block.calculate_merkle_root();
    block.id();
 
-   if( workers.empty() )
-      return fc::future< void >( fc::promise< void >::create( true ) );
+   // The merkle root only combines the per-transaction digests, so it is computed once all workers are done
+   for( auto& worker : workers )
+      worker.wait();
+   if( !(skip&skip_merkle_check) )
+      block.calculate_merkle_root();
 
-   auto first = workers.begin();
-   auto worker = first;
-   while( ++worker != workers.end() )
-      worker->wait();
-   return *first;
+   if( signee_worker.valid() )
+      return *signee_worker;
+   return fc::future< void >( fc::promise< void >::create( true ) );
 } FC_LOG_AND_RETHROW() }
 
+void database::precompute_block( const signed_block& block, const uint32_t skip )const
+{
+   if( !block.transactions.empty() )
+      _precompute_parallel( &block.transactions[0], block.transactions.size(), skip );
+   if( !(skip&skip_witness_signature) )
+      block.signee();
+   if( !(skip&skip_block_size_check) )
+      block.get_packed_size();
+   if( !(skip&skip_merkle_check) )
+      block.calculate_merkle_root();
+   block.id();
+}
+
 fc::future<void> database::precompute_parallel( const precomputable_transaction& trx )const
 {
    return fc::do_parallel([this,&trx] () {
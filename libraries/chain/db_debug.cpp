@@ -162,6 +162,32 @@ void debug_apply_update( database& db, const fc::variant_object& vo )
    }
 }
 
+void database::log_memory_usage()const
+{
+   auto usage = get_memory_usage();
+   uint64_t objects = 0;
+   uint64_t undo_bytes = 0;
+   for( const auto& item : usage.indexes )
+      objects += item.object_count;
+   for( auto bytes : usage.undo_states )
+      undo_bytes += bytes;
+
+   std::sort( usage.indexes.begin(), usage.indexes.end(),
+              []( const graphene::db::index_memory_usage& a, const graphene::db::index_memory_usage& b ) {
+                 return a.object_bytes + a.secondary_index_bytes > b.object_bytes + b.secondary_index_bytes;
+              });
+   std::string largest;
+   for( size_t i = 0; i < usage.indexes.size() && i < 5; ++i )
+   {
+      const auto& item = usage.indexes[i];
+      largest += " " + fc::to_string( item.space_id ) + "." + fc::to_string( item.type_id ) + ":"
+                 + fc::to_string( ( item.object_bytes + item.secondary_index_bytes ) >> 20 ) + "MiB";
+   }
+   ilog( "Object database at block ${b}: ${total} MiB for ${n} objects, ${u} MiB in ${s} undo states, largest:${l}",
+         ("b",head_block_num())("total",usage.total_bytes() >> 20)("n",objects)("u",undo_bytes >> 20)
+         ("s",usage.undo_states.size())("l",largest) );
+}
+
 void database::apply_debug_updates()
 {
    block_id_type head_id = head_block_id();
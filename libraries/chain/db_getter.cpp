@@ -197,6 +197,11 @@ const witness_schedule_object& database::get_witness_schedule_object()const
 {
    return *_p_witness_schedule_obj;
 }
+
+const limit_order_book_index& database::get_limit_order_book()const
+{
+   return *_limit_order_book;
+}
 vector<authority> database::get_account_custom_authorities(account_id_type account, const operation& op)const
 {
    const auto& pindex = get_index_type<custom_permission_index>().indices().get<by_account_and_permission>();
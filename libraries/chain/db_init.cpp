@@ -254,6 +254,14 @@ void database::initialize_evaluators()
    register_evaluator<random_number_store_evaluator>();
 }
 
+/// The time when update_credit_offers_and_deals disables a credit offer, if it is enabled
+struct credit_offer_auto_disable_extractor
+{
+   typedef time_point_sec result_type;
+   result_type operator()( const credit_offer_object& o )const
+   { return o.enabled ? o.auto_disable_time : time_point_sec::maximum(); }
+};
+
 void database::initialize_indexes()
 {
    reset_indexes();
@@ -267,25 +275,46 @@ void database::initialize_indexes()
    FC_ASSERT(_check_policy_1 != nullptr && _check_policy_2 != nullptr, "Failed to allocate object spaces");
    
    //Protocol object indexes
-   add_index< primary_index<asset_index, 13> >(); // 8192 assets per chunk
-   add_index< primary_index<force_settlement_index> >();
+   _lottery_schedule.clear();
+   auto asset_idx = add_index< primary_index<asset_index, 13> >(); // 8192 assets per chunk
+   asset_idx->add_secondary_indexer< index_observer< asset_object, lottery_schedule > >( &_lottery_schedule );
+   add_index< primary_index<force_settlement_index> >()->enable_hashed_id_lookup();
 
    auto acnt_index = add_index< primary_index<account_index, 20> >(); // ~1 million accounts per chunk
    acnt_index->add_secondary_index<account_member_index>();
    acnt_index->add_secondary_index<account_referrer_index>();
    add_index< primary_index<committee_member_index, 8> >(); // 256 members per chunk
    add_index< primary_index<witness_index, 10> >(); // 1024 witnesses per chunk
-   add_index< primary_index<limit_order_index > >();
-   add_index< primary_index<call_order_index > >();
-   add_index< primary_index<proposal_index > >();
-   add_index< primary_index<withdraw_permission_index > >();
+   // orders are created and removed all the time, their ids are too sparse for direct_index
+   auto limit_order_idx = add_index< primary_index<limit_order_index > >();
+   limit_order_idx->enable_hashed_id_lookup();
+   _limit_order_book = limit_order_idx->add_secondary_index<limit_order_book_index>();
+   _margin_call_watermarks.clear();
+   limit_order_idx->add_secondary_indexer< index_observer< limit_order_object, margin_call_watermarks > >(
+         &_margin_call_watermarks );
+   _expiration_wheel.clear();
+   limit_order_idx->add_secondary_indexer< index_observer< limit_order_object, expiration_wheel,
+         member< limit_order_object, time_point_sec, &limit_order_object::expiration > > >( &_expiration_wheel );
+   auto call_order_idx = add_index< primary_index<call_order_index > >();
+   call_order_idx->enable_hashed_id_lookup();
+   call_order_idx->add_secondary_indexer< index_observer< call_order_object, margin_call_watermarks > >(
+         &_margin_call_watermarks );
+   add_index< primary_index<proposal_index > >()->add_secondary_indexer<
+         index_observer< proposal_object, expiration_wheel,
+            member< proposal_object, time_point_sec, &proposal_object::expiration_time > > >( &_expiration_wheel );
+   add_index< primary_index<withdraw_permission_index > >()->add_secondary_indexer<
+         index_observer< withdraw_permission_object, expiration_wheel,
+            member< withdraw_permission_object, time_point_sec, &withdraw_permission_object::expiration > > >(
+         &_expiration_wheel );
    add_index< primary_index<vesting_balance_index> >();
    add_index< primary_index<worker_index> >();
    add_index< primary_index<balance_index> >();
    add_index< primary_index<ico_balance_index> >();
-   add_index< primary_index< htlc_index> >();
+   add_index< primary_index< htlc_index> >()->add_secondary_indexer<
+         index_observer< htlc_object, expiration_wheel, htlc_object::timelock_extractor > >( &_expiration_wheel );
    add_index< primary_index< custom_authority_index> >();
-   add_index< primary_index<ticket_index> >();
+   add_index< primary_index<ticket_index> >()->add_secondary_indexer< index_observer< ticket_object, expiration_wheel,
+         member< ticket_object, time_point_sec, &ticket_object::next_auto_update_time > > >( &_expiration_wheel );
    add_index< primary_index<tank_index> >();
 //bet
    add_index< primary_index<sport_object_index > >();
@@ -294,7 +323,7 @@ void database::initialize_indexes()
    add_index< primary_index<betting_market_rules_object_index > >();
    add_index< primary_index<betting_market_group_object_index > >();
    add_index< primary_index<betting_market_object_index > >();
-   add_index< primary_index<bet_object_index > >();
+   add_index< primary_index<bet_object_index > >()->enable_hashed_id_lookup();
 
    add_index< primary_index<tournament_index> >();
    auto tournament_details_idx = add_index< primary_index<tournament_details_index> >();
@@ -311,8 +340,10 @@ void database::initialize_indexes()
    //add_index< primary_index<sidechain_address_index> >();
    //add_index< primary_index<sidechain_transaction_index> >();//
 
-   add_index< primary_index<nft_metadata_index > >();
-   add_index< primary_index<nft_index > >();
+   add_index< primary_index<nft_metadata_index > >()->add_secondary_indexer<
+         index_observer< nft_metadata_object, lottery_schedule > >( &_lottery_schedule );
+   add_index< primary_index<nft_index > >()->add_secondary_indexer< index_observer< nft_object, lottery_schedule > >(
+         &_lottery_schedule );
    add_index< primary_index<account_role_index> >();
 
    add_index< primary_index<lottery_balance_index                         > >();
@@ -322,13 +353,20 @@ void database::initialize_indexes()
 
    add_index< primary_index<random_number_index                           > >();
    //Implementation object indexes
-   add_index< primary_index<transaction_index                             > >();
+   add_index< primary_index<transaction_index                             > >()->add_secondary_indexer<
+         index_observer< transaction_history_object, expiration_wheel, const_mem_fun< transaction_history_object,
+            time_point_sec, &transaction_history_object::get_expiration > > >( &_expiration_wheel );
 
    auto bal_idx = add_index< primary_index<account_balance_index          > >();
    // add_secondary_indexer is not [add_secondary_index] !!
    bal_idx->add_secondary_indexer<balances_by_account_index>();
 
-   add_index< primary_index<asset_bitasset_data_index,                 13 > >(); // 8192
+   auto bitasset_idx = add_index< primary_index<asset_bitasset_data_index,                 13 > >(); // 8192
+   bitasset_idx->add_secondary_indexer< index_observer< asset_bitasset_data_object, margin_call_watermarks > >(
+         &_margin_call_watermarks );
+   bitasset_idx->add_secondary_indexer< index_observer< asset_bitasset_data_object, expiration_wheel,
+         const_mem_fun< asset_bitasset_data_object, time_point_sec,
+            &asset_bitasset_data_object::feed_expiration_time > > >( &_expiration_wheel );
    add_index< primary_index<asset_dividend_data_object_index              > >();
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
@@ -343,7 +381,7 @@ void database::initialize_indexes()
    add_index< primary_index< buyback_index                                > >();
    add_index< primary_index< simple_index< fba_accumulator_object       > > >();
    
-   add_index< primary_index< betting_market_position_index > >();
+   add_index< primary_index< betting_market_position_index > >()->enable_hashed_id_lookup();
    add_index< primary_index< global_betting_statistics_object_index > >();
    //add_index< primary_index<pending_dividend_payout_balance_object_index > >();
    //add_index< primary_index<distributed_dividend_balance_object_index > >();
@@ -357,8 +395,12 @@ void database::initialize_indexes()
    add_index< primary_index< room_index,                                20> >();
    add_index< primary_index< room_participant_index,                    20> >();
    add_index< primary_index< room_key_epoch_index,                     20> >();
-   add_index< primary_index<credit_offer_index> >();
-   add_index< primary_index<credit_deal_index> >();
+   add_index< primary_index<credit_offer_index> >()->add_secondary_indexer<
+         index_observer< credit_offer_object, expiration_wheel, credit_offer_auto_disable_extractor > >(
+         &_expiration_wheel );
+   add_index< primary_index<credit_deal_index> >()->add_secondary_indexer< index_observer< credit_deal_object,
+         expiration_wheel, member< credit_deal_object, time_point_sec, &credit_deal_object::latest_repay_time > > >(
+         &_expiration_wheel );
    add_index< primary_index<credit_deal_summary_index                     > >();
 
   // _check_policy_1->lock();
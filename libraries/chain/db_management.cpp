@@ -34,13 +34,16 @@
 
 #include <graphene/protocol/fee_schedule.hpp>
 
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <queue>
-#include <tuple>
+#include <thread>
 
 namespace graphene { namespace chain {
 
@@ -56,6 +59,39 @@ database::~database()
    clear_pending();
 }
 
+namespace {
+
+/**
+ * One entry of the replay ring buffer. @c state holds the number of the block occupying the slot in its upper
+ * bits and the stage of that block in the lower two bits, so every stage waits for exactly the block it is
+ * responsible for and a slot can be handed from thread to thread without locks.
+ */
+struct reindex_slot
+{
+   static const uint64_t stage_read    = 1; ///< raw bytes are loaded, waiting for a decoder
+   static const uint64_t stage_decoded = 2; ///< block is unpacked and precomputed, waiting to be applied
+   static const uint64_t stage_free    = 3; ///< block has been applied, the slot may be refilled
+
+   static uint64_t make_state( uint32_t block_num, uint64_t stage ) { return ( uint64_t(block_num) << 2 ) | stage; }
+
+   std::atomic<uint64_t> state{ stage_free };
+   size_t                position = 0;
+   packed_block          raw;
+   signed_block          block;
+   std::exception_ptr    error;
+};
+
+/** Yields while a pipeline stage waits for another one, and sleeps once the wait gets longer */
+void reindex_backoff( uint32_t& spins )
+{
+   if( ++spins < 64 )
+      std::this_thread::yield();
+   else
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+}
+
+} // anonymous namespace
+
 void database::reindex( fc::path data_dir )
 { try {
    auto last_block = _block_id_to_block.last();
@@ -84,52 +120,120 @@ void database::reindex( fc::path data_dir )
 
    size_t total_block_size = _block_id_to_block.total_block_size();
    const auto& gpo = get_global_properties();
-   std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
-   uint32_t next_block_num = head_block_num() + 1;
-   uint32_t i = next_block_num;
-   while( next_block_num <= last_block_num || !blocks.empty() )
+   const uint32_t first_block_num = head_block_num() + 1;
+
+   // Replay runs as a pipeline: one thread reads the raw blocks ahead in order, the decoder threads unpack them
+   // and precompute ids, signatures and merkle roots, and this thread applies them in order. The stages hand
+   // blocks over through a ring of _reindex_queue_depth slots.
+   const uint32_t depth = _reindex_queue_depth;
+   uint32_t decode_threads = _reindex_decode_threads;
+   if( decode_threads == 0 )
+      decode_threads = std::max( std::thread::hardware_concurrency(), 2u ) - 1;
+   // decoders only precompute transaction ids for blocks recent enough to be dupe checked when applied
+   const fc::time_point_sec dupe_check_start = last_block->timestamp - gpo.parameters.maximum_time_until_expiration;
+   const uint32_t decode_skip = skip;
+
+   std::unique_ptr<reindex_slot[]> slots( new reindex_slot[depth] );
+   std::atomic<bool>     stop{ false };
+   std::atomic<uint32_t> end_block_num{ last_block_num + 1 }; // first block number that is not in the log
+   std::atomic<uint32_t> next_decode{ first_block_num };
+
+   std::vector<std::thread> threads;
+   auto join_threads = [&stop, &threads]() {
+      stop = true;
+      for( auto& t : threads )
+         if( t.joinable() )
+            t.join();
+   };
+
+   try
    {
-      if( next_block_num <= last_block_num && blocks.size() < 20 )
-      {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num++ );
-         if( block.valid() )
+      threads.reserve( decode_threads + 1 );
+      threads.emplace_back( [&]() {
+         for( uint32_t num = first_block_num; num <= last_block_num; ++num )
          {
-            if( block->timestamp >= last_block->timestamp - gpo.parameters.maximum_time_until_expiration )
-               skip &= ~skip_transaction_dupe_check;
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
-            std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
+            reindex_slot& slot = slots[ (num - first_block_num) % depth ];
+            uint32_t spins = 0;
+            while( ( slot.state.load( std::memory_order_acquire ) & 3 ) != reindex_slot::stage_free )
+            {
+               if( stop )
+                  return;
+               reindex_backoff( spins );
+            }
+            slot.position = _block_id_to_block.blocks_current_position();
+            optional<packed_block> raw = _block_id_to_block.fetch_packed_by_number( num );
+            if( !raw.valid() )
+            {
+               end_block_num = num;
+               return;
+            }
+            slot.raw = std::move( *raw );
+            slot.state.store( reindex_slot::make_state( num, reindex_slot::stage_read ), std::memory_order_release );
          }
-         else
-         {
-            wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
-            uint32_t dropped_count = 0;
+      });
+      for( uint32_t t = 0; t < decode_threads; ++t )
+         threads.emplace_back( [&]() {
             while( true )
             {
-               fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
-               // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
-               if( !last_id.valid() )
-                  break;
-               // we've caught up to the gap
-               if( block_header::num_from_id( *last_id ) <= i )
-                  break;
-               _block_id_to_block.remove( *last_id );
-               dropped_count++;
+               const uint32_t num = next_decode.fetch_add( 1 );
+               if( num > last_block_num )
+                  return;
+               reindex_slot& slot = slots[ (num - first_block_num) % depth ];
+               uint32_t spins = 0;
+               while( slot.state.load( std::memory_order_acquire )
+                         != reindex_slot::make_state( num, reindex_slot::stage_read ) )
+               {
+                  if( stop || num >= end_block_num )
+                     return;
+                  reindex_backoff( spins );
+               }
+               try
+               {
+                  fc::datastream<const char*> ds( slot.raw.data.data(), slot.raw.data.size() );
+                  slot.block = signed_block();
+                  fc::raw::unpack( ds, slot.block );
+                  FC_ASSERT( slot.block.id() == slot.raw.id, "Block ${n} in the block log does not match its id",
+                             ("n", num) );
+                  uint32_t block_skip = decode_skip;
+                  if( slot.block.timestamp >= dupe_check_start )
+                     block_skip &= ~skip_transaction_dupe_check;
+                  precompute_block( slot.block, block_skip );
+               }
+               catch( ... )
+               {
+                  slot.error = std::current_exception();
+               }
+               slot.raw.data = vector<char>();
+               slot.state.store( reindex_slot::make_state( num, reindex_slot::stage_decoded ),
+                                 std::memory_order_release );
             }
-            wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-            next_block_num = last_block_num + 1; // don't load more blocks
-         }
-      }
-      else
+         });
+
+      for( uint32_t i = first_block_num; i <= last_block_num; ++i )
       {
-         std::get<2>(blocks.front()).wait();
-         const signed_block& block = std::get<1>(blocks.front());
+         reindex_slot& slot = slots[ (i - first_block_num) % depth ];
+         uint32_t spins = 0;
+         while( slot.state.load( std::memory_order_acquire )
+                   != reindex_slot::make_state( i, reindex_slot::stage_decoded ) )
+         {
+            if( i >= end_block_num )
+               break;
+            reindex_backoff( spins );
+         }
+         if( i >= end_block_num )
+            break;
+         if( slot.error )
+            std::rethrow_exception( slot.error );
+
+         const signed_block& block = slot.block;
+         if( block.timestamp >= last_block->timestamp - gpo.parameters.maximum_time_until_expiration )
+            skip &= ~skip_transaction_dupe_check;
 
          if( i % 10000 == 0 )
          {
             std::stringstream bysize;
             std::stringstream bynum;
-            size_t current_pos = std::get<0>(blocks.front());
+            size_t current_pos = slot.position;
             if( current_pos > total_block_size )
                total_block_size = current_pos;
             bysize << std::fixed << std::setprecision(5) << double(current_pos) / total_block_size * 100;
@@ -157,15 +261,157 @@ void database::reindex( fc::path data_dir )
             _undo_db.enable();
             push_block( block, skip );
          }
-         blocks.pop();
-         i++;
+         slot.block = signed_block();
+         slot.state.store( reindex_slot::make_state( i, reindex_slot::stage_free ), std::memory_order_release );
+      }
+   }
+   catch( ... )
+   {
+      join_threads();
+      throw;
+   }
+   join_threads();
+
+   if( end_block_num <= last_block_num )
+   {
+      const uint32_t gap = end_block_num;
+      wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", gap) );
+      uint32_t dropped_count = 0;
+      while( true )
+      {
+         fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
+         // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
+         if( !last_id.valid() )
+            break;
+         // we've caught up to the gap
+         if( block_header::num_from_id( *last_id ) <= gap )
+            break;
+         _block_id_to_block.remove( *last_id );
+         dropped_count++;
       }
+      wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
    }
    _undo_db.enable();
    auto end = fc::time_point::now();
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
+/** Follows the snapshot_writer header of a state snapshot, tells it apart from the file of a single index */
+static const uint64_t state_snapshot_tag = 0x3145544154535050ULL; // "PPSTATE1"
+
+uint32_t database::pack_state_snapshot( snapshot_writer& out )const
+{
+   const auto& dgp = get_dynamic_global_properties();
+   const uint32_t lib = dgp.last_irreversible_block_num;
+   FC_ASSERT( lib > 0, "No block is irreversible yet" );
+   const optional<signed_block> block = fetch_block_by_number( lib );
+   FC_ASSERT( block.valid(), "Block ${n} is missing from the block log", ("n", lib) );
+   // one undo state per reversible block, and one for the pending transactions
+   const size_t undo_depth = dgp.head_block_number - lib + ( _pending_tx_session.valid() ? 1 : 0 );
+
+   out.pack( state_snapshot_tag );
+   out.pack( get_chain_id() );
+   out.pack( *block );
+   object_database::save_state( out, undo_depth );
+   return lib;
+}
+
+fc::sha256 database::write_state_snapshot( const fc::path& file )const
+{ try {
+   const fc::path tmp_file = fc::path( file.generic_string() + ".tmp" );
+   uint32_t lib;
+   fc::sha256 state_hash;
+   {
+      snapshot_writer out( tmp_file );
+      lib = pack_state_snapshot( out );
+      state_hash = out.finish();
+   }
+   fc::rename( tmp_file, file );
+   ilog( "Wrote state snapshot of block ${n} to ${f}, state hash ${h}", ("n", lib)("f", file)("h", state_hash) );
+   return state_hash;
+} FC_CAPTURE_AND_RETHROW( (file) ) }
+
+void database::load_state_snapshot( const fc::path& file, const fc::path& data_dir, const chain_id_type& chain_id,
+                                    const std::string& db_version )
+{ try {
+   FC_ASSERT( !_opened, "The database must be closed to load a state snapshot" );
+   FC_ASSERT( fc::exists( file ), "State snapshot ${f} does not exist", ("f", file) );
+   fc::file_mapping fm( file.generic_string().c_str(), fc::read_only );
+   fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size( file ) );
+   const char* data = (const char*)mr.get_address();
+   fc::datastream<const char*> ds( data, snapshot_writer::verify( data, mr.get_size() ) );
+   ds.skip( snapshot_writer::header_size );
+
+   uint64_t tag;
+   fc::raw::unpack( ds, tag );
+   FC_ASSERT( tag == state_snapshot_tag, "${f} is not a state snapshot", ("f", file) );
+   chain_id_type snapshot_chain_id;
+   fc::raw::unpack( ds, snapshot_chain_id );
+   FC_ASSERT( snapshot_chain_id == chain_id, "State snapshot belongs to chain ${s}, not ${c}",
+              ("s", snapshot_chain_id)("c", chain_id) );
+   signed_block block;
+   fc::raw::unpack( ds, block );
+   ilog( "Loading state snapshot of block ${n} ${id}", ("n", block.block_num())("id", block.id()) );
+
+   wipe( data_dir, true );
+   object_database::restore_state( ds, data_dir );
+   FC_ASSERT( ds.remaining() == 0, "Unexpected data at the end of the state snapshot" );
+
+   std::ofstream version_file( (data_dir / "db_version").generic_string().c_str(),
+                               std::ios::out | std::ios::binary | std::ios::trunc );
+   version_file.write( db_version.c_str(), db_version.size() );
+   version_file.close();
+
+   // open() finds the block log ending at the head block of the state and has nothing to replay
+   _block_id_to_block.open( data_dir / "database" / "block_num_to_block" );
+   _block_id_to_block.store( block.id(), block );
+   _block_id_to_block.close();
+   ilog( "Done loading state snapshot" );
+} FC_CAPTURE_AND_RETHROW( (file)(data_dir) ) }
+
+void database::check_state_snapshot()
+{
+   const uint32_t lib = get_dynamic_global_properties().last_irreversible_block_num;
+   const uint32_t last_check = _last_state_snapshot_check;
+   _last_state_snapshot_check = lib;
+   if( last_check == 0 || lib / _state_snapshot_interval == last_check / _state_snapshot_interval )
+      return;
+   if( _state_snapshot_write.valid() && !_state_snapshot_write.ready() )
+   {
+      wlog( "Skipping the state snapshot of block ${n}, the previous one is still being written", ("n", lib) );
+      return;
+   }
+
+   const fc::path dir = _state_snapshot_dir;
+   const fc::path file = dir / ( "state-" + fc::to_string( lib ) + ".bin" );
+   try
+   {
+      // only the serialization needs the state, the file is hashed and written without holding up the next block
+      snapshot_writer out;
+      pack_state_snapshot( out );
+      auto chunks = std::make_shared< std::vector< std::vector<char> > >( out.release() );
+      _state_snapshot_write = fc::do_parallel( [dir,file,lib,chunks] () {
+         try
+         {
+            fc::create_directories( dir );
+            const fc::path tmp_file = fc::path( file.generic_string() + ".tmp" );
+            const fc::sha256 state_hash = snapshot_writer::write_file( tmp_file, *chunks );
+            fc::rename( tmp_file, file );
+            ilog( "Wrote state snapshot of block ${n} to ${f}, state hash ${h}",
+                  ("n", lib)("f", file)("h", state_hash) );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "Failed to write state snapshot ${f}: ${e}", ("f", file)("e", e.to_detail_string()) );
+         }
+      });
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Failed to write state snapshot ${f}: ${e}", ("f", file)("e", e.to_detail_string()) );
+   }
+}
+
 void database::wipe(const fc::path& data_dir, bool include_blocks)
 {
    ilog("Wiping database", ("include_blocks", include_blocks));
@@ -228,6 +474,8 @@ void database::open(
          reindex( data_dir );
          _block_id_to_block.set_replay_mode(false);
       }
+      _block_id_to_block.set_last_irreversible_block( get_dynamic_global_properties().last_irreversible_block_num );
+      update_block_state_hash();
       _opened = true;
    }
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
@@ -238,35 +486,42 @@ void database::force_slow_replays()
    _slow_replays = true;
 }
 
+// Like the scans of all active lotteries these replace, the two checks below end at most one lottery per block:
+// the first one due in the order of the active lotteries index, which is the latest ending one.
+
 void database::check_ending_lotteries()
 {
    try {
+      const auto ending = _lottery_schedule.latest_ending_asset_lottery( head_block_time() );
+      if( !ending.valid() )
+         return;
+      // of the lotteries ending at the same time, the first in the index
       const auto& lotteries_idx = get_index_type<asset_index>().indices().get<active_lotteries>();
-      for( auto checking_asset: lotteries_idx )
-      {
-         FC_ASSERT( checking_asset.is_lottery() );
-         FC_ASSERT( checking_asset.lottery_options->is_active );
-         FC_ASSERT( checking_asset.lottery_options->end_date != time_point_sec() );
-         if( checking_asset.lottery_options->end_date > head_block_time() ) continue;
-         checking_asset.end_lottery(*this);
-      }
+      asset_object checking_asset = *lotteries_idx.lower_bound( (*ending)( *this ) );
+      checking_asset.end_lottery(*this);
    } catch( ... ) {}
 }
 
 void database::check_ending_nft_lotteries()
 {
    try {
+      const auto now = head_block_time();
+      const auto ending = _lottery_schedule.latest_ending_nft_lottery( now );
+      if( !ending.valid() )
+         return;
+      // the lotteries ending at the same time are not all due when the one found is sold out
       const auto &nft_lotteries_idx = get_index_type<nft_metadata_index>().indices().get<active_nft_lotteries>();
-      for (auto checking_token : nft_lotteries_idx)
+      const auto range = nft_lotteries_idx.equal_range( (*ending)( *this ) );
+      for( auto itr = range.first; itr != range.second; ++itr )
       {
-         FC_ASSERT(checking_token.is_lottery());
-         const auto &lottery_options = checking_token.lottery_data->lottery_options;
-         FC_ASSERT(lottery_options.is_active);
-         // Check the current supply of lottery tokens
-         auto current_supply = checking_token.get_token_current_supply(*this);
-         if ((lottery_options.ending_on_soldout && (current_supply == checking_token.max_supply)) ||
-             (lottery_options.end_date != time_point_sec() && (lottery_options.end_date <= head_block_time())))
+         const auto &lottery_options = itr->lottery_data->lottery_options;
+         if ((lottery_options.ending_on_soldout && _lottery_schedule.is_sold_out(itr->get_id())) ||
+             (lottery_options.end_date != time_point_sec() && (lottery_options.end_date <= now)))
+         {
+            nft_metadata_object checking_token = *itr;
             checking_token.end_lottery(*this);
+            return;
+         }
       }
    } catch( ... ) {}
 }
@@ -321,6 +576,9 @@ void database::close(bool rewind)
    object_database::flush();
    object_database::close();
 
+   if( _state_snapshot_write.valid() )
+      _state_snapshot_write.wait();
+
    if( _block_id_to_block.is_open() )
       _block_id_to_block.close();
 
@@ -272,19 +272,21 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    asset_id_type recv_asset_id = new_order_object.receive_asset_id();
 
    // We only need to check if the new order will match with others if it is at the front of the book
-   const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
-   auto limit_itr = limit_price_idx.lower_bound( boost::make_tuple( new_order_object.sell_price, order_id ) );
-   if( limit_itr != limit_price_idx.begin() )
-   {
-      --limit_itr;
-      if( limit_itr->sell_asset_id() == sell_asset_id && limit_itr->receive_asset_id() == recv_asset_id )
-         return false;
-   }
+   const limit_order_book_index& book = get_limit_order_book();
+   if( book.best_order( sell_asset_id, recv_asset_id ) != &new_order_object )
+      return false;
 
-   // this is the opposite side (on the book)
+   // credits to the new order are collected while it sweeps the limit orders, and applied once
+   taker_fill_batch taker_fills( new_order_object );
+   taker_fill_batch* const batch = _batch_taker_fills ? &taker_fills : nullptr;
+
+   // this is the opposite side (on the book), the best order of which is looked up again after every match
    auto max_price = ~new_order_object.sell_price;
-   limit_itr = limit_price_idx.lower_bound( max_price.max() );
-   auto limit_end = limit_price_idx.upper_bound( max_price );
+   const limit_order_object* maker = nullptr;
+   auto next_maker = [&]() {
+      maker = book.best_order( recv_asset_id, sell_asset_id );
+      return maker != nullptr && !( maker->sell_price < max_price );
+   };
 
    // Order matching should be in favor of the taker.
    // When a new limit order is created, e.g. an ask, need to check if it will match the highest bid.
@@ -344,16 +346,17 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    if( to_check_call_orders )
    {
       // check limit orders first, match the ones with better price in comparison to call orders
-      while( !finished && limit_itr != limit_end && limit_itr->sell_price > call_match_price )
+      while( !finished && next_maker() && maker->sell_price > call_match_price )
       {
-         auto old_limit_itr = limit_itr;
-         ++limit_itr;
          // match returns 2 when only the old order was fully filled. In this case, we keep matching; otherwise, we stop.
-         finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != 2 );
+         finished = ( match( new_order_object, *maker, maker->sell_price, batch ) != 2 );
       }
 
       if( !finished ) // TODO refactor or cleanup duplicate code
       {
+         // fills against call orders are applied right away
+         flush_taker_fills( taker_fills );
+
          // check if there are margin calls
          const auto& call_collateral_idx = get_index_type<call_order_index>().indices().get<by_collateral>();
          auto call_min = price::min( recv_asset_id, sell_asset_id );
@@ -380,14 +383,14 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    }
 
    // still need to check limit orders
-   while( !finished && limit_itr != limit_end )
+   while( !finished && next_maker() )
    {
-      auto old_limit_itr = limit_itr;
-      ++limit_itr;
       // match returns 2 when only the old order was fully filled. In this case, we keep matching; otherwise, we stop.
-      finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != 2 );
+      finished = ( match( new_order_object, *maker, maker->sell_price, batch ) != 2 );
    }
 
+   flush_taker_fills( taker_fills );
+
    const limit_order_object* updated_order_object = find< limit_order_object >( order_id );
    if( updated_order_object == nullptr )
       return true;
@@ -408,7 +411,8 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
  *  2 - maker was filled
  *  3 - both were filled
  */
-int database::match( const limit_order_object& usd, const limit_order_object& core, const price& match_price )
+int database::match( const limit_order_object& usd, const limit_order_object& core, const price& match_price,
+                     taker_fill_batch* taker_fills )
 {
    FC_ASSERT( usd.sell_price.quote.asset_id == core.sell_price.base.asset_id );
    FC_ASSERT( usd.sell_price.base.asset_id  == core.sell_price.quote.asset_id );
@@ -454,7 +458,8 @@ int database::match( const limit_order_object& usd, const limit_order_object& co
    usd_pays  = core_receives;
 
    int result = 0;
-   result |= fill_limit_order( usd, usd_pays, usd_receives, cull_taker, match_price, false ); // the first param is taker
+   result |= fill_limit_order( usd, usd_pays, usd_receives, cull_taker, match_price, false, // the first param is taker
+                               taker_fills );
    result |= fill_limit_order( core, core_pays, core_receives, true, match_price, true ) << 1; // the second param is maker
    FC_ASSERT( result != 0 );
    return result;
@@ -593,16 +598,34 @@ asset database::match( const call_order_object& call,
 } FC_CAPTURE_AND_RETHROW( (call)(settle)(match_price)(max_settlement) ) }
 
 bool database::fill_limit_order( const limit_order_object& order, const asset& pays, const asset& receives, bool cull_if_small,
-                           const price& fill_price, const bool is_maker)
+                           const price& fill_price, const bool is_maker, taker_fill_batch* taker_fills )
 { try {
    FC_ASSERT( order.amount_for_sale().asset_id == pays.asset_id );
    FC_ASSERT( pays.asset_id != receives.asset_id );
+   FC_ASSERT( taker_fills == nullptr
+              || ( !is_maker && taker_fills->order == order.id && taker_fills->receive_asset == receives.asset_id ),
+              "Internal error" );
 
    const account_object& seller = order.seller(*this);
 
-   const auto issuer_fees = pay_market_fees(&seller, receives.asset_id(*this), receives, is_maker);
+   const auto issuer_fees = pay_market_fees(&seller, receives.asset_id(*this), receives, is_maker, {}, taker_fills);
 
-   pay_order( seller, receives - issuer_fees, pays );
+   if( taker_fills == nullptr )
+      pay_order( seller, receives - issuer_fees, pays );
+   else
+   {
+      if( pays.asset_id == asset_id_type() )
+         taker_fills->core_released += pays.amount;
+      const asset net_receives = receives - issuer_fees;
+      if( taker_fills->has_balance )
+         taker_fills->received += net_receives.amount;
+      else if( net_receives.amount > 0 )
+      {
+         // may create the balance object, which has to happen now to keep object ids unchanged
+         adjust_balance( seller.get_id(), net_receives );
+         taker_fills->has_balance = true;
+      }
+   }
 
    assert( pays.asset_id != receives.asset_id );
    push_applied_operation( fill_order_operation( order.id, order.seller, pays, receives, issuer_fees, fill_price, is_maker ) );
@@ -851,6 +874,9 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
 
     if( !mia.is_market_issued() ) return false;
 
+    // nothing relevant to margin calls changed since they last needed no check
+    if( _margin_call_watermarks.can_skip( mia.id ) ) return false;
+
     const asset_bitasset_data_object& bitasset = ( bitasset_ptr ? *bitasset_ptr : mia.bitasset_data(*this) );
     
     // price feeds can cause black swans in prediction markets
@@ -867,23 +893,30 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
     if( bitasset.is_prediction_market ) return false;
     if( bitasset.current_feed.settlement_price.is_null() ) return false;
 
-    const limit_order_index& limit_index = get_index_type<limit_order_index>();
-    const auto& limit_price_index = limit_index.indices().get<by_price>();
+    const limit_order_book_index& book = get_limit_order_book();
 
-    // Looking for limit orders selling the most USD for the least CORE.
-    auto max_price = price::max( mia.id, bitasset.options.short_backing_asset );
+    // Looking for limit orders selling the most USD for the least CORE, which are at the front of the book.
     // Stop when limit orders are selling too little USD for too much CORE.
     // Note that since BSIP74, margin calls offer somewhat less CORE per USD
     // if the issuer claims a Margin Call Fee.
     auto min_price = bitasset.current_feed.margin_call_order_price(
                            bitasset.options.extensions.value.margin_call_fee_ratio );
 
-    // NOTE limit_price_index is sorted from greatest to least
-    auto limit_itr = limit_price_index.lower_bound( max_price );
-    auto limit_end = limit_price_index.upper_bound( min_price );
+    const limit_order_object* best_limit = book.best_order( mia.id, bitasset.options.short_backing_asset );
+    auto has_limit_order = [&]() {
+       return best_limit != nullptr && !( best_limit->sell_price < min_price );
+    };
+
+    // Limit orders below both the margin call order price and the MSSP neither meet a margin call nor keep a call
+    // order from a black swan, so until something else changes, the margin calls need no check again.
+    const price mssp = bitasset.current_feed.max_short_squeeze_price();
+    const price watermark = ( mssp < min_price ? mssp : min_price );
 
-    if( limit_itr == limit_end )
+    if( !has_limit_order() )
+    {
+       _margin_call_watermarks.set( watermark );
        return false;
+    }
 
     const call_order_index& call_index = get_index_type<call_order_index>();
     const auto& call_collateral_index = call_index.indices().get<by_collateral>();
@@ -897,21 +930,31 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
     call_collateral_itr = call_collateral_index.lower_bound( call_min );
     call_collateral_end = call_collateral_index.upper_bound( call_max );
 
+    if( call_collateral_itr == call_collateral_end )
+    {
+       _margin_call_watermarks.set( watermark );
+       return false;
+    }
+
     bool margin_called = false;         // toggles true once/if we actually execute a margin call
 
     auto head_num = head_block_num();
 
     while( !check_for_blackswan( mia, enable_black_swan, &bitasset ) // TODO perhaps improve performance by passing in iterators
-           && limit_itr != limit_end
+           && has_limit_order()
            && ( call_collateral_itr != call_collateral_end ) )
     {
        const call_order_object& call_order = *call_collateral_itr;
 
        // Feed protected (don't call if CR>MCR) https://github.com/cryptonomex/graphene/issues/436
        if( ( bitasset.current_maintenance_collateralization < call_order.collateralization() ) )
+       {
+          if( !margin_called )
+             _margin_call_watermarks.set( watermark );
           return margin_called;
+       }
 
-       const limit_order_object& limit_order = *limit_itr;
+       const limit_order_object& limit_order = *best_limit;
 
        price match_price  = limit_order.sell_price;
        // There was a check `match_price.validate();` here, which is removed now because it always passes
@@ -981,18 +1024,49 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
 
        call_collateral_itr = call_collateral_index.lower_bound( call_min );
 
-       auto next_limit_itr = std::next( limit_itr );
        // when for_new_limit_order is true, the limit order is taker, otherwise the limit order is maker
        bool really_filled = fill_limit_order( limit_order, limit_pays, limit_receives, true,
                                               match_price, !for_new_limit_order );
        if( really_filled )
-          limit_itr = next_limit_itr;
+          best_limit = book.best_order( mia.id, bitasset.options.short_backing_asset );
 
     } // while call_itr != call_end
 
     return margin_called;
 } FC_CAPTURE_AND_RETHROW() }
 
+database::taker_fill_batch::taker_fill_batch( const limit_order_object& taker )
+   : order( taker.id ), seller( taker.seller ), receive_asset( taker.receive_asset_id() )
+{
+}
+
+void database::flush_taker_fills( taker_fill_batch& taker_fills )
+{
+   if( taker_fills.core_released != 0 )
+   {
+      modify( get_account_stats_by_owner( taker_fills.seller ), [&taker_fills]( account_statistics_object& b ){
+         b.total_core_in_orders -= taker_fills.core_released;
+      });
+      taker_fills.core_released = 0;
+   }
+   if( taker_fills.received > 0 )
+   {
+      adjust_balance( taker_fills.seller, asset( taker_fills.received, taker_fills.receive_asset ) );
+      taker_fills.received = 0;
+   }
+   for( const auto& fee : taker_fills.fee_vestings )
+      deposit_market_fee_vesting_balance( fee.first, asset( fee.second, taker_fills.receive_asset ) );
+   taker_fills.fee_vestings.clear();
+   if( taker_fills.issuer_fees > 0 )
+   {
+      modify( taker_fills.receive_asset(*this).dynamic_asset_data_id(*this),
+              [&taker_fills]( asset_dynamic_data_object& obj ){
+         obj.accumulated_fees += taker_fills.issuer_fees;
+      });
+      taker_fills.issuer_fees = 0;
+   }
+}
+
 void database::pay_order( const account_object& receiver, const asset& receives, const asset& pays )
 {
    const auto& balances = receiver.statistics(*this);
@@ -1041,10 +1115,29 @@ asset database::calculate_market_fee( const asset_object& trade_asset, const ass
 
 
 asset database::pay_market_fees(const account_object* seller, const asset_object& recv_asset, const asset& receives,
-                                const bool& is_maker, const optional<asset>& calculated_market_fees )
+                                const bool& is_maker, const optional<asset>& calculated_market_fees,
+                                taker_fill_batch* taker_fills )
 {
    const auto market_fees = ( calculated_market_fees.valid() ? *calculated_market_fees
                                     : calculate_market_fee( recv_asset, receives, is_maker ) );
+   // Fees to an existing vesting balance are collected in taker_fills if there is one, others are deposited now
+   auto deposit_fee = [this,taker_fills]( const account_id_type& account, const asset& fee ) {
+      if( taker_fills != nullptr && fee.amount > 0 )
+      {
+         auto itr = taker_fills->fee_vestings.find( account );
+         if( itr != taker_fills->fee_vestings.end() )
+         {
+            itr->second += fee.amount;
+            return;
+         }
+         if( has_market_fee_vesting_balance( account, fee.asset_id ) )
+         {
+            taker_fills->fee_vestings[account] = fee.amount;
+            return;
+         }
+      }
+      deposit_market_fee_vesting_balance( account, fee );
+   };
    auto issuer_fees = market_fees;
    FC_ASSERT( issuer_fees <= receives, "Market fee shouldn't be greater than receives");
    //Don't dirty undo state if not actually collecting any fees
@@ -1060,7 +1153,7 @@ asset database::pay_market_fees(const account_object* seller, const asset_object
          if( network_fees_amt > 0 )
          {
             const asset network_fees = recv_asset.amount( network_fees_amt );
-            deposit_market_fee_vesting_balance( GRAPHENE_COMMITTEE_ACCOUNT, network_fees );
+            deposit_fee( GRAPHENE_COMMITTEE_ACCOUNT, network_fees );
             issuer_fees -= network_fees;
          }
       }
@@ -1113,16 +1206,18 @@ asset database::pay_market_fees(const account_object* seller, const asset_object
                                  "Referrer reward shouldn't be greater than total reward" );
                      const asset referrer_reward = recv_asset.amount(referrer_rewards_value);
                      registrar_reward -= referrer_reward;
-                     deposit_market_fee_vesting_balance(referrer, referrer_reward);
+                     deposit_fee(referrer, referrer_reward);
                   }
                }
                if( registrar_reward.amount > 0 )
-                  deposit_market_fee_vesting_balance(registrar, registrar_reward);
+                  deposit_fee(registrar, registrar_reward);
             }
          }
       }
 
-      if( issuer_fees.amount > reward.amount )
+      if( issuer_fees.amount > reward.amount && taker_fills != nullptr )
+         taker_fills->issuer_fees += issuer_fees.amount - reward.amount;
+      else if( issuer_fees.amount > reward.amount )
       {
          const auto& recv_dyn_data = recv_asset.dynamic_asset_data_id(*this);
          modify( recv_dyn_data, [&issuer_fees, &reward]( asset_dynamic_data_object& obj ){
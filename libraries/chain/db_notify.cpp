@@ -1072,13 +1072,19 @@ void database::notify_changed_objects()
       // Changed
       if( !changed_objects.empty() )
       {
-        vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
+        vector<object_id_type> changed_ids;
+        changed_ids.reserve( head_undo.old_values.size() + head_undo.old_fields.size() );
         flat_set<account_id_type> changed_accounts_impacted;
         for( const auto& item : head_undo.old_values )
         {
           changed_ids.push_back(item.first);
           get_relevant_accounts(item.second.get(), changed_accounts_impacted, false);
         }
+        for( const auto& item : head_undo.old_fields )
+        {
+          changed_ids.push_back(item.first);
+          get_relevant_accounts(find_object(item.first), changed_accounts_impacted, false);
+        }
 
         if( changed_ids.size() )
            GRAPHENE_TRY_NOTIFY( changed_objects, changed_ids, changed_accounts_impacted)
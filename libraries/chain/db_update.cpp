@@ -156,6 +156,8 @@ void database::update_last_irreversible_block()
 
 void database::clear_expired_transactions()
 { try {
+   if( !_expiration_wheel.has_due<transaction_history_object>( head_block_time() ) )
+      return;
    //Look for expired transactions in the deduplication list, and remove them.
    //Transactions must have expired by at least two forking windows in order to be removed.
    auto& transaction_idx = static_cast<transaction_index&>(get_mutable_index(implementation_ids,
@@ -213,6 +215,8 @@ void database::place_delayed_bets()
 
 void database::clear_expired_proposals()
 {
+   if( !_expiration_wheel.has_due<proposal_object>( head_block_time() ) )
+      return;
    const auto& proposal_expiration_index = get_index_type<proposal_index>().indices().get<by_expiration>();
    while( !proposal_expiration_index.empty() && proposal_expiration_index.begin()->expiration_time <= head_block_time() )
    {
@@ -318,11 +322,14 @@ void database::clear_expired_orders()
          //Cancel expired limit orders
          auto head_time = head_block_time();
 
-         auto& limit_index = get_index_type<limit_order_index>().indices().get<by_expiration>();
-         while( !limit_index.empty() && limit_index.begin()->expiration <= head_time )
+         if( _expiration_wheel.has_due<limit_order_object>( head_time ) )
          {
-            const limit_order_object& order = *limit_index.begin();
-            cancel_limit_order( order );
+            auto& limit_index = get_index_type<limit_order_index>().indices().get<by_expiration>();
+            while( !limit_index.empty() && limit_index.begin()->expiration <= head_time )
+            {
+               const limit_order_object& order = *limit_index.begin();
+               cancel_limit_order( order );
+            }
          }
 
    //Process expired force settlement orders
@@ -489,6 +496,8 @@ void database::clear_expired_orders()
 void database::update_expired_feeds()
 {
    const auto head_time = head_block_time();
+   if( !_expiration_wheel.has_due<asset_bitasset_data_object>( head_time ) )
+      return;
    const auto next_maint_time = get_dynamic_global_properties().next_maintenance_time;
 
    const auto& idx = get_index_type<asset_bitasset_data_index>().indices().get<by_feed_expiration>();
@@ -572,6 +581,8 @@ void database::update_maintenance_flag( bool new_maintenance_flag )
 
 void database::update_withdraw_permissions()
 {
+   if( !_expiration_wheel.has_due<withdraw_permission_object>( head_block_time() ) )
+      return;
    auto& permit_index = get_index_type<withdraw_permission_index>().indices().get<by_expiration>();
    while( !permit_index.empty() && permit_index.begin()->expiration <= head_block_time() )
       remove(*permit_index.begin());
@@ -584,6 +595,8 @@ uint64_t database::get_random_bits( uint64_t bound )
 
 void database::clear_expired_htlcs()
 {
+   if( !_expiration_wheel.has_due<htlc_object>( head_block_time() ) )
+      return;
    const auto& htlc_idx = get_index_type<htlc_index>().indices().get<by_expiration>();
    while ( htlc_idx.begin() != htlc_idx.end()
          && htlc_idx.begin()->conditions.time_lock.expiration <= head_block_time() )
@@ -759,6 +772,8 @@ void database::finalize_expired_offers(){
 generic_operation_result database::process_tickets()
 {
    generic_operation_result result;
+   if( !_expiration_wheel.has_due<ticket_object>( head_block_time() ) )
+      return result;
    share_type total_delta_pob;
    share_type total_delta_inactive;
    auto& idx = get_index_type<ticket_index>().indices().get<by_next_update>();
@@ -852,19 +867,24 @@ void database::update_credit_offers_and_deals()
    const auto head_time = head_block_time();
 
    // Auto-disable offers
-   const auto& offer_idx = get_index_type<credit_offer_index>().indices().get<by_auto_disable_time>();
-   auto offer_itr = offer_idx.lower_bound( true );
-   auto offer_itr_end = offer_idx.upper_bound( boost::make_tuple( true, head_time ) );
-   while( offer_itr != offer_itr_end )
+   if( _expiration_wheel.has_due<credit_offer_object>( head_time ) )
    {
-      const credit_offer_object& offer = *offer_itr;
-      ++offer_itr;
-      modify( offer, []( credit_offer_object& obj ) {
-         obj.enabled = false;
-      });
+      const auto& offer_idx = get_index_type<credit_offer_index>().indices().get<by_auto_disable_time>();
+      auto offer_itr = offer_idx.lower_bound( true );
+      auto offer_itr_end = offer_idx.upper_bound( boost::make_tuple( true, head_time ) );
+      while( offer_itr != offer_itr_end )
+      {
+         const credit_offer_object& offer = *offer_itr;
+         ++offer_itr;
+         modify( offer, []( credit_offer_object& obj ) {
+            obj.enabled = false;
+         });
+      }
    }
 
    // Auto-process deals
+   if( !_expiration_wheel.has_due<credit_deal_object>( head_time ) )
+      return;
    const auto& deal_idx = get_index_type<credit_deal_index>().indices().get<by_latest_repay_time>();
    const auto& deal_summary_idx = get_index_type<credit_deal_summary_index>().indices().get<by_offer_borrower>();
    auto deal_itr_end = deal_idx.upper_bound( head_time );
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/expiration_wheel.hpp>
+
+namespace graphene { namespace chain {
+
+void expiration_wheel::insert( object_id_type id, time_point_sec deadline )
+{
+   if( deadline == time_point_sec::maximum() )
+   {
+      remove( id );
+      return;
+   }
+   auto itr = _entries.find( id );
+   if( itr == _entries.end() )
+      itr = _entries.emplace( id, entry() ).first;
+   else if( itr->second.deadline == deadline.sec_since_epoch() )
+      return;
+   else
+      unplace( id, itr->second );
+   itr->second.deadline = deadline.sec_since_epoch();
+   place( id, itr->second );
+}
+
+void expiration_wheel::remove( object_id_type id )
+{
+   auto itr = _entries.find( id );
+   if( itr == _entries.end() )
+      return;
+   unplace( id, itr->second );
+   _entries.erase( itr );
+}
+
+bool expiration_wheel::has_due( time_point_sec now, uint8_t space_id, uint8_t type_id )
+{
+   advance( now.sec_since_epoch() );
+   if( _due.find( ( uint16_t( space_id ) << 8 ) | type_id ) == _due.end() )
+   {
+      ++_skipped_sweeps;
+      return false;
+   }
+   ++_sweeps;
+   return true;
+}
+
+void expiration_wheel::clear()
+{
+   _entries.clear();
+   for( auto& slot : _slots )
+      slot.clear();
+   _overflow.clear();
+   _due.clear();
+   _now = 0;
+   _sweeps = 0;
+   _skipped_sweeps = 0;
+}
+
+expiration_wheel_stats expiration_wheel::get_stats()const
+{
+   expiration_wheel_stats result;
+   result.size = _entries.size();
+   for( const auto& due : _due )
+      result.due += due.second;
+   result.sweeps = _sweeps;
+   result.skipped_sweeps = _skipped_sweeps;
+   return result;
+}
+
+void expiration_wheel::advance( uint32_t now )
+{
+   if( now <= _now )
+      return;
+   if( now - _now > slot_count )
+   {
+      rebuild( now );
+      return;
+   }
+   while( _now < now )
+      tick();
+}
+
+void expiration_wheel::tick()
+{
+   ++_now;
+   if( ( _now & ( slot_count - 1 ) ) == 0 )
+   {
+      // a new period of the slots of level 1 starts, and maybe of higher levels too
+      uint8_t level = 1;
+      for( ; level < level_count; ++level )
+      {
+         const uint32_t slot = ( _now >> ( slot_bits * level ) ) & ( slot_count - 1 );
+         cascade( level, slot );
+         if( slot != 0 )
+            break;
+      }
+      if( level == level_count )
+      {
+         const uint64_t horizon = uint64_t( _now ) + ( uint64_t( 1 ) << ( slot_bits * level_count ) );
+         while( !_overflow.empty() && _overflow.begin()->first < horizon )
+         {
+            const object_id_type id = _overflow.begin()->second;
+            _overflow.erase( _overflow.begin() );
+            place( id, _entries[id] );
+         }
+      }
+   }
+   cascade( 0, _now & ( slot_count - 1 ) );
+}
+
+void expiration_wheel::cascade( uint8_t level, uint32_t slot )
+{
+   std::vector<object_id_type> ids;
+   ids.swap( slot_of( level, slot ) );
+   for( const object_id_type& id : ids )
+      place( id, _entries[id] );
+}
+
+void expiration_wheel::rebuild( uint32_t now )
+{
+   for( auto& slot : _slots )
+      slot.clear();
+   _overflow.clear();
+   _now = now;
+   for( auto& item : _entries )
+   {
+      if( item.second.level != due_level )
+         place( item.first, item.second );
+   }
+}
+
+void expiration_wheel::place( object_id_type id, entry& e )
+{
+   if( e.deadline <= _now )
+   {
+      e.level = due_level;
+      ++_due[ id.space_type() ];
+      return;
+   }
+   const uint32_t delta = e.deadline - _now;
+   for( uint8_t level = 0; level < level_count; ++level )
+   {
+      if( uint64_t( delta ) < ( uint64_t( 1 ) << ( slot_bits * ( level + 1 ) ) ) )
+      {
+         e.level = level;
+         e.slot = ( e.deadline >> ( slot_bits * level ) ) & ( slot_count - 1 );
+         auto& ids = slot_of( level, e.slot );
+         e.position = ids.size();
+         ids.push_back( id );
+         return;
+      }
+   }
+   e.level = overflow_level;
+   _overflow.emplace( e.deadline, id );
+}
+
+void expiration_wheel::unplace( object_id_type id, const entry& e )
+{
+   if( e.level == due_level )
+   {
+      auto itr = _due.find( id.space_type() );
+      if( --itr->second == 0 )
+         _due.erase( itr );
+   }
+   else if( e.level == overflow_level )
+      _overflow.erase( std::make_pair( e.deadline, id ) );
+   else
+   {
+      // the last id of the slot takes the place of the removed one
+      auto& ids = slot_of( e.level, e.slot );
+      const object_id_type last = ids.back();
+      ids[ e.position ] = last;
+      _entries[ last ].position = e.position;
+      ids.pop_back();
+   }
+}
+
+} } // graphene::chain
@@ -25,6 +25,7 @@
 
 #include <graphene/chain/types.hpp>
 #include <graphene/db/generic_index.hpp>
+#include <graphene/db/field_undo.hpp>
 #include <graphene/protocol/account.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
@@ -133,6 +134,9 @@ namespace graphene { namespace chain {
           * Core fees are paid into the account_statistics_object by this method
           */
          void pay_fee( share_type core_fee, share_type cashback_vesting_threshold );
+
+         // modified by every operation of the account, only keep the changed counters in the undo history
+         GRAPHENE_DECLARE_FIELD_UNDO()
    };
 
    /**
@@ -154,6 +158,9 @@ namespace graphene { namespace chain {
 
          asset get_balance()const { return asset(balance, asset_type); }
          void  adjust_balance(const asset& delta);
+
+         // modified by every transfer, only keep the balance in the undo history
+         GRAPHENE_DECLARE_FIELD_UNDO()
    };
 
 
@@ -24,6 +24,7 @@
 #pragma once
 #include <graphene/chain/types.hpp>
 #include <graphene/db/generic_index.hpp>
+#include <graphene/db/field_undo.hpp>
 #include <graphene/protocol/asset_ops.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
@@ -66,6 +67,9 @@ namespace graphene { namespace chain {
          share_type accumulated_fees; ///< fees accumulate to be paid out over time
          share_type accumulated_collateral_fees; ///< accumulated collateral-denominated fees (for bitassets)
          share_type fee_pool;         ///< in core asset
+
+         // modified by every fee payment, only keep the changed amounts in the undo history
+         GRAPHENE_DECLARE_FIELD_UNDO()
    };
 
    /**
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/protocol/transaction.hpp>
+
+#include <graphene/chain/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+namespace graphene { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   /** Counters of the authority cache, see database::set_authority_cache_size */
+   struct authority_cache_stats
+   {
+      uint64_t size = 0;
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+   };
+
+   /** The outcome of a successful authority verification of a transaction */
+   struct authority_cache_entry
+   {
+      transaction_id_type       trx_id;
+      /// Hash of the signatures the transaction was verified with
+      digest_type               signatures_digest;
+      /// The head block the transaction was verified on
+      block_id_type             head_block;
+      /// Accounts whose authorities the verification depended on
+      flat_set<account_id_type> consulted;
+   };
+
+   /**
+    * @brief Least recently used cache of successful transaction authority verifications
+    *
+    * Transactions are verified when they are pushed to the pending state, and again when they are included in a
+    * block. An entry tells that the signatures of a transaction satisfied its required authorities on top of a
+    * given head block, as long as none of the consulted accounts changed.
+    */
+   class authority_cache
+   {
+      public:
+         /// Sets the maximum number of entries, 0 disables the cache
+         void set_max_size( size_t max_size );
+         bool enabled()const { return _max_size > 0; }
+
+         void insert( const signed_transaction& trx, const block_id_type& head_block,
+                      flat_set<account_id_type> consulted );
+         /**
+          * @return the entry of @p trx if it was verified with the same signatures on top of @p head_block, nullptr
+          * otherwise
+          */
+         const authority_cache_entry* find( const signed_transaction& trx, const block_id_type& head_block );
+         void remove( const transaction_id_type& trx_id );
+         void clear();
+
+         authority_cache_stats get_stats()const;
+
+      private:
+         struct by_trx_id;
+         typedef multi_index_container<
+            authority_cache_entry,
+            indexed_by<
+               // most recently used first
+               sequenced<>,
+               hashed_unique< tag<by_trx_id>,
+                              member< authority_cache_entry, transaction_id_type, &authority_cache_entry::trx_id >,
+                              std::hash<transaction_id_type> >
+            >
+         > entry_index_type;
+
+         entry_index_type _entries;
+         size_t           _max_size = 0;
+         uint64_t         _hits = 0;
+         uint64_t         _misses = 0;
+   };
+
+} } // graphene::chain
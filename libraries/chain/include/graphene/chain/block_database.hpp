@@ -1,17 +1,73 @@
 
 #pragma once
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <shared_mutex>
 #include <graphene/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 
 namespace graphene { namespace chain {
    struct index_entry;
+   class chunked_block_log;
    using namespace graphene::protocol;
 
+   /** A block in its serialized form, as stored in the block log */
+   struct packed_block
+   {
+      block_id_type id;
+      vector<char>  data;
+   };
+
+   /**
+    * @brief Read-only memory mapping of one of the block log files.
+    *
+    * The mapping covers the file as it was when it was (re)mapped; callers check the requested range against
+    * size() and ask the owning block_database to remap when the file has grown since.
+    */
+   class mapped_block_file
+   {
+      public:
+         void map( const fc::path& filename );
+         void unmap();
+
+         const char* data()const { return _data; }
+         size_t      size()const { return _size; }
+
+      private:
+         std::unique_ptr<fc::file_mapping>  _file;
+         std::unique_ptr<fc::mapped_region> _region;
+         const char*                        _data = nullptr;
+         size_t                             _size = 0;
+   };
+
+   /**
+    * @brief Stores irreversible blocks in an append-only log indexed by block number.
+    *
+    * Writes are appended through file streams, reads are served from read-only memory mappings of the
+    * @c index and @c blocks files. Lookups are pointer arithmetic into the mapped index, and blocks are
+    * unpacked directly from the mapped region, so any number of threads may read concurrently. Writers
+    * (and readers that find the mapping too short after the files have grown) take the mapping lock
+    * exclusively.
+    *
+    * If the directory contains a chunked_block_log, or compression was enabled before a new database is
+    * opened, all calls are forwarded to the compressed chunked format instead.
+    */
    class block_database 
    {
       public:
+         block_database();
+         ~block_database();
+
+         /**
+          * Creates new block databases in the compressed chunked format with @p blocks_per_chunk blocks per
+          * chunk, 0 keeps the uncompressed format. Existing databases keep their format, see
+          * chunked_block_log::import for converting them. Must be called before open().
+          */
+         void enable_compression( uint32_t blocks_per_chunk ) { _blocks_per_chunk = blocks_per_chunk; }
+
          void open( const fc::path& dbdir );
          bool is_open()const;
          void flush();
@@ -19,11 +75,18 @@ namespace graphene { namespace chain {
 
          void store( const block_id_type& id, const signed_block& b );
          void remove( const block_id_type& id );
+         /** Lets the compressed format seal the blocks up to @p block_num, which can no longer be replaced */
+         void set_last_irreversible_block( uint32_t block_num );
 
          bool                   contains( const block_id_type& id )const;
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /**
+          * Copies the serialized block @p block_num out of the log without unpacking it, so that callers such as
+          * replay can leave the deserialization to other threads.
+          */
+         optional<packed_block> fetch_packed_by_number( uint32_t block_num )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
          size_t                 blocks_current_position()const;
@@ -31,9 +94,40 @@ namespace graphene { namespace chain {
          void set_replay_mode(bool mode);
       private:
          bool replay_mode = false;
+         uint32_t _blocks_per_chunk = 0;
+         std::unique_ptr<chunked_block_log> _chunked;
+
          optional<index_entry> last_index_entry()const;
+
+         /** Reads the index entry of @p block_num, returns false if it is beyond the end of the index */
+         bool read_index_entry( uint32_t block_num, index_entry& e )const;
+         /** Unpacks the block referenced by @p e straight out of the mapped blocks file */
+         optional<signed_block> read_block( const index_entry& e )const;
+         /** Copies the block referenced by @p e out of the mapped blocks file */
+         optional<packed_block> read_packed_block( const index_entry& e )const;
+         /**
+          * Makes sure the mappings cover at least the given number of bytes, remapping if the files grew.
+          * @p lock must hold _map_mutex in shared mode, it is temporarily released if a remap is needed.
+          * @return false if the files themselves are shorter than requested
+          */
+         bool ensure_mapped( std::shared_lock<std::shared_timed_mutex>& lock,
+                             size_t index_size, size_t blocks_size )const;
+         /** Must be called with _map_mutex held exclusively */
+         void remap()const;
+
          fc::path _index_filename;
+         fc::path _blocks_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+
+         /** Size of the files including data written through the streams but not yet mapped */
+         mutable std::atomic<size_t> _index_file_size{0};
+         std::atomic<size_t>         _blocks_file_size{0};
+
+         mutable std::shared_timed_mutex _map_mutex;
+         mutable mapped_block_file       _index_map;
+         mutable mapped_block_file       _blocks_map;
+         /** Position of the last block read, reported by blocks_current_position() for replay progress */
+         mutable std::atomic<size_t>     _last_read_position{0};
    };
 } }
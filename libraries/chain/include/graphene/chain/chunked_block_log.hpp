@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/block_database.hpp>
+
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   class block_database;
+
+   /** Compression applied to the payload of a sealed chunk, recorded per chunk */
+   enum class block_chunk_codec : uint8_t
+   {
+      none = 0,
+      zlib = 1
+   };
+
+   /**
+    * @brief Block log that stores blocks in fixed-size compressed chunks.
+    *
+    * Chunk @c c holds block numbers <tt>[c*N, c*N+N)</tt> where @c N is the chunk size chosen when the log was
+    * created. Every chunk is stored in the @c chunks file as an uncompressed table of N fixed size entries
+    * (block id, offset and size of the block in the payload) followed by the compressed payload, and the
+    * @c chunk_index file holds one fixed size record per chunk. Looking up a block id is therefore pointer
+    * arithmetic in two mapped files, and fetching a block decompresses a single chunk; recently decompressed
+    * chunks are cached, so sequential readers such as replay decompress every chunk once.
+    *
+    * The newest blocks, which may still be replaced or removed by fork switches or by a replay that finds a
+    * corrupted block, are appended uncompressed to the @c tail file. A chunk is sealed once all of its blocks
+    * are irreversible, see set_last_irreversible_block.
+    *
+    * All read operations may be called concurrently. Writers are serialized among themselves by a separate mutex
+    * and lock out the readers only to publish what they wrote, so readers are not blocked while a chunk is
+    * compressed or the tail is rewritten.
+    */
+   class chunked_block_log
+   {
+      public:
+         static const uint32_t default_blocks_per_chunk = 256;
+
+         /**
+          * Opens or creates the log in @p dbdir. @p blocks_per_chunk is only used when a new log is created,
+          * an existing log keeps the chunk size it was written with.
+          */
+         void open( const fc::path& dbdir, uint32_t blocks_per_chunk = default_blocks_per_chunk );
+         bool is_open()const;
+         void flush();
+         void close();
+
+         void store( const block_id_type& id, const signed_block& b );
+         void remove( const block_id_type& id );
+         /** Blocks up to @p block_num can no longer be replaced, the chunks they fill are sealed */
+         void set_last_irreversible_block( uint32_t block_num );
+
+         bool                    contains( const block_id_type& id )const;
+         block_id_type           fetch_block_id( uint32_t block_num )const;
+         optional<signed_block>  fetch_optional( const block_id_type& id )const;
+         optional<signed_block>  fetch_by_number( uint32_t block_num )const;
+         optional<packed_block>  fetch_packed_by_number( uint32_t block_num )const;
+         optional<block_id_type> last_id()const;
+         size_t                  blocks_current_position()const;
+         size_t                  total_block_size()const;
+
+         uint32_t blocks_per_chunk()const { return _blocks_per_chunk; }
+
+         /** @return true if @p dbdir contains a chunked block log */
+         static bool exists( const fc::path& dbdir );
+
+         /**
+          * Copies all blocks of the uncompressed block database @p source into a new chunked log in @p dbdir,
+          * which must not contain a block log yet.
+          */
+         static void import( const block_database& source, const fc::path& dbdir,
+                             uint32_t blocks_per_chunk = default_blocks_per_chunk );
+
+      private:
+         struct tail_entry
+         {
+            block_id_type id;
+            uint64_t      pos  = 0;
+            uint32_t      size = 0;
+         };
+
+         /** Decompressed payload of a sealed chunk */
+         struct chunk_data
+         {
+            uint64_t     chunk_num = 0;
+            vector<char> payload;
+         };
+
+         /** Must be called with _write_mutex held and _mutex held exclusively */
+         void append_tail_record( const block_id_type& id, const char* data, uint32_t size );
+         /** Must be called with _write_mutex held and without holding _mutex */
+         void seal_ready_chunks();
+         void seal_chunk( uint64_t chunk_num );
+         void rewrite_tail();
+         void load_tail();
+
+         /** Looks up the entry of @p block_num in the sealed chunks, returns false if it is not sealed */
+         bool find_sealed( uint32_t block_num, block_id_type& id, uint32_t& offset, uint32_t& size )const;
+         std::shared_ptr<const chunk_data> load_chunk( uint64_t chunk_num )const;
+         /**
+          * Finds the serialized block @p block_num and passes its id and bytes to @p reader while they are
+          * guaranteed to stay valid. Returns false if the block does not exist or its id is not @p expected_id.
+          */
+         template<typename Reader>
+         bool read_data_by_number( uint32_t block_num, const block_id_type* expected_id, Reader&& reader )const;
+         optional<signed_block> read_by_number( uint32_t block_num, const block_id_type* expected_id )const;
+
+         uint64_t sealed_chunks()const;
+         /**
+          * Makes sure the tail mapping covers @p size bytes, remapping if the tail grew since it was mapped.
+          * @p lock must hold _mutex in shared mode, it is temporarily released if a remap is needed.
+          */
+         bool ensure_tail_mapped( std::shared_lock<std::shared_timed_mutex>& lock, uint64_t size )const;
+         /** Must be called with _mutex held exclusively */
+         void remap()const;
+
+         fc::path _dbdir;
+         uint32_t _blocks_per_chunk = default_blocks_per_chunk;
+
+         mutable std::fstream _chunk_index;
+         mutable std::fstream _chunks;
+         mutable std::fstream _tail;
+         uint64_t _chunks_file_size = 0;
+         uint64_t _chunk_index_file_size = 0;
+         uint64_t _tail_file_size = 0;
+         /** Chunks are only sealed up to this block, not persisted, the database sets it again after open */
+         uint32_t _last_irreversible_block = 0;
+
+         /** Blocks that are not sealed yet, by block number */
+         std::map<uint32_t, tail_entry> _tail_blocks;
+
+         /** Serializes writers, the files, their streams and _tail_blocks are only changed while it is held */
+         std::mutex                      _write_mutex;
+         mutable std::shared_timed_mutex _mutex;
+         mutable mapped_block_file       _chunk_index_map;
+         mutable mapped_block_file       _chunks_map;
+         mutable mapped_block_file       _tail_map;
+         mutable std::atomic<size_t>     _last_read_position{0};
+
+         mutable std::mutex                                   _cache_mutex;
+         mutable std::list<std::shared_ptr<const chunk_data>> _chunk_cache;
+   };
+
+} }
@@ -4,9 +4,14 @@
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/node_property_object.hpp>
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/authority_cache.hpp>
+#include <graphene/chain/margin_call_watermarks.hpp>
+#include <graphene/chain/expiration_wheel.hpp>
+#include <graphene/chain/lottery_schedule.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/commit_reveal_object.hpp>
 #include <graphene/chain/fork_database.hpp>
+#include <graphene/chain/mempool.hpp>
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
@@ -41,11 +46,46 @@ namespace graphene { namespace chain {
    class force_settlement_object;
    class limit_order_object;
    class call_order_object;
+   class limit_order_book_index;
    class account_role_object;
 
    struct budget_record;
    enum class vesting_balance_type;
 
+   /** Hash of the object database as of a block, see database::get_block_state_hash */
+   struct block_state_hash
+   {
+      uint32_t                                 block_num = 0;
+      block_id_type                            block_id;
+      /** sha256 of the digests of all indexes */
+      fc::sha256                               state_hash;
+      vector<graphene::db::index_state_digest> indexes;
+   };
+
+   /** Counters of the optimistic execution mode, see database::enable_optimistic_execution */
+   struct optimistic_execution_stats
+   {
+      /** Transactions whose authorities were verified ahead of applying them */
+      uint64_t speculated = 0;
+      /** Speculative verifications that were discarded because of a conflict or a failure, and redone in order */
+      uint64_t reverified = 0;
+   };
+
+   /** Counters and durations of fork switches, see database::get_fork_switch_stats */
+   struct fork_switch_stats
+   {
+      uint64_t switches = 0;
+      /** Blocks popped and pushed by fork switches, including those of switching back after a failure */
+      uint64_t blocks_popped = 0;
+      uint64_t blocks_pushed = 0;
+      /** Pushed blocks whose retained changes were applied instead of executing them again */
+      uint64_t blocks_reused = 0;
+      /** Time spent in all fork switches, in the longest one and in the last one, in microseconds */
+      uint64_t total_time_us = 0;
+      uint64_t max_time_us = 0;
+      uint64_t last_time_us = 0;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -109,6 +149,29 @@ namespace graphene { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /**
+          * @brief Writes the state at the last irreversible block to a self-verifying binary snapshot
+          * @param file the snapshot file, it is written under a temporary name and renamed once complete
+          * @return the state hash, a sha256 checksum covering the snapshot header and all indexes
+          *
+          * The state is rewound through the undo history without modifying the database, so this must be called
+          * between blocks, and fails if the undo history does not reach back to the last irreversible block.
+          */
+         fc::sha256 write_state_snapshot( const fc::path& file )const;
+
+         /**
+          * @brief Replaces the database in @p data_dir with the state stored in a snapshot
+          * @param file a snapshot written by write_state_snapshot
+          * @param data_dir the path to store the database
+          * @param chain_id the snapshot must belong to this chain
+          * @param db_version the version string that will be passed to open()
+          *
+          * The database must be closed. Afterwards the block log only holds the block the snapshot was taken at,
+          * and open() continues from the block after it.
+          */
+         void load_state_snapshot( const fc::path& file, const fc::path& data_dir, const chain_id_type& chain_id,
+                                   const std::string& db_version );
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -139,6 +202,8 @@ namespace graphene { namespace chain {
          processed_transaction push_transaction( const precomputable_transaction& trx, uint32_t skip = skip_nothing );
          bool _push_block( const signed_block& b );
          processed_transaction _push_transaction( const precomputable_transaction& trx );
+         /// Describe @p trx for the mempool, before applying it
+         mempool_entry         make_mempool_entry( const precomputable_transaction& trx )const;
 
          ///@throws fc::exception if the proposed transaction fails to apply.
          processed_transaction push_proposal( const proposal_object& proposal );
@@ -158,6 +223,9 @@ namespace graphene { namespace chain {
          void pop_block();
          void clear_pending();
 
+         /// @return the pending transactions, in the order they were applied to the pending state
+         const mempool& get_pending_transactions()const { return _pending_tx; }
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -280,6 +348,7 @@ namespace graphene { namespace chain {
          std::vector<uint32_t>                  get_seeds( asset_id_type for_asset, uint8_t count_winners )const;
          uint64_t                               get_random_bits( uint64_t bound );
          const witness_schedule_object&         get_witness_schedule_object()const;
+         const limit_order_book_index&          get_limit_order_book()const;
          bool                                   item_locked(const nft_id_type& item)const;
          bool                                   account_role_valid(const account_role_object& aro, account_id_type account, optional<int> op_type = optional<int>()) const;
          //bool                                   is_asset_creation_allowed(const string& symbol);
@@ -371,6 +440,8 @@ namespace graphene { namespace chain {
           * @return owner's balance in asset
           */
          asset get_market_fee_vesting_balance(const account_id_type &account_id, const asset_id_type &asset_id);
+         /// @return whether the account has a market fee vesting balance in the given asset
+         bool has_market_fee_vesting_balance(const account_id_type &account_id, const asset_id_type &asset_id)const;
 
          /**
           * @brief Helper to make lazy deposit to CDD VBO.
@@ -400,6 +471,8 @@ namespace graphene { namespace chain {
          //////////////////// db_debug.cpp ////////////////////
 
          void debug_dump();
+         /// Logs the total memory usage of the object database and the indexes using the most
+         void log_memory_usage()const;
          void apply_debug_updates();
          void debug_update( const fc::variant_object& update );
          template<typename Action>
@@ -426,6 +499,30 @@ namespace graphene { namespace chain {
                                           const IndexType& call_index );
 
       public:
+         /**
+          * @brief Credits to the taker of a sweep through the limit orders, applied once when the sweep ends
+          *
+          * Only credits to objects that already exist are collected, so that objects are created in the same
+          * order as when every fill is applied on its own.
+          */
+         struct taker_fill_batch
+         {
+            explicit taker_fill_batch( const limit_order_object& taker );
+
+            limit_order_id_type                       order;
+            account_id_type                           seller;
+            asset_id_type                             receive_asset;
+            /// amount of CORE that is no longer in orders
+            share_type                                core_released;
+            /// whether the seller already has a balance of the received asset
+            bool                                      has_balance = false;
+            share_type                                received;
+            /// market fees left to the issuer of the received asset
+            share_type                                issuer_fees;
+            /// market fees shared to existing fee vesting balances, by owner
+            flat_map< account_id_type, share_type >   fee_vestings;
+         };
+
          /**
           * @brief Process a new limit order through the markets
           * @param new_order_object The new order to process
@@ -450,7 +547,8 @@ namespace graphene { namespace chain {
           * 3 - both were filled
           */
          ///@{
-         int match( const limit_order_object& taker, const limit_order_object& maker, const price& trade_price );
+         int match( const limit_order_object& taker, const limit_order_object& maker, const price& trade_price,
+                    taker_fill_batch* taker_fills = nullptr );
          /***
           * @brief Match limit order as taker to a call order as maker
           * @param taker the order that is removing liquidity from the book
@@ -493,10 +591,15 @@ namespace graphene { namespace chain {
           * @param cull_if_small take care of dust
           * @param fill_price the transaction price
           * @param is_maker TRUE if this order is maker, FALSE if taker
+          * @param taker_fills if not null, collects the credits to the taker instead of applying them
           * @return true if the order was completely filled and thus freed.
           */
          bool fill_limit_order( const limit_order_object& order, const asset& pays, const asset& receives,
-               bool cull_if_small, const price& fill_price, const bool is_maker );
+               bool cull_if_small, const price& fill_price, const bool is_maker,
+               taker_fill_batch* taker_fills = nullptr );
+
+         /// Applies and clears the credits collected in @p taker_fills
+         void flush_taker_fills( taker_fill_batch& taker_fills );
 
          ///@}
 
@@ -548,6 +651,10 @@ namespace graphene { namespace chain {
          bool check_call_orders( const asset_object& mia, bool enable_black_swan = true, bool for_new_limit_order = false,
                                  const asset_bitasset_data_object* bitasset_ptr = nullptr );
 
+         /// @return counters of the assets whose margin calls are known to need no check, see margin_call_watermarks
+         margin_call_watermark_stats get_margin_call_watermark_stats()const
+         { return _margin_call_watermarks.get_stats(); }
+
          // helpers to fill_order
          void pay_order( const account_object& receiver, const asset& receives, const asset& pays );
 
@@ -560,7 +667,8 @@ namespace graphene { namespace chain {
          asset calculate_market_fee( const asset_object& trade_asset, const asset& trade_amount,
                                      const bool& is_maker )const;
          asset pay_market_fees(const account_object* seller, const asset_object& recv_asset, const asset& receives,
-                               const bool& is_maker, const optional<asset>& calculated_market_fees = {});
+                               const bool& is_maker, const optional<asset>& calculated_market_fees = {},
+                               taker_fill_batch* taker_fills = nullptr);
          asset pay_force_settle_fees(const asset_object& collecting_asset, const asset& collat_receives);
          ///@}
 
@@ -584,9 +692,91 @@ namespace graphene { namespace chain {
          /// Enable or disable tracking of votes of standby witnesses and committee members
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
 
+         /// Store new block logs compressed in chunks of @p blocks_per_chunk blocks, 0 for uncompressed
+         inline void enable_block_log_compression( uint32_t blocks_per_chunk )
+         { _block_id_to_block.enable_compression( blocks_per_chunk ); }
+
+         /// Log the memory usage of the object database every @p blocks blocks, 0 to disable
+         inline void set_memory_usage_log_interval( uint32_t blocks ) { _memory_usage_log_interval = blocks; }
+
+         /**
+          * Configures the replay pipeline: up to @p queue_depth blocks are read ahead of the block being applied,
+          * and @p decode_threads threads unpack and precompute them, 0 for one thread less than the number of
+          * hardware threads.
+          */
+         inline void set_reindex_pipeline( uint32_t queue_depth, uint32_t decode_threads )
+         {
+            _reindex_queue_depth = std::max( queue_depth, 1u );
+            _reindex_decode_threads = decode_threads;
+         }
+
+         /**
+          * Maintain a hash of the object database, updated with every change and recorded after every block, and
+          * log it every @p log_interval blocks, 0 to not log it. Must be called before open().
+          */
+         inline void track_state_hash( uint32_t log_interval )
+         {
+            object_database::enable_state_hash();
+            _state_hash_log_interval = log_interval;
+         }
+
+         /// @return the state hash as of the head block, ignoring pending transactions, see track_state_hash()
+         const block_state_hash& get_block_state_hash()const
+         {
+            FC_ASSERT( state_hash_enabled(), "State hash tracking is not enabled" );
+            return _block_state_hash;
+         }
+
+         /**
+          * Experimental: before applying a block, verify the authorities of its transactions in parallel, grouping
+          * transactions that touch the same accounts on the same thread. Verifications which could be affected by
+          * transactions earlier in the block are redone when the transaction is applied, so the result is the same
+          * as with serial execution.
+          */
+         inline void enable_optimistic_execution( bool enable ) { _optimistic_execution = enable; }
+
+         const optimistic_execution_stats& get_optimistic_execution_stats()const { return _optimistic_stats; }
+
+         /// Apply the credits of a limit order sweep to the taker once at its end (the default) rather than per fill,
+         /// the resulting state is the same. Disabling it is meant for comparing both in benchmarks.
+         inline void enable_taker_fill_batching( bool enable ) { _batch_taker_fills = enable; }
+
+         /**
+          * Remember up to @p max_entries successful authority verifications of pushed transactions, so they are not
+          * verified again when the transactions are included in a block on top of the same head block. 0 disables
+          * the cache, which is the default.
+          */
+         inline void set_authority_cache_size( size_t max_entries ) { _authority_cache.set_max_size( max_entries ); }
+
+         authority_cache_stats get_authority_cache_stats()const { return _authority_cache.get_stats(); }
+
+         /**
+          * Keep what applying a block did in its fork database item, so that a fork switch back to its branch applies
+          * the recorded changes instead of executing the block again. The changes are recorded before applied_block
+          * is emitted, and reused blocks emit applied_block with the recorded operations, so its handlers make their
+          * own changes as usual. Costs a copy of the objects every block modifies, for as long as it is reversible.
+          */
+         inline void enable_fork_change_reuse( bool enable ) { _reuse_fork_changes = enable; }
+
+         const fork_switch_stats& get_fork_switch_stats()const { return _fork_switch_stats; }
+
+         /// Limit the pending transactions to @p max_bytes in total and @p max_per_account per fee payer, 0 for no limit
+         inline void set_mempool_limits( uint64_t max_bytes, uint32_t max_per_account )
+         { _pending_tx.set_limits( max_bytes, max_per_account ); }
+
+         /// Write a state snapshot to @p dir whenever the last irreversible block passes a multiple of @p interval,
+         /// 0 to disable. The state is serialized to memory between blocks, which holds up block processing for
+         /// about as long as copying the state takes. Hashing and writing the file is done in another thread.
+         inline void set_state_snapshots( const fc::path& dir, uint32_t interval )
+         {
+            _state_snapshot_dir = dir;
+            _state_snapshot_interval = interval;
+         }
+
          /** Precomputes digests, signatures and operation validations depending
           *  on skip flags. "Expensive" computations may be done in a parallel
-          *  thread.
+          *  thread. Transaction validation, packed sizes, IDs, signature keys and
+          *  merkle digests are cached on the block, so apply_block does not redo them.
           *
           * @param block the block to preprocess
           * @param skip indicates which computations can be skipped
@@ -606,6 +796,8 @@ namespace graphene { namespace chain {
    private:
          template<typename Trx>
          void _precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const;
+         /// Performs the precomputations of precompute_parallel() for @p block in the calling thread
+         void precompute_block( const signed_block& block, const uint32_t skip )const;
 
    protected:
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
@@ -613,6 +805,13 @@ namespace graphene { namespace chain {
          void notify_applied_block( const signed_block& block );
          void notify_on_pending_transaction( const signed_transaction& tx );
          void notify_changed_objects();
+         /// Writes a state snapshot if one is due, called between blocks
+         void check_state_snapshot();
+         /// Packs the state at the last irreversible block to @p out
+         /// @return the number of the last irreversible block
+         uint32_t pack_state_snapshot( snapshot_writer& out )const;
+         /// Records the state hash of the head block if state hashing is enabled
+         void update_block_state_hash();
 
       private:
          optional<undo_database::session>       _pending_tx_session;
@@ -631,7 +830,23 @@ namespace graphene { namespace chain {
 
       private:
          void                  _apply_block( const signed_block& next_block );
-         processed_transaction _apply_transaction( const signed_transaction& trx );
+
+         /// Pop the head block in a fork switch
+         void                  pop_block_for_fork_switch();
+         /// Push @p item in a fork switch, applying its recorded changes if it has any, see enable_fork_change_reuse()
+         void                  push_block_for_fork_switch( fork_item& item, uint32_t skip );
+         /// @param consulted if given, receives the accounts whose authorities were consulted
+         processed_transaction _apply_transaction( const signed_transaction& trx,
+                                                   flat_set<account_id_type>* consulted = nullptr );
+
+         /// Check the signatures of @p trx against the authorities of its accounts, and collect the accounts whose
+         /// authorities were consulted into @p consulted if given
+         void                  verify_transaction_authority( const signed_transaction& trx,
+                                                             flat_set<account_id_type>* consulted = nullptr )const;
+         struct speculative_authority_check;
+         /// Verify the authorities of all transactions in @p block in parallel, see enable_optimistic_execution()
+         void                  speculate_authorities( const signed_block& block,
+                                                      vector<speculative_authority_check>& checks )const;
          void                  _cancel_bids_and_revive_mpa( const asset_object& bitasset, const asset_bitasset_data_object& bad );
 
          /// Validate, evaluate and apply a virtual operation using a temporary undo_database session,
@@ -655,6 +870,9 @@ namespace graphene { namespace chain {
          //////////////////// db_update.cpp ////////////////////
       public:
          generic_operation_result process_tickets();
+         /// @return counters of the deadlines that gate the expiration sweeps, see expiration_wheel
+         expiration_wheel_stats get_expiration_wheel_stats()const
+         { return _expiration_wheel.get_stats(); }
       private:
          void update_global_dynamic_data( const signed_block& b, const uint32_t missed_blocks );
          void update_signing_witness(const witness_object& signing_witness, const signed_block& new_block);
@@ -694,7 +912,20 @@ namespace graphene { namespace chain {
          ///@}
          ///@}
 
-         vector< processed_transaction >        _pending_tx;
+         mempool                                _pending_tx;
+         /// How many of _pending_tx were applied in _pending_tx_session, the union of the skip flags they were
+         /// pushed with, and the undo database change count after the last one. _generate_block() uses the pending
+         /// state as is instead of re-applying _pending_tx when none of these changed in between.
+         size_t                                 _pending_tx_applied = 0;
+         uint32_t                               _pending_tx_skip = 0;
+         uint64_t                               _pending_tx_change_count = 0;
+         /// Accounts possibly modified in _pending_tx_session, whether a pending transaction executed proposals, which
+         /// may modify any account, and the first account created in it. Authority verifications which depend on
+         /// none of these hold on top of the head block and go to _authority_cache.
+         flat_set<account_id_type>              _pending_tx_modified_accounts;
+         bool                                   _pending_tx_executes_proposals = false;
+         account_id_type                        _pending_tx_first_new_account;
+         authority_cache                        _authority_cache;
          fork_database                          _fork_db;
 
          /**
@@ -737,6 +968,38 @@ namespace graphene { namespace chain {
          /// Set it to true to provide accurate data to API clients, set to false to have better performance.
          bool                              _track_standby_votes = true;
 
+         /// Number of blocks between log lines with the memory usage of the object database, 0 for none
+         uint32_t                          _memory_usage_log_interval = 0;
+
+         /// Number of blocks read ahead during replay, and threads unpacking them (0 for automatic)
+         uint32_t                          _reindex_queue_depth = 256;
+         uint32_t                          _reindex_decode_threads = 0;
+
+         /// Where and how often state snapshots are written, see set_state_snapshots()
+         fc::path                          _state_snapshot_dir;
+         uint32_t                          _state_snapshot_interval = 0;
+         /// Last irreversible block when snapshots were last checked for
+         uint32_t                          _last_state_snapshot_check = 0;
+         /// Writes the file of the last state snapshot, in a thread of the parallel pool
+         fc::future<void>                  _state_snapshot_write;
+
+         /// State hash as of the head block, and the number of blocks between log lines with it
+         block_state_hash                  _block_state_hash;
+         uint32_t                          _state_hash_log_interval = 0;
+
+         /// Whether transaction authorities are verified ahead of applying blocks, see enable_optimistic_execution()
+         bool                              _optimistic_execution = false;
+         optimistic_execution_stats        _optimistic_stats;
+
+         /// Whether the credits of a limit order sweep are applied once, see enable_taker_fill_batching()
+         bool                              _batch_taker_fills = true;
+
+         /// Whether what applying blocks did is recorded for fork switches, see enable_fork_change_reuse()
+         bool                              _reuse_fork_changes = false;
+         /// Recorded by _apply_block for the fork item of the block
+         shared_ptr< const block_changes > _applied_block_changes;
+         fork_switch_stats                 _fork_switch_stats;
+
          fc::hash_ctr_rng<secret_hash_type, 20> _random_number_generator;
           bool                              _slow_replays = false;
 
@@ -765,6 +1028,15 @@ namespace graphene { namespace chain {
          const witness_schedule_object*         _p_witness_schedule_obj    = nullptr;
          ///@}
 
+         /// The order book kept alongside the limit order index, for matching
+         const limit_order_book_index*          _limit_order_book          = nullptr;
+         /// Assets whose margin calls need no check, kept up to date by observers of the order and bitasset indexes
+         margin_call_watermarks                 _margin_call_watermarks;
+         /// Deadlines of the objects that the per block sweeps expire
+         expiration_wheel                       _expiration_wheel;
+         /// Active lotteries by end date and the supply of NFT lotteries
+         lottery_schedule                       _lottery_schedule;
+
           /// Whether or not to allow safety check bypassing (for unit testing only)
          bool _allow_safety_check_bypass;
          /// Safety check policy for object space 1
@@ -818,3 +1090,5 @@ namespace graphene { namespace chain {
    }
 
 } }
+
+FC_REFLECT( graphene::chain::block_state_hash, (block_num)(block_id)(state_hash)(indexes) )
@@ -68,7 +68,7 @@ struct skip_flags_restorer
  */
 struct pending_transactions_restorer
 {
-   pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions )
+   pending_transactions_restorer( database& db, mempool&& pending_transactions )
       : _db(db), _pending_transactions( std::move(pending_transactions) )
    {
       _db.clear_pending();
@@ -86,22 +86,23 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
-      for( const processed_transaction& tx : _pending_transactions )
+      _pending_transactions.remove_expired( _db.head_block_time() );
+      _pending_transactions.for_each( [this]( const mempool_entry& entry )
       {
          try
          {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               _db._push_transaction( tx );
+            if( !_db.is_known_transaction( entry.id ) ) {
+               _db._push_transaction( entry.trx );
             }
          }
          catch( const fc::exception& )
          { // ignore invalid transactions
          }
-      }
+      });
    }
 
    database& _db;
-   std::vector< processed_transaction > _pending_transactions;
+   mempool   _pending_transactions;
 };
 
 /**
@@ -123,19 +124,19 @@ void with_skip_flags(
 }
 
 /**
- * Empty pending_transactions, call callback,
- * then reset pending_transactions after callback is done.
+ * Empty pending_transactions, call callback with the set aside
+ * transactions, then reset pending_transactions after callback is done.
  *
- * Pending transactions which no longer validate will be culled.
+ * Pending transactions which expired or no longer validate will be culled.
  */
 template< typename Lambda >
 void without_pending_transactions(
    database& db,
-   std::vector<processed_transaction>&& pending_transactions,
+   mempool&& pending_transactions,
    Lambda callback )
 {
     pending_transactions_restorer restorer( db, std::move(pending_transactions) );
-    callback();
+    callback( restorer._pending_transactions );
     return;
 }
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/index_observer.hpp>
+#include <graphene/chain/types.hpp>
+
+#include <array>
+#include <set>
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+   /** Counters of the expiration wheel, see database::get_expiration_wheel_stats */
+   struct expiration_wheel_stats
+   {
+      uint64_t size = 0;
+      uint64_t due = 0;
+      /// sweeps run because objects of their type were due, and sweeps skipped because none was
+      uint64_t sweeps = 0;
+      uint64_t skipped_sweeps = 0;
+   };
+
+   /**
+    * @brief Hierarchical timing wheel of the deadlines of objects, to tell which per block sweeps have work to do
+    *
+    * The wheel has 4 levels of 64 slots. A slot of level n spans 64^n seconds, and deadlines farther than 64^4
+    * seconds away wait in an overflow set. Moving the wheel forward by a second empties one slot of level 0 and,
+    * once per 64^n seconds, spreads one slot of level n over the levels below, so that the work done is in
+    * proportion to the deadlines passed rather than to the number of deadlines. Large steps, such as the first
+    * one after the state is loaded, rebuild the wheel instead.
+    *
+    * Objects whose deadline passed are counted by object type until they are removed or get a new deadline.
+    * Deadlines are reported by an index_observer of each index, see margin_call_watermarks, with the key extractor
+    * of the deadline that the expiration index of the objects uses. When the head block time goes back, deadlines
+    * between it and the wheel time stay due, which only costs the sweeps of their types a needless look at their
+    * index.
+    */
+   class expiration_wheel
+   {
+      public:
+         /// Sets the deadline of the object @p id, replacing any previous one. The maximum time means none.
+         void insert( object_id_type id, time_point_sec deadline );
+         void remove( object_id_type id );
+
+         /// For index_observer
+         void added( const object& obj, time_point_sec deadline ) { insert( obj.id, deadline ); }
+         void removed( const object& obj, time_point_sec ) { remove( obj.id ); }
+
+         /**
+          * @brief Moves the wheel to @p now if it is behind
+          * @return true if an object of the given type may have a deadline no later than @p now, false if none has
+          */
+         bool has_due( time_point_sec now, uint8_t space_id, uint8_t type_id );
+         template<typename ObjectType>
+         bool has_due( time_point_sec now )
+         {
+            return has_due( now, ObjectType::space_id, ObjectType::type_id );
+         }
+
+         void clear();
+
+         expiration_wheel_stats get_stats()const;
+
+      private:
+         static constexpr uint32_t slot_bits = 6;
+         static constexpr uint32_t slot_count = 1 << slot_bits;
+         static constexpr uint8_t  level_count = 4;
+         /// values of entry::level besides the wheel levels
+         static constexpr uint8_t  overflow_level = level_count;
+         static constexpr uint8_t  due_level = level_count + 1;
+
+         struct entry
+         {
+            uint32_t deadline = 0;
+            uint8_t  level = due_level;
+            uint8_t  slot = 0;
+            /// position in the slot
+            uint32_t position = 0;
+         };
+
+         void advance( uint32_t now );
+         void tick();
+         void cascade( uint8_t level, uint32_t slot );
+         void rebuild( uint32_t now );
+         void place( object_id_type id, entry& e );
+         void unplace( object_id_type id, const entry& e );
+
+         std::vector<object_id_type>& slot_of( uint8_t level, uint32_t slot )
+         {
+            return _slots[ level * slot_count + slot ];
+         }
+
+         std::unordered_map< object_id_type, entry >                _entries;
+         std::array< std::vector<object_id_type>, level_count * slot_count > _slots;
+         std::set< std::pair<uint32_t, object_id_type> >            _overflow;
+         /// number of due objects by object_id_type::space_type()
+         flat_map< uint16_t, uint32_t >                             _due;
+         /// the wheel time, in seconds since the epoch
+         uint32_t                                                   _now = 0;
+         uint64_t                                                   _sweeps = 0;
+         uint64_t                                                   _skipped_sweeps = 0;
+   };
+
+} } // graphene::chain
@@ -26,6 +26,11 @@
 #include <graphene/protocol/block.hpp>
 
 #include <graphene/chain/types.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <graphene/db/undo_database.hpp>
+
+#include <fc/crypto/hash_ctr_rng.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
@@ -37,6 +42,22 @@ namespace graphene { namespace chain {
    using boost::multi_index_container;
    using namespace boost::multi_index;
 
+   /**
+    * What applying a block did, kept so that it can be pushed again after a fork switch popped it without executing
+    * it, see database::enable_fork_change_reuse
+    */
+   struct block_changes
+   {
+      explicit block_changes( const fc::hash_ctr_rng<secret_hash_type, 20>& rng ):random_number_generator(rng){}
+
+      /// the changes of the block itself, recorded before the handlers of applied_block made theirs
+      graphene::db::redo_state                        changes;
+      /// the operations of the block, for the handlers of applied_block
+      vector< optional< operation_history_object > >  applied_ops;
+      /// the random number generator as the block left it
+      fc::hash_ctr_rng<secret_hash_type, 20>          random_number_generator;
+   };
+
    struct fork_item
    {
       fork_item( signed_block d )
@@ -53,6 +74,9 @@ namespace graphene { namespace chain {
       shared_ptr< vector< pair< witness_id_type, public_key_type > > > scheduled_witnesses;
       uint64_t                                                         next_block_aslot = 0;
       fc::time_point_sec                                               next_block_time;
+
+      /// What applying the block did, set when the block is applied with fork change reuse enabled
+      shared_ptr< const block_changes >                                changes;
    };
    typedef shared_ptr<fork_item> item_ptr;
 
@@ -26,6 +26,7 @@
 #include <graphene/protocol/chain_parameters.hpp>
 #include <graphene/chain/types.hpp>
 #include <graphene/db/object.hpp>
+#include <graphene/db/field_undo.hpp>
 
 namespace graphene { namespace chain {
 
@@ -47,6 +48,9 @@ namespace graphene { namespace chain {
          vector<committee_member_id_type>   active_committee_members; // updated once per maintenance interval
          flat_set<witness_id_type>          active_witnesses; // updated once per maintenance interval
          // n.b. witness scheduling is done by witness_schedule object
+
+         // the fee schedule in parameters is large, only keep the fields that changed in the undo history
+         GRAPHENE_DECLARE_FIELD_UNDO()
    };
 
    /**
@@ -116,6 +120,9 @@ namespace graphene { namespace chain {
              */
             maintenance_flag = 0x01
          };
+
+         // modified by every block, only keep the changed fields in the undo history
+         GRAPHENE_DECLARE_FIELD_UNDO()
    };
 }}
 
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/db/index.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    * @brief Reports the objects of one index to @p Target, which keeps a summary of them alongside the index
+    *
+    * Target::added is called with an object when it is inserted and after it is modified, Target::removed when it
+    * is removed and before it is modified. Each call also passes the keys of the object extracted by @p Keys, if
+    * any, so the target does not need to know where to find them.
+    */
+   template<typename ObjectType, typename Target, typename... Keys>
+   class index_observer : public secondary_index
+   {
+      public:
+         explicit index_observer( Target* target ) : _target( target ) {}
+
+         virtual void object_inserted( const object& obj ) override
+         {
+            added( static_cast<const ObjectType&>( obj ) );
+         }
+         virtual void object_removed( const object& obj ) override
+         {
+            removed( static_cast<const ObjectType&>( obj ) );
+         }
+         virtual void about_to_modify( const object& before ) override
+         {
+            removed( static_cast<const ObjectType&>( before ) );
+         }
+         virtual void object_modified( const object& after ) override
+         {
+            added( static_cast<const ObjectType&>( after ) );
+         }
+
+      private:
+         void added( const ObjectType& obj )   { _target->added( obj, Keys()( obj )... ); }
+         void removed( const ObjectType& obj ) { _target->removed( obj, Keys()( obj )... ); }
+
+         Target* _target;
+   };
+
+} } // graphene::chain
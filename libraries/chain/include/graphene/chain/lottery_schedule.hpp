@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/index_observer.hpp>
+#include <graphene/chain/types.hpp>
+
+#include <map>
+#include <set>
+
+namespace graphene { namespace chain {
+   class asset_object;
+   class nft_metadata_object;
+   class nft_object;
+
+   /**
+    * @brief The active lotteries that may end, by end date, and the supply of the NFT lotteries
+    *
+    * database::check_ending_lotteries and database::check_ending_nft_lotteries ask it for the lotteries to end
+    * instead of scanning all active lotteries every block, and the NFT lotteries ending when sold out are told
+    * from the number of their tokens counted here, without counting the tokens every block.
+    *
+    * Changes are reported by an index_observer of each index, see margin_call_watermarks.
+    */
+   class lottery_schedule
+   {
+      public:
+         /// @return an active asset lottery of the latest end date no later than @p now, if any
+         optional<asset_id_type> latest_ending_asset_lottery( time_point_sec now )const;
+         /**
+          * @return an active NFT lottery of the latest end date among those that end by @p now or are sold out,
+          * if any; lotteries without an end date come last
+          */
+         optional<nft_metadata_id_type> latest_ending_nft_lottery( time_point_sec now )const;
+         /// @return true if @p lottery is active, ends when sold out and all its tokens are issued
+         bool is_sold_out( nft_metadata_id_type lottery )const;
+         /// @return the number of tokens of @p metadata, the same as nft_metadata_object::get_token_current_supply
+         uint64_t get_token_supply( nft_metadata_id_type metadata )const;
+
+         void added( const asset_object& asset );
+         void removed( const asset_object& asset );
+         void added( const nft_metadata_object& metadata );
+         void removed( const nft_metadata_object& metadata );
+         void added( const nft_object& token );
+         void removed( const nft_object& token );
+
+         void clear();
+
+      private:
+         struct nft_supply
+         {
+            uint64_t       supply = 0;
+            /// whether the lottery is active and ends when sold out
+            bool           watched = false;
+            share_type     max_supply;
+            time_point_sec end_date;
+         };
+
+         void update_sold_out( nft_metadata_id_type metadata, const nft_supply& s );
+
+         std::set< std::pair<time_point_sec, asset_id_type> >        _asset_end_dates;
+         std::set< std::pair<time_point_sec, nft_metadata_id_type> > _nft_end_dates;
+         std::map< nft_metadata_id_type, nft_supply >                _nft_supply;
+         /// the sold out lotteries, by end date
+         std::set< std::pair<time_point_sec, nft_metadata_id_type> > _nft_sold_out;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/index_observer.hpp>
+#include <graphene/chain/types.hpp>
+#include <graphene/protocol/asset.hpp>
+
+namespace graphene { namespace chain {
+   class limit_order_object;
+   class call_order_object;
+   class asset_bitasset_data_object;
+
+   /** Counters of the margin call watermarks, see database::get_margin_call_watermarks */
+   struct margin_call_watermark_stats
+   {
+      uint64_t size = 0;
+      uint64_t skipped = 0;
+   };
+
+   /**
+    * @brief The market issued assets whose margin calls are known to need no check
+    *
+    * When database::check_call_orders finds that neither the feed nor the best bid reach the least collateralized
+    * call order of an asset, it records the lowest price a limit order selling the asset for its backing asset
+    * would need to change that, which is the watermark. The checks of the asset are skipped until a limit order
+    * at or above the watermark, a call order of the asset or its bitasset data changes.
+    *
+    * Changes are reported by an index_observer of each of these indexes rather than by the code that changes the
+    * objects, so changes that are undone or loaded from disk are seen as well, and the watermarks stay valid
+    * whatever the order the state changes in. The other summaries kept alongside indexes, such as expiration_wheel
+    * and lottery_schedule, are kept up to date the same way.
+    */
+   class margin_call_watermarks
+   {
+      public:
+         /// @return true if the margin calls of @p mia need no check, counting it as skipped
+         bool can_skip( asset_id_type mia );
+         /// Records that the margin calls of @p watermark.base need no check until the watermark is reached
+         void set( const price& watermark );
+
+         void changed( const limit_order_object& order );
+         void changed( const call_order_object& call );
+         void changed( const asset_bitasset_data_object& bitasset );
+
+         /// For index_observer, any change of an object may reach or move a watermark
+         template<typename ObjectType>
+         void added( const ObjectType& obj ) { changed( obj ); }
+         template<typename ObjectType>
+         void removed( const ObjectType& obj ) { changed( obj ); }
+
+         void clear();
+
+         margin_call_watermark_stats get_stats()const;
+
+      private:
+         /// watermark by debt asset, in the sell price orientation of the limit orders it concerns
+         flat_map< asset_id_type, price > _watermarks;
+         uint64_t                         _skipped = 0;
+   };
+
+} } // graphene::chain
@@ -29,6 +29,8 @@
 
 #include <boost/multi_index/composite_key.hpp>
 
+#include <deque>
+
 namespace graphene { namespace chain {
 
 using namespace graphene::db;
@@ -107,6 +109,59 @@ typedef multi_index_container<
 
 typedef generic_index<limit_order_object, limit_order_multi_index_type> limit_order_index;
 
+/**
+ * @brief A secondary index of limit orders by market side and price, for matching and order book queries
+ *
+ * A side holds the orders selling one asset for another. Its price levels are kept in an array ordered from the
+ * worst to the best price, so that the best level is at the back, and each level keeps the orders at its price
+ * oldest first with their total amount for sale. Orders come in the same order as in the by_price index of
+ * limit_order_index, but finding and walking the best orders of a side does not search a tree.
+ */
+class limit_order_book_index : public secondary_index
+{
+   public:
+      struct price_level
+      {
+         price                                   level_price;
+         share_type                              for_sale;
+         /// matching removes the oldest orders, a deque does not move the rest
+         std::deque<const limit_order_object*>   orders;
+      };
+      typedef std::vector<price_level> side_type;
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after ) override;
+      virtual size_t memory_usage()const override;
+
+      /// @return the price levels of the orders selling @p sell for @p receive, best last, nullptr if there are none
+      const side_type* find_side( asset_id_type sell, asset_id_type receive )const;
+      /// @return the first order selling @p sell for @p receive, nullptr if there is none
+      const limit_order_object* best_order( asset_id_type sell, asset_id_type receive )const;
+
+      /// Calls @p visit for the orders selling @p sell for @p receive from the best one on, until it returns false
+      template<typename Visitor>
+      void visit_side( asset_id_type sell, asset_id_type receive, Visitor&& visit )const
+      {
+         const side_type* side = find_side( sell, receive );
+         if( side == nullptr ) return;
+         for( auto level = side->rbegin(); level != side->rend(); ++level )
+            for( const limit_order_object* order : level->orders )
+               if( !visit( *order ) )
+                  return;
+      }
+
+   private:
+      void insert_order( const limit_order_object& order );
+      void remove_order( const limit_order_object& order, const price& sell_price, share_type for_sale );
+
+      flat_map< std::pair<asset_id_type, asset_id_type>, side_type > _sides;
+      /// the price and amount of the order being modified
+      price                                                     _price_before;
+      share_type                                                _for_sale_before;
+};
+
 /**
  * @class call_order_object
  * @brief tracks debt and call price information
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/protocol/transaction.hpp>
+
+#include <graphene/chain/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <queue>
+
+namespace graphene { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   /** A pending transaction together with the properties the mempool orders and limits it by */
+   struct mempool_entry
+   {
+      processed_transaction trx;
+      transaction_id_type   id;
+      account_id_type       fee_payer;
+      fc::time_point_sec    expiration;
+      /// Packed size of the transaction in bytes
+      uint64_t              size = 0;
+      /// Fees of the transaction in core asset units per kilobyte
+      uint64_t              fee_per_kb = 0;
+      /// Arrival order, assigned by the mempool
+      uint64_t              sequence = 0;
+   };
+
+   /**
+    * @brief The pending transactions of a node
+    *
+    * Transactions are kept in the order they arrived in, which is the order they were applied to the pending state
+    * in. When there is not enough room for all of them, block generation takes them by decreasing fee per kilobyte,
+    * keeping the transactions of each fee payer in arrival order.
+    *
+    * The total size of the transactions and the number of transactions per fee payer can be limited. A transaction
+    * which does not fit evicts transactions paying less per kilobyte.
+    */
+   class mempool
+   {
+      public:
+         /**
+          * @param max_bytes the maximum total size of the transactions, 0 for no limit
+          * @param max_per_account the maximum number of transactions paid for by one account, 0 for no limit
+          */
+         void set_limits( uint64_t max_bytes, uint32_t max_per_account );
+
+         /**
+          * Checks that @p entry can be added, throws if its fee payer has too many pending transactions or if no
+          * room can be made for it.
+          * @return the transactions which must be removed to make room for @p entry
+          */
+         vector<transaction_id_type> make_room( const mempool_entry& entry )const;
+
+         /// Adds @p entry after the transactions already in the pool
+         void insert( mempool_entry entry );
+         /// Removes the transactions with ID @p id, @return whether there were any
+         bool remove( const transaction_id_type& id );
+         /// Removes the transactions expiring before @p now, @return how many were removed
+         size_t remove_expired( fc::time_point_sec now );
+         void clear();
+
+         const mempool_entry* find( const transaction_id_type& id )const;
+         size_t   size()const { return _entries.size(); }
+         bool     empty()const { return _entries.empty(); }
+         uint64_t total_bytes()const { return _total_bytes; }
+
+         /// Calls @p visit for every transaction in arrival order
+         template<typename Visitor>
+         void for_each( Visitor&& visit )const
+         {
+            for( const mempool_entry& entry : _entries.get<by_sequence>() )
+               visit( entry );
+         }
+
+         /// Calls @p visit for every transaction by decreasing fee per kilobyte, keeping the transactions of each fee
+         /// payer in arrival order
+         template<typename Visitor>
+         void for_each_by_priority( Visitor&& visit )const
+         {
+            const auto& by_payer = _entries.get<by_fee_payer>();
+            using payer_iterator = typename std::decay<decltype(by_payer)>::type::const_iterator;
+            auto lower_priority = []( payer_iterator a, payer_iterator b ) {
+               return a->fee_per_kb < b->fee_per_kb || ( a->fee_per_kb == b->fee_per_kb && a->sequence > b->sequence );
+            };
+            // the next transaction of every fee payer
+            std::priority_queue<payer_iterator, vector<payer_iterator>, decltype(lower_priority)> next( lower_priority );
+            for( auto itr = by_payer.begin(); itr != by_payer.end();
+                 itr = by_payer.upper_bound( boost::make_tuple( itr->fee_payer ) ) )
+               next.push( itr );
+            while( !next.empty() )
+            {
+               payer_iterator itr = next.top();
+               next.pop();
+               visit( *itr );
+               payer_iterator following = std::next( itr );
+               if( following != by_payer.end() && following->fee_payer == itr->fee_payer )
+                  next.push( following );
+            }
+         }
+
+      private:
+         struct by_id;
+         struct by_sequence;
+         struct by_priority;
+         struct by_expiration;
+         struct by_fee_payer;
+         typedef multi_index_container<
+            mempool_entry,
+            indexed_by<
+               // not unique: with skip_transaction_dupe_check, the same transaction can be pending twice
+               hashed_non_unique< tag<by_id>, member< mempool_entry, transaction_id_type, &mempool_entry::id >,
+                                  std::hash<transaction_id_type> >,
+               ordered_unique< tag<by_sequence>, member< mempool_entry, uint64_t, &mempool_entry::sequence > >,
+               ordered_unique< tag<by_priority>,
+                  composite_key< mempool_entry,
+                     member< mempool_entry, uint64_t, &mempool_entry::fee_per_kb >,
+                     member< mempool_entry, uint64_t, &mempool_entry::sequence >
+                  >,
+                  composite_key_compare< std::greater<uint64_t>, std::less<uint64_t> >
+               >,
+               ordered_non_unique< tag<by_expiration>,
+                                   member< mempool_entry, fc::time_point_sec, &mempool_entry::expiration > >,
+               ordered_unique< tag<by_fee_payer>,
+                  composite_key< mempool_entry,
+                     member< mempool_entry, account_id_type, &mempool_entry::fee_payer >,
+                     member< mempool_entry, uint64_t, &mempool_entry::sequence >
+                  >
+               >
+            >
+         > entry_index_type;
+
+         entry_index_type _entries;
+         uint64_t         _total_bytes = 0;
+         uint64_t         _next_sequence = 0;
+         uint64_t         _max_bytes = 0;
+         uint32_t         _max_per_account = 0;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/lottery_schedule.hpp>
+
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/nft_object.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+/// @return the last element of @p dates not later than @p now
+template<typename IdType>
+optional< std::pair<time_point_sec, IdType> > latest_until( const std::set< std::pair<time_point_sec, IdType> >& dates,
+                                                           time_point_sec now )
+{
+   auto itr = dates.lower_bound( std::make_pair( now + 1, IdType() ) );
+   if( itr == dates.begin() )
+      return {};
+   return *std::prev( itr );
+}
+
+} // anonymous namespace
+
+optional<asset_id_type> lottery_schedule::latest_ending_asset_lottery( time_point_sec now )const
+{
+   const auto ending = latest_until( _asset_end_dates, now );
+   if( !ending.valid() )
+      return {};
+   return ending->second;
+}
+
+optional<nft_metadata_id_type> lottery_schedule::latest_ending_nft_lottery( time_point_sec now )const
+{
+   auto ending = latest_until( _nft_end_dates, now );
+   if( !_nft_sold_out.empty() && ( !ending.valid() || ending->first < _nft_sold_out.rbegin()->first ) )
+      ending = *_nft_sold_out.rbegin();
+   if( !ending.valid() )
+      return {};
+   return ending->second;
+}
+
+bool lottery_schedule::is_sold_out( nft_metadata_id_type lottery )const
+{
+   auto itr = _nft_supply.find( lottery );
+   return itr != _nft_supply.end()
+          && _nft_sold_out.find( std::make_pair( itr->second.end_date, lottery ) ) != _nft_sold_out.end();
+}
+
+uint64_t lottery_schedule::get_token_supply( nft_metadata_id_type metadata )const
+{
+   auto itr = _nft_supply.find( metadata );
+   return itr == _nft_supply.end() ? 0 : itr->second.supply;
+}
+
+void lottery_schedule::added( const asset_object& asset )
+{
+   if( asset.is_lottery() && asset.lottery_options->is_active && asset.lottery_options->end_date != time_point_sec() )
+      _asset_end_dates.emplace( asset.lottery_options->end_date, asset.get_id() );
+}
+
+void lottery_schedule::removed( const asset_object& asset )
+{
+   if( asset.is_lottery() )
+      _asset_end_dates.erase( std::make_pair( asset.lottery_options->end_date, asset.get_id() ) );
+}
+
+void lottery_schedule::added( const nft_metadata_object& metadata )
+{
+   if( !metadata.is_lottery() || !metadata.lottery_data->lottery_options.is_active )
+      return;
+   const auto& options = metadata.lottery_data->lottery_options;
+   if( options.end_date != time_point_sec() )
+      _nft_end_dates.emplace( options.end_date, metadata.get_id() );
+   if( options.ending_on_soldout )
+   {
+      auto& s = _nft_supply[ metadata.get_id() ];
+      s.watched = true;
+      s.max_supply = metadata.max_supply;
+      s.end_date = options.end_date;
+      update_sold_out( metadata.get_id(), s );
+   }
+}
+
+void lottery_schedule::removed( const nft_metadata_object& metadata )
+{
+   if( !metadata.is_lottery() )
+      return;
+   _nft_end_dates.erase( std::make_pair( metadata.lottery_data->lottery_options.end_date, metadata.get_id() ) );
+   auto itr = _nft_supply.find( metadata.get_id() );
+   if( itr == _nft_supply.end() || !itr->second.watched )
+      return;
+   itr->second.watched = false;
+   update_sold_out( metadata.get_id(), itr->second );
+   if( itr->second.supply == 0 )
+      _nft_supply.erase( itr );
+}
+
+void lottery_schedule::added( const nft_object& token )
+{
+   auto& s = _nft_supply[ token.nft_metadata_id ];
+   ++s.supply;
+   update_sold_out( token.nft_metadata_id, s );
+}
+
+void lottery_schedule::removed( const nft_object& token )
+{
+   auto itr = _nft_supply.find( token.nft_metadata_id );
+   if( itr == _nft_supply.end() || itr->second.supply == 0 ) // should not happen
+      return;
+   --itr->second.supply;
+   update_sold_out( token.nft_metadata_id, itr->second );
+   if( itr->second.supply == 0 && !itr->second.watched )
+      _nft_supply.erase( itr );
+}
+
+void lottery_schedule::clear()
+{
+   _asset_end_dates.clear();
+   _nft_end_dates.clear();
+   _nft_supply.clear();
+   _nft_sold_out.clear();
+}
+
+void lottery_schedule::update_sold_out( nft_metadata_id_type metadata, const nft_supply& s )
+{
+   const auto key = std::make_pair( s.end_date, metadata );
+   if( s.watched && s.max_supply.value == int64_t( s.supply ) )
+      _nft_sold_out.insert( key );
+   else
+      _nft_sold_out.erase( key );
+}
+
+} } // graphene::chain
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/margin_call_watermarks.hpp>
+
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/market_object.hpp>
+
+namespace graphene { namespace chain {
+
+bool margin_call_watermarks::can_skip( asset_id_type mia )
+{
+   if( _watermarks.find( mia ) == _watermarks.end() )
+      return false;
+   ++_skipped;
+   return true;
+}
+
+void margin_call_watermarks::set( const price& watermark )
+{
+   _watermarks[ watermark.base.asset_id ] = watermark;
+}
+
+void margin_call_watermarks::changed( const limit_order_object& order )
+{
+   auto itr = _watermarks.find( order.sell_asset_id() );
+   if( itr == _watermarks.end() || order.receive_asset_id() != itr->second.quote.asset_id )
+      return;
+   // orders below the watermark neither meet a margin call nor support a call order against a black swan
+   if( !( order.sell_price < itr->second ) )
+      _watermarks.erase( itr );
+}
+
+void margin_call_watermarks::changed( const call_order_object& call )
+{
+   _watermarks.erase( call.debt_type() );
+}
+
+void margin_call_watermarks::changed( const asset_bitasset_data_object& bitasset )
+{
+   _watermarks.erase( bitasset.asset_id );
+}
+
+void margin_call_watermarks::clear()
+{
+   _watermarks.clear();
+   _skipped = 0;
+}
+
+margin_call_watermark_stats margin_call_watermarks::get_stats()const
+{
+   margin_call_watermark_stats result;
+   result.size = _watermarks.size();
+   result.skipped = _skipped;
+   return result;
+}
+
+} } // graphene::chain
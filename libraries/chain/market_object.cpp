@@ -26,6 +26,7 @@
 
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include <algorithm>
 #include <functional>
 
 #include <fc/io/raw.hpp>
@@ -289,6 +290,123 @@ share_type call_order_object::get_max_debt_to_cover( price match_price,
 
 } FC_CAPTURE_AND_RETHROW( (*this)(feed_price)(match_price)(maintenance_collateral_ratio) ) }
 
+namespace graphene { namespace chain {
+
+namespace {
+   /// Levels are ordered by increasing price
+   bool level_price_less( const limit_order_book_index::price_level& level, const price& p )
+   {
+      return level.level_price < p;
+   }
+
+   bool order_id_less( const limit_order_object* order, object_id_type id )
+   {
+      return order->id < id;
+   }
+}
+
+void limit_order_book_index::insert_order( const limit_order_object& order )
+{
+   side_type& side = _sides[ std::make_pair( order.sell_asset_id(), order.receive_asset_id() ) ];
+   auto level = std::lower_bound( side.begin(), side.end(), order.sell_price, level_price_less );
+   if( level == side.end() || order.sell_price < level->level_price )
+   {
+      level = side.emplace( level );
+      level->level_price = order.sell_price;
+   }
+   level->for_sale += order.for_sale;
+   // new orders have the greatest ids, they go to the end
+   if( level->orders.empty() || level->orders.back()->id < order.id )
+      level->orders.push_back( &order );
+   else
+      level->orders.insert( std::lower_bound( level->orders.begin(), level->orders.end(), order.id, order_id_less ),
+                            &order );
+}
+
+void limit_order_book_index::remove_order( const limit_order_object& order, const price& sell_price,
+                                           share_type for_sale )
+{
+   auto side = _sides.find( std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id ) );
+   FC_ASSERT( side != _sides.end(), "Removing unknown limit order ${id}", ("id",order.id) );
+   auto level = std::lower_bound( side->second.begin(), side->second.end(), sell_price, level_price_less );
+   FC_ASSERT( level != side->second.end() && !( sell_price < level->level_price ),
+              "Removing unknown limit order ${id}", ("id",order.id) );
+   auto itr = std::lower_bound( level->orders.begin(), level->orders.end(), order.id, order_id_less );
+   FC_ASSERT( itr != level->orders.end() && *itr == &order, "Removing unknown limit order ${id}", ("id",order.id) );
+   level->orders.erase( itr );
+   if( level->orders.empty() )
+      side->second.erase( level );
+   else
+      level->for_sale -= for_sale;
+}
+
+void limit_order_book_index::object_inserted( const object& obj )
+{
+   insert_order( static_cast<const limit_order_object&>( obj ) );
+}
+
+void limit_order_book_index::object_removed( const object& obj )
+{
+   const auto& order = static_cast<const limit_order_object&>( obj );
+   remove_order( order, order.sell_price, order.for_sale );
+}
+
+void limit_order_book_index::about_to_modify( const object& before )
+{
+   const auto& order = static_cast<const limit_order_object&>( before );
+   _price_before = order.sell_price;
+   _for_sale_before = order.for_sale;
+}
+
+void limit_order_book_index::object_modified( const object& after )
+{
+   const auto& order = static_cast<const limit_order_object&>( after );
+   if( order.sell_price.base == _price_before.base && order.sell_price.quote == _price_before.quote )
+   {
+      // fills only change the amount for sale
+      auto side = _sides.find( std::make_pair( order.sell_asset_id(), order.receive_asset_id() ) );
+      FC_ASSERT( side != _sides.end(), "Modifying unknown limit order ${id}", ("id",order.id) );
+      auto level = std::lower_bound( side->second.begin(), side->second.end(), order.sell_price, level_price_less );
+      FC_ASSERT( level != side->second.end() && !( order.sell_price < level->level_price ),
+                 "Modifying unknown limit order ${id}", ("id",order.id) );
+      level->for_sale += order.for_sale - _for_sale_before;
+      return;
+   }
+   remove_order( order, _price_before, _for_sale_before );
+   insert_order( order );
+}
+
+size_t limit_order_book_index::memory_usage()const
+{
+   size_t result = _sides.capacity() * sizeof( *_sides.begin() );
+   for( const auto& side : _sides )
+   {
+      result += side.second.capacity() * sizeof( price_level );
+      for( const auto& level : side.second )
+         result += level.orders.size() * sizeof( const limit_order_object* );
+   }
+   return result;
+}
+
+const limit_order_book_index::side_type* limit_order_book_index::find_side( asset_id_type sell,
+                                                                            asset_id_type receive )const
+{
+   auto itr = _sides.find( std::make_pair( sell, receive ) );
+   if( itr == _sides.end() || itr->second.empty() )
+      return nullptr;
+   return &itr->second;
+}
+
+const limit_order_object* limit_order_book_index::best_order( asset_id_type sell, asset_id_type receive )const
+{
+   const side_type* side = find_side( sell, receive );
+   if( side == nullptr )
+      return nullptr;
+   return side->back().orders.front();
+}
+
+} } // graphene::chain
+
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::limit_order_object,
                     (graphene::db::object),
                     (expiration)(seller)(for_sale)(sell_price)(deferred_fee)(deferred_paid_fee)
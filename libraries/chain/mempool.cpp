@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/mempool.hpp>
+
+namespace graphene { namespace chain {
+
+void mempool::set_limits( uint64_t max_bytes, uint32_t max_per_account )
+{
+   _max_bytes = max_bytes;
+   _max_per_account = max_per_account;
+}
+
+vector<transaction_id_type> mempool::make_room( const mempool_entry& entry )const
+{
+   if( _max_per_account > 0 )
+   {
+      const auto& by_payer = _entries.get<by_fee_payer>();
+      auto range = by_payer.equal_range( boost::make_tuple( entry.fee_payer ) );
+      FC_ASSERT( static_cast<uint64_t>( std::distance( range.first, range.second ) ) < _max_per_account,
+                 "Account ${a} has too many pending transactions", ("a",entry.fee_payer)("max",_max_per_account) );
+   }
+
+   vector<transaction_id_type> evicted;
+   if( _max_bytes == 0 || _total_bytes + entry.size <= _max_bytes )
+      return evicted;
+
+   FC_ASSERT( entry.size <= _max_bytes, "Transaction is larger than the mempool",
+              ("size",entry.size)("max",_max_bytes) );
+   uint64_t remaining = _total_bytes;
+   const auto& by_prio = _entries.get<by_priority>();
+   for( auto itr = by_prio.rbegin(); remaining + entry.size > _max_bytes; ++itr )
+   {
+      FC_ASSERT( itr->fee_per_kb < entry.fee_per_kb,
+                 "Mempool is full and the transaction does not pay more than the pending ones",
+                 ("fee_per_kb",entry.fee_per_kb)("lowest",itr->fee_per_kb) );
+      evicted.push_back( itr->id );
+      remaining -= itr->size;
+   }
+   return evicted;
+}
+
+void mempool::insert( mempool_entry entry )
+{
+   entry.sequence = _next_sequence++;
+   _total_bytes += entry.size;
+   _entries.insert( std::move(entry) );
+}
+
+bool mempool::remove( const transaction_id_type& id )
+{
+   auto& by_trx_id = _entries.get<by_id>();
+   auto range = by_trx_id.equal_range( id );
+   if( range.first == range.second )
+      return false;
+   for( auto itr = range.first; itr != range.second; ++itr )
+      _total_bytes -= itr->size;
+   by_trx_id.erase( range.first, range.second );
+   return true;
+}
+
+size_t mempool::remove_expired( fc::time_point_sec now )
+{
+   auto& by_exp = _entries.get<by_expiration>();
+   const auto end = by_exp.lower_bound( now );
+   size_t removed = 0;
+   for( auto itr = by_exp.begin(); itr != end; ++removed )
+   {
+      _total_bytes -= itr->size;
+      itr = by_exp.erase( itr );
+   }
+   return removed;
+}
+
+void mempool::clear()
+{
+   _entries.clear();
+   _total_bytes = 0;
+}
+
+const mempool_entry* mempool::find( const transaction_id_type& id )const
+{
+   const auto& by_trx_id = _entries.get<by_id>();
+   auto itr = by_trx_id.find( id );
+   return itr == by_trx_id.end() ? nullptr : &*itr;
+}
+
+} } // graphene::chain
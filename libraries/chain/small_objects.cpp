@@ -116,6 +116,8 @@ FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::dynamic_global_property_object,
                     (dynamic_flags)
                     (last_irreversible_block_num)
                   )
+GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS( graphene::chain::dynamic_global_property_object, (random) )
+GRAPHENE_IMPLEMENT_FIELD_UNDO( graphene::chain::dynamic_global_property_object )
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::global_property_object, (graphene::db::object),
                     (parameters)
@@ -125,6 +127,8 @@ FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::global_property_object, (graphe
                     (active_witnesses)
                   )
 
+GRAPHENE_IMPLEMENT_FIELD_UNDO( graphene::chain::global_property_object )
+
 FC_REFLECT( graphene::chain::htlc_object::transfer_info,
    (from) (to) (amount) (asset_id) )
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::htlc_object::condition_info::hash_lock_info, BOOST_PP_SEQ_NIL,
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <fc/exception/exception.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @brief The pre-modification values of the reflected fields of one object
+    *
+    * Objects that opt in to field level undo are not cloned by undo_database when they are modified, the packed
+    * values of their reflected fields are recorded instead. When the undo state is committed the fields that were
+    * not changed are dropped from the record, so the undo history only keeps the fields that were modified.
+    *
+    * Every field is stored as [uint16_t index][uint32_t size][packed value], in ascending order of the index of the
+    * field in the reflection of the object.
+    */
+   struct field_undo_record
+   {
+      static constexpr size_t entry_header_size = sizeof(uint16_t) + sizeof(uint32_t);
+
+      /** iterates the fields of a record in ascending index order */
+      class reader
+      {
+         public:
+            explicit reader( const field_undo_record& record ):_data(record.data) { load(); }
+
+            bool        valid()const { return _pos < _data.size(); }
+            uint16_t    index()const { return _index; }
+            const char* value()const { return _data.data() + _pos + entry_header_size; }
+            uint32_t    size()const  { return _size; }
+            void        next()       { _pos += entry_header_size + _size; load(); }
+
+         private:
+            void load()
+            {
+               if( !valid() ) return;
+               memcpy( &_index, _data.data() + _pos, sizeof(_index) );
+               memcpy( &_size, _data.data() + _pos + sizeof(_index), sizeof(_size) );
+            }
+
+            const std::vector<char>& _data;
+            size_t                   _pos = 0;
+            uint16_t                 _index = 0;
+            uint32_t                 _size = 0;
+      };
+
+      /** appends a field header to @p out and returns a pointer to the @p size bytes reserved for its value */
+      static char* append( std::vector<char>& out, uint16_t index, uint32_t size )
+      {
+         size_t pos = out.size();
+         out.resize( pos + entry_header_size + size );
+         memcpy( out.data() + pos, &index, sizeof(index) );
+         memcpy( out.data() + pos + sizeof(index), &size, sizeof(size) );
+         return out.data() + pos + entry_header_size;
+      }
+
+      /**
+       * Adds the fields of @p other that are not in this record. Used to merge the record of an undo state with the
+       * record of the state that follows it, the values of this record are older and take precedence.
+       */
+      void add_missing( const field_undo_record& other )
+      {
+         if( complete ) return;
+         std::vector<char> merged;
+         merged.reserve( data.size() + other.data.size() );
+         reader mine( *this );
+         reader theirs( other );
+         while( mine.valid() || theirs.valid() )
+         {
+            bool take_mine = mine.valid() && ( !theirs.valid() || mine.index() <= theirs.index() );
+            reader& src = take_mine ? mine : theirs;
+            memcpy( append( merged, src.index(), src.size() ), src.value(), src.size() );
+            if( take_mine && theirs.valid() && theirs.index() == mine.index() )
+               theirs.next();
+            src.next();
+         }
+         data = std::move( merged );
+         complete = other.complete;
+      }
+
+      bool empty()const { return data.empty(); }
+
+      std::vector<char> data;
+      /** true if every reflected field of the object is in the record, i.e. it was not trimmed yet */
+      bool              complete = false;
+   };
+
+   namespace detail {
+
+      template<typename T>
+      struct field_capture_visitor
+      {
+         field_capture_visitor( const T& o, const field_undo_record& r, std::vector<char>& out )
+         :obj(o),existing(r),result(out) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            if( existing.valid() && existing.index() == which )
+            {
+               memcpy( field_undo_record::append( result, which, existing.size() ), existing.value(), existing.size() );
+               existing.next();
+            }
+            else
+            {
+               uint32_t size = fc::raw::pack_size( obj.*member );
+               fc::datastream<char*> ds( field_undo_record::append( result, which, size ), size );
+               fc::raw::pack( ds, obj.*member );
+            }
+            ++which;
+         }
+
+         const T&                          obj;
+         mutable field_undo_record::reader existing;
+         std::vector<char>&                result;
+         mutable uint16_t                  which = 0;
+      };
+
+      template<typename T>
+      struct field_trim_visitor
+      {
+         field_trim_visitor( const T& o, const field_undo_record& r, std::vector<char>& out )
+         :obj(o),recorded(r),result(out) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            if( recorded.valid() && recorded.index() == which )
+            {
+               bool changed = ( fc::raw::pack_size( obj.*member ) != recorded.size() );
+               if( !changed )
+               {
+                  scratch.resize( recorded.size() );
+                  fc::datastream<char*> ds( scratch.data(), scratch.size() );
+                  fc::raw::pack( ds, obj.*member );
+                  changed = ( memcmp( scratch.data(), recorded.value(), scratch.size() ) != 0 );
+               }
+               if( changed )
+                  memcpy( field_undo_record::append( result, which, recorded.size() ), recorded.value(),
+                          recorded.size() );
+               recorded.next();
+            }
+            ++which;
+         }
+
+         const T&                          obj;
+         mutable field_undo_record::reader recorded;
+         std::vector<char>&                result;
+         mutable std::vector<char>         scratch;
+         mutable uint16_t                  which = 0;
+      };
+
+      template<typename T>
+      struct field_restore_visitor
+      {
+         field_restore_visitor( T& o, const field_undo_record& r ):obj(o),recorded(r) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            if( recorded.valid() && recorded.index() == which )
+            {
+               fc::datastream<const char*> ds( recorded.value(), recorded.size() );
+               fc::raw::unpack( ds, obj.*member );
+               recorded.next();
+            }
+            ++which;
+         }
+
+         T&                                obj;
+         mutable field_undo_record::reader recorded;
+         mutable uint16_t                  which = 0;
+      };
+
+   } // detail
+
+   /**
+    * Data members of T that are left out of its reflection, recorded after the reflected ones. Specialized by
+    * GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS.
+    */
+   template<typename T>
+   struct field_undo_extra_members
+   {
+      template<typename Visitor>
+      static void visit( const Visitor& ) {}
+   };
+
+   /**
+    * Implements field level undo for the reflected fields of T, instantiated by GRAPHENE_IMPLEMENT_FIELD_UNDO in the
+    * translation unit that contains the reflection of T.
+    */
+   template<typename T>
+   struct field_undo
+   {
+      /** records the current value of every field of @p obj that is not in @p record yet */
+      static void capture( const T& obj, field_undo_record& record )
+      {
+         if( record.complete ) return;
+         std::vector<char> result;
+         result.reserve( record.data.size() );
+         visit( detail::field_capture_visitor<T>( obj, record, result ) );
+         record.data = std::move( result );
+         record.complete = true;
+      }
+
+      /** drops the fields of @p record that still hold the value of @p obj */
+      static void trim( const T& obj, field_undo_record& record )
+      {
+         if( !record.complete ) return;
+         std::vector<char> result;
+         visit( detail::field_trim_visitor<T>( obj, record, result ) );
+         record.data = std::move( result );
+         record.complete = false;
+      }
+
+      /** sets the fields of @p obj that are in @p record to their recorded value */
+      static void restore( T& obj, const field_undo_record& record )
+      {
+         visit( detail::field_restore_visitor<T>( obj, record ) );
+      }
+
+   private:
+      template<typename Visitor>
+      static void visit( const Visitor& visitor )
+      {
+         fc::reflector<T>::visit( visitor );
+         field_undo_extra_members<T>::visit( visitor );
+      }
+   };
+
+} } // graphene::db
+
+/**
+ * Opts an object type in to field level undo, to be used in the class body. Every data member must either be
+ * reflected or be listed with GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS, other members are not restored on undo.
+ */
+#define GRAPHENE_DECLARE_FIELD_UNDO() \
+   bool field_undo_enabled()const override { return true; } \
+   void capture_fields( graphene::db::field_undo_record& record )const override; \
+   void trim_fields( graphene::db::field_undo_record& record )const override; \
+   void restore_fields( const graphene::db::field_undo_record& record ) override;
+
+/** Implements the members declared by GRAPHENE_DECLARE_FIELD_UNDO, to be used after FC_REFLECT of the type */
+#define GRAPHENE_IMPLEMENT_FIELD_UNDO( type ) \
+   void type::capture_fields( graphene::db::field_undo_record& record )const \
+   { graphene::db::field_undo<type>::capture( *this, record ); } \
+   void type::trim_fields( graphene::db::field_undo_record& record )const \
+   { graphene::db::field_undo<type>::trim( *this, record ); } \
+   void type::restore_fields( const graphene::db::field_undo_record& record ) \
+   { graphene::db::field_undo<type>::restore( *this, record ); }
+
+#define GRAPHENE_FIELD_UNDO_EXTRA_MEMBER( r, type, member ) \
+   visitor.template operator()< decltype(type::member), type, &type::member >( BOOST_PP_STRINGIZE(member) );
+
+/**
+ * Lists the data members of an object type that are not reflected, so that field level undo restores them too. To
+ * be used at global scope before GRAPHENE_IMPLEMENT_FIELD_UNDO of the type.
+ */
+#define GRAPHENE_FIELD_UNDO_EXTRA_MEMBERS( type, members ) \
+namespace graphene { namespace db { \
+   template<> struct field_undo_extra_members< type > \
+   { \
+      template<typename Visitor> \
+      static void visit( const Visitor& visitor ) \
+      { BOOST_PP_SEQ_FOR_EACH( GRAPHENE_FIELD_UNDO_EXTRA_MEMBER, type, members ) } \
+   }; \
+} }
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/protocol/object_id.hpp>
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @class flat_id_map
+    * @brief An open addressing hash map keyed by object id
+    *
+    * Entries are stored inline in a single vector and collisions are resolved by linear probing, erase shifts
+    * the following entries back instead of leaving tombstones. Lookups touch a single cache line in the common
+    * case and inserting does not allocate a node per entry, which matters for the undo states that are filled
+    * for every object touched in a block.
+    *
+    * Iteration order is unspecified. Inserting invalidates iterators and references, erasing invalidates them
+    * as well.
+    */
+   template<typename Value>
+   class flat_id_map
+   {
+      public:
+         typedef object_id_type                  key_type;
+         typedef Value                           mapped_type;
+         typedef std::pair<object_id_type,Value> value_type;
+
+      private:
+         struct slot
+         {
+            bool       used = false;
+            value_type item;
+         };
+
+         template<typename SlotVector, typename Item>
+         class basic_iterator
+         {
+            public:
+               typedef std::forward_iterator_tag iterator_category;
+               typedef Item                      value_type;
+               typedef std::ptrdiff_t            difference_type;
+               typedef Item*                     pointer;
+               typedef Item&                     reference;
+
+               basic_iterator( SlotVector* slots, size_t pos ):_slots(slots),_pos(pos) { skip_unused(); }
+
+               reference operator*()const  { return (*_slots)[_pos].item; }
+               pointer   operator->()const { return &(*_slots)[_pos].item; }
+               basic_iterator& operator++()   { ++_pos; skip_unused(); return *this; }
+               basic_iterator  operator++(int){ basic_iterator tmp(*this); ++(*this); return tmp; }
+               friend bool operator==( const basic_iterator& a, const basic_iterator& b ) { return a._pos == b._pos; }
+               friend bool operator!=( const basic_iterator& a, const basic_iterator& b ) { return a._pos != b._pos; }
+
+            private:
+               void skip_unused()
+               {
+                  while( _pos < _slots->size() && !(*_slots)[_pos].used )
+                     ++_pos;
+               }
+
+               SlotVector* _slots;
+               size_t      _pos;
+         };
+
+      public:
+         typedef basic_iterator<std::vector<slot>, value_type>             iterator;
+         typedef basic_iterator<const std::vector<slot>, const value_type> const_iterator;
+
+         iterator       begin()       { return iterator( &_slots, 0 ); }
+         iterator       end()         { return iterator( &_slots, _slots.size() ); }
+         const_iterator begin()const  { return const_iterator( &_slots, 0 ); }
+         const_iterator end()const    { return const_iterator( &_slots, _slots.size() ); }
+
+         size_t size()const  { return _size; }
+         bool   empty()const { return _size == 0; }
+         /** @return bytes allocated for the table */
+         size_t memory_usage()const { return _slots.capacity() * sizeof(slot); }
+
+         void clear()
+         {
+            _slots.clear();
+            _size = 0;
+         }
+
+         iterator find( object_id_type key )
+         {
+            const size_t pos = lookup( key );
+            return iterator( &_slots, pos );
+         }
+         const_iterator find( object_id_type key )const
+         {
+            const size_t pos = lookup( key );
+            return const_iterator( &_slots, pos );
+         }
+         size_t count( object_id_type key )const { return lookup( key ) == _slots.size() ? 0 : 1; }
+
+         /** Inserts @p value unless @p key is present already, returns the entry and whether it was inserted */
+         std::pair<iterator,bool> emplace( object_id_type key, Value&& value )
+         {
+            size_t pos = lookup( key );
+            if( pos != _slots.size() )
+               return std::make_pair( iterator( &_slots, pos ), false );
+            pos = insert_new( key );
+            _slots[pos].item.second = std::move( value );
+            return std::make_pair( iterator( &_slots, pos ), true );
+         }
+
+         Value& operator[]( object_id_type key )
+         {
+            size_t pos = lookup( key );
+            if( pos == _slots.size() )
+               pos = insert_new( key );
+            return _slots[pos].item.second;
+         }
+
+         size_t erase( object_id_type key )
+         {
+            size_t pos = lookup( key );
+            if( pos == _slots.size() )
+               return 0;
+            const size_t mask = _slots.size() - 1;
+            // shift back following entries that would not be found any more with pos emptied
+            for( size_t next = (pos + 1) & mask; _slots[next].used; next = (next + 1) & mask )
+            {
+               const size_t home = bucket( _slots[next].item.first );
+               const bool movable = pos <= next ? ( home <= pos || home > next )
+                                                : ( home <= pos && home > next );
+               if( movable )
+               {
+                  _slots[pos].item = std::move( _slots[next].item );
+                  pos = next;
+               }
+            }
+            _slots[pos].used = false;
+            _slots[pos].item = value_type();
+            --_size;
+            return 1;
+         }
+
+      private:
+         size_t bucket( object_id_type key )const
+         {
+            // fibonacci hashing spreads the sequential instance numbers of one type over the table
+            return size_t( ( key.number * 0x9E3779B97F4A7C15ULL ) >> _shift );
+         }
+
+         /** @return the position of key or _slots.size() if it is not present */
+         size_t lookup( object_id_type key )const
+         {
+            if( _size == 0 )
+               return _slots.size();
+            const size_t mask = _slots.size() - 1;
+            for( size_t pos = bucket( key ); _slots[pos].used; pos = (pos + 1) & mask )
+               if( _slots[pos].item.first == key )
+                  return pos;
+            return _slots.size();
+         }
+
+         size_t insert_new( object_id_type key )
+         {
+            if( ( _size + 1 ) * 4 > _slots.size() * 3 )
+               grow();
+            const size_t mask = _slots.size() - 1;
+            size_t pos = bucket( key );
+            while( _slots[pos].used )
+               pos = (pos + 1) & mask;
+            _slots[pos].used = true;
+            _slots[pos].item.first = key;
+            ++_size;
+            return pos;
+         }
+
+         void grow()
+         {
+            std::vector<slot> old_slots( _slots.empty() ? 16 : _slots.size() * 2 );
+            old_slots.swap( _slots );
+            _shift = 64;
+            for( size_t capacity = _slots.size(); capacity > 1; capacity >>= 1 )
+               --_shift;
+            _size = 0;
+            for( auto& old : old_slots )
+               if( old.used )
+               {
+                  const size_t pos = insert_new( old.item.first );
+                  _slots[pos].item.second = std::move( old.item.second );
+               }
+         }
+
+         std::vector<slot> _slots;
+         size_t            _size  = 0;
+         unsigned          _shift = 64;
+   };
+
+   /**
+    * @class flat_id_set
+    * @brief A set of object ids with the storage of flat_id_map, iterating yields the ids
+    */
+   class flat_id_set
+   {
+         typedef flat_id_map<bool> map_type;
+
+      public:
+         class const_iterator
+         {
+            public:
+               typedef std::forward_iterator_tag iterator_category;
+               typedef object_id_type            value_type;
+               typedef std::ptrdiff_t            difference_type;
+               typedef const object_id_type*     pointer;
+               typedef const object_id_type&     reference;
+
+               explicit const_iterator( map_type::const_iterator itr ):_itr(itr) {}
+               reference operator*()const  { return _itr->first; }
+               pointer   operator->()const { return &_itr->first; }
+               const_iterator& operator++()   { ++_itr; return *this; }
+               const_iterator  operator++(int){ const_iterator tmp(*this); ++_itr; return tmp; }
+               friend bool operator==( const const_iterator& a, const const_iterator& b ) { return a._itr == b._itr; }
+               friend bool operator!=( const const_iterator& a, const const_iterator& b ) { return a._itr != b._itr; }
+
+            private:
+               map_type::const_iterator _itr;
+         };
+         typedef const_iterator iterator;
+
+         const_iterator begin()const { return const_iterator( _map.begin() ); }
+         const_iterator end()const   { return const_iterator( _map.end() ); }
+         const_iterator find( object_id_type id )const { return const_iterator( _map.find( id ) ); }
+
+         size_t size()const  { return _map.size(); }
+         bool   empty()const { return _map.empty(); }
+         size_t count( object_id_type id )const { return _map.count( id ); }
+         void   insert( object_id_type id ) { _map[id] = true; }
+         size_t erase( object_id_type id )  { return _map.erase( id ); }
+         size_t memory_usage()const          { return _map.memory_usage(); }
+         void   clear() { _map.clear(); }
+
+      private:
+         map_type _map;
+   };
+
+} } // graphene::db
@@ -27,6 +27,7 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
+#include <boost/mpl/size.hpp>
 
 namespace graphene { namespace db {
 
@@ -54,7 +55,20 @@ namespace graphene { namespace db {
             return *insert_result.first;
          }
 
-         virtual const object&  create(const std::function<void(object&)>& constructor )override
+         /**
+          * Inserts an object whose id is greater than the ids of all objects in the index, as when loading a
+          * saved index. The end of the container is used as insertion hint, so the id tree is not searched.
+          */
+         const object& insert_sorted( object&& obj )
+         {
+            assert( nullptr != dynamic_cast<ObjectType*>(&obj) );
+            const auto old_size = _indices.size();
+            auto itr = _indices.emplace_hint( _indices.end(), std::move( static_cast<ObjectType&>(obj) ) );
+            FC_ASSERT( _indices.size() > old_size, "Could not insert object, most likely a uniqueness constraint was violated" );
+            return *itr;
+         }
+
+         virtual const object&  create( const object_callback& constructor )override
          {
             ObjectType item;
             item.id = get_next_id();
@@ -65,7 +79,7 @@ namespace graphene { namespace db {
             return *insert_result.first;
          }
 
-         virtual void modify( const object& obj, const std::function<void(object&)>& m )override
+         virtual void modify( const object& obj, const object_callback& m )override
          {
             assert(nullptr != dynamic_cast<const ObjectType*>(&obj));
             std::exception_ptr exc;
@@ -110,6 +124,16 @@ namespace graphene { namespace db {
             } FC_CAPTURE_AND_RETHROW()
          }
 
+         virtual size_t object_count()const override { return _indices.size(); }
+
+         /** Every index of the container adds about three pointers to the node of an object */
+         virtual size_t object_memory_usage()const override
+         {
+            const size_t node_overhead = boost::mpl::size<typename MultiIndexType::index_type_list>::value
+                                         * 3 * sizeof(void*);
+            return _indices.size() * ( sizeof(ObjectType) + node_overhead );
+         }
+
          const index_type& indices()const { return _indices; }
 
       private:
@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/flat_id_map.hpp>
 #include <graphene/db/safety_check_policy.hpp>
 
 #include <fc/interprocess/file_mapping.hpp>
@@ -30,13 +31,31 @@
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
 
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <stack>
+#include <type_traits>
 
 namespace graphene { namespace db {
    class object_database;
+   class snapshot_writer;
+   struct rewound_state;
    using fc::path;
 
+   /** Object count and approximate memory usage of an index, see object_database::get_memory_usage */
+   struct index_memory_usage
+   {
+      uint8_t  space_id = 0;
+      uint8_t  type_id  = 0;
+      uint64_t object_count = 0;
+      /** the objects and the nodes of the containers holding them, memory owned by members of objects is excluded */
+      uint64_t object_bytes = 0;
+      /** secondary indexes that report their usage, such as direct_index and hashed_id_index */
+      uint64_t secondary_index_bytes = 0;
+   };
+
    /**
     * @class index_observer
     * @brief used to get callbacks when objects change
@@ -53,6 +72,30 @@ namespace graphene { namespace db {
          virtual void on_modify( const object& obj ){}
    };
 
+   /**
+    * @brief A non-owning reference to a callable that takes an object&
+    *
+    * The virtual create and modify methods of index take this instead of a std::function, so a lambda passed through
+    * them is neither copied nor allocated, and calling it is a single indirect call. The referenced callable must
+    * outlive the call it is passed to.
+    */
+   class object_callback
+   {
+      public:
+         template<typename Callable,
+                  typename = std::enable_if_t<!std::is_same<std::decay_t<Callable>, object_callback>::value>>
+         object_callback( Callable&& callable )
+         :_callable( const_cast<void*>( static_cast<const void*>( std::addressof( callable ) ) ) ),
+          _invoke( []( void* c, object& o ) { (*static_cast<std::remove_reference_t<Callable>*>( c ))( o ); } )
+         {}
+
+         void operator()( object& o )const { _invoke( _callable, o ); }
+
+      private:
+         void* _callable;
+         void (*_invoke)( void*, object& );
+   };
+
    /**
     *  @class index
     *  @brief abstract base class for accessing objects indexed in various ways.
@@ -92,13 +135,18 @@ namespace graphene { namespace db {
           * Builds a new object and assigns it the next available ID and then
           * initializes it with constructor and lastly inserts it into the index.
           */
-         virtual const object&  create( const std::function<void(object&)>& constructor ) = 0;
+         virtual const object&  create( const object_callback& constructor ) = 0;
 
          /**
           *  Opens the index loading objects from a file
           */
          virtual void open( const fc::path& db ) = 0;
          virtual void save( const fc::path& db ) = 0;
+         /**
+          * Packs the objects as they were in the earlier state described by @p rewound into a state snapshot, in the
+          * payload format of save() followed by an object size of 0
+          */
+         virtual void save_state( snapshot_writer& out, const rewound_state& rewound )const = 0;
 
 
 
@@ -116,7 +164,7 @@ namespace graphene { namespace db {
             return *maybe_found;
          }
 
-         virtual void               modify( const object& obj, const std::function<void(object&)>& ) = 0;
+         virtual void               modify( const object& obj, const object_callback& ) = 0;
          virtual void               remove( const object& obj ) = 0;
 
          /**
@@ -127,10 +175,18 @@ namespace graphene { namespace db {
           */
          template<typename Object, typename Lambda>
          void modify( const Object& obj, const Lambda& l ) {
-            modify( static_cast<const object&>(obj), std::function<void(object&)>( [&]( object& o ){ l( static_cast<Object&>(o) ); } ) );
+            auto typed = [&l]( object& o ){ l( static_cast<Object&>(o) ); };
+            modify( static_cast<const object&>(obj), object_callback( typed ) );
          }
 
          virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
+
+         /** @return the number of objects in the index */
+         virtual size_t             object_count()const = 0;
+         /** @return approximate bytes used by the objects and their containers, without memory owned by members */
+         virtual size_t             object_memory_usage()const = 0;
+         /** @return approximate bytes used by secondary indexes */
+         virtual size_t             secondary_index_memory_usage()const { return 0; }
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
          virtual void               object_from_variant( const fc::variant& var, object& obj, uint32_t max_depth )const = 0;
@@ -145,6 +201,8 @@ namespace graphene { namespace db {
          virtual void object_removed( const object& obj ){};
          virtual void about_to_modify( const object& before ){};
          virtual void object_modified( const object& after  ){};
+         /** @return approximate bytes used by this index, 0 if it does not keep track */
+         virtual size_t memory_usage()const { return 0; }
          // Called when an object from the current node session is created
          //virtual void object_created( const object& obj ){};
    };
@@ -168,6 +226,22 @@ namespace graphene { namespace db {
 
          /** called just after obj is modified */
          void on_modify( const object& obj );
+
+         /**
+          * @return true if objects were added, modified or removed since the index was last saved to or loaded
+          * from disk, object_database::flush only rewrites dirty indexes
+          */
+         bool is_dirty()const { return _dirty; }
+
+         /** @return the sum of the memory usage reported by the secondary indexes */
+         size_t secondary_indexes_memory_usage()const
+         {
+            size_t result = 0;
+            for( const auto& item : _sindex )
+               result += item->memory_usage();
+            return result;
+         }
+         void set_dirty( bool dirty ) { _dirty = dirty; }
          
          template<typename T, typename... Args>
          T* add_secondary_indexer(Args... args)
@@ -204,6 +278,7 @@ namespace graphene { namespace db {
       protected:
          vector< shared_ptr<index_observer> >   _observers;
          vector< unique_ptr<secondary_index> >  _sindex;
+         bool                                   _dirty = true;
 
       private:
          object_database& _db;
@@ -223,8 +298,11 @@ namespace graphene { namespace db {
    {
       static_assert( chunkbits < 64, "Do you really want arrays with more than 2^63 elements???" );
 
-      // private
+      public:
+         /** the most ids in a row that may be unused, loading an index with a larger gap fails */
          static const size_t MAX_HOLE = 100;
+
+      // private
          static const size_t _mask = ((1 << chunkbits) - 1);
          uint64_t next = 0;
          vector< vector< const Object* > > content;
@@ -265,13 +343,13 @@ namespace graphene { namespace db {
                   next++;
                }
             }
-            FC_ASSERT( nullptr != dynamic_cast<const Object*>(&obj), "Wrong object type!" );
+            assert( nullptr != dynamic_cast<const Object*>(&obj) );
             content[instance >> chunkbits][instance & _mask] = static_cast<const Object*>( &obj );
          }
 
          virtual void object_removed( const object& obj )
          {
-            FC_ASSERT( nullptr != dynamic_cast<const Object*>(&obj), "Wrong object type!" );
+            assert( nullptr != dynamic_cast<const Object*>(&obj) );
             uint64_t instance = obj.id.instance();
             FC_ASSERT( instance < next, "Removing out-of-range object: {id} > {next}!", ("id",obj.id)("next",next) );
             FC_ASSERT( content[instance >> chunkbits][instance & _mask], "Removing non-existent object {id}!", ("id",obj.id) );
@@ -289,6 +367,12 @@ namespace graphene { namespace db {
             ids_being_modified.pop();
          }
 
+         virtual size_t memory_usage()const override
+         {
+            return content.capacity() * sizeof( vector< const Object* > )
+                   + content.size() * ( size_t(1) << chunkbits ) * sizeof( const Object* );
+         }
+
          template< typename object_id >
          const Object* find( const object_id& id )const
          {
@@ -315,6 +399,133 @@ namespace graphene { namespace db {
          };
    };
 
+   /** @class hashed_id_index
+    *  @brief A secondary index that tracks objects in a hash table keyed by
+    *  object id. It gives constant time lookups by id for indexes whose id
+    *  space is too sparse for direct_index, e.g. orders that are created and
+    *  removed all the time.
+    */
+   template<typename Object>
+   class hashed_id_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override
+         {
+            auto result = _objects.emplace( obj.id, static_cast<const Object*>( &obj ) );
+            FC_ASSERT( result.second, "Overwriting insert at ${id}!", ("id",obj.id) );
+         }
+
+         virtual void object_removed( const object& obj ) override
+         {
+            FC_ASSERT( _objects.erase( obj.id ) == 1, "Removing non-existent object ${id}!", ("id",obj.id) );
+         }
+
+         const Object* find( const object_id_type& id )const
+         {
+            auto itr = _objects.find( id );
+            if( itr == _objects.end() ) return nullptr;
+            return itr->second;
+         }
+
+         size_t size()const { return _objects.size(); }
+
+         virtual size_t memory_usage()const override { return _objects.memory_usage(); }
+
+      private:
+         flat_id_map<const Object*> _objects;
+   };
+
+   /**
+    * @brief Writes an index to disk in the binary snapshot format read by primary_index::open
+    *
+    * File layout: magic (8 bytes), format version (4 bytes), the index payload, and a sha256 checksum of
+    * everything before it. The primary_index payload is the object version, the next object id, and the
+    * objects ordered by id, each prefixed by its packed size.
+    *
+    * Objects are packed straight into a preallocated buffer that is written out and folded into the checksum
+    * whenever it fills up, so no per-object vectors are allocated. A writer constructed without a file keeps the
+    * filled buffers in memory instead, to be written by write_file later, possibly in another thread.
+    */
+   class snapshot_writer
+   {
+      public:
+         /** Legacy files start with the next object id, whose top byte is a space id and never 0xff */
+         static const uint64_t magic          = 0xff5041534a424f47ULL;
+         static const uint32_t format_version = 2;
+         static const size_t   header_size    = sizeof(uint64_t) + sizeof(uint32_t);
+
+         snapshot_writer( const fc::path& file, size_t buffer_size = 16 * 1024 * 1024 );
+         /** Keeps the snapshot in memory, see release() */
+         explicit snapshot_writer( size_t buffer_size = 16 * 1024 * 1024 );
+
+         template<typename T>
+         void pack( const T& v )
+         {
+            const size_t size = fc::raw::pack_size( v );
+            fc::datastream<char*> ds( reserve( size ), size );
+            fc::raw::pack( ds, v );
+         }
+
+         /** Packs @p obj prefixed by its packed size */
+         template<typename T>
+         void pack_object( const T& obj )
+         {
+            const uint32_t size = fc::raw::pack_size( obj );
+            fc::datastream<char*> ds( reserve( sizeof(size) + size ), sizeof(size) + size );
+            fc::raw::pack( ds, size );
+            fc::raw::pack( ds, obj );
+         }
+
+         /** Appends @p size bytes that are already serialized */
+         void write( const char* data, size_t size ) { memcpy( reserve( size ), data, size ); }
+
+         /**
+          * Writes out the buffer and the checksum, the file is incomplete until this is called
+          * @return the checksum
+          */
+         fc::sha256 finish();
+
+         /** @return the snapshot kept in memory, to be passed to write_file */
+         vector< vector<char> > release();
+
+         /**
+          * Writes a snapshot returned by release() and its checksum to @p file
+          * @return the checksum
+          */
+         static fc::sha256 write_file( const fc::path& file, const vector< vector<char> >& chunks );
+
+         /** @return true if @p data starts with the snapshot header */
+         static bool is_snapshot( const char* data, size_t size );
+         /**
+          * Checks header and checksum of a snapshot, throws if the file is corrupted.
+          * @return the size of the data without the trailing checksum
+          */
+         static size_t verify( const char* data, size_t size );
+
+      private:
+         char* reserve( size_t size );
+         void  write_buffer();
+
+         std::ofstream          _out;
+         vector< vector<char> > _chunks;
+         vector<char>           _buffer;
+         size_t                 _used = 0;
+         fc::sha256::encoder    _checksum;
+   };
+
+   /**
+    * @brief Differences between the current state and an earlier one, see undo_database::rewind
+    *
+    * Both maps are ordered by id, so the objects of every index are contiguous and sorted by instance.
+    */
+   struct rewound_state
+   {
+      /** earlier versions of the objects that changed since, null for objects that did not exist yet */
+      std::map<object_id_type, std::unique_ptr<object>> objects;
+      /** earlier next ids of the indexes that created objects since, keyed by space and type with instance 0 */
+      std::map<object_id_type, object_id_type>          next_ids;
+   };
+
    /**
     * @class primary_index
     * @brief  Wraps a derived index to intercept calls to create, modify, and remove so that
@@ -343,16 +554,31 @@ namespace graphene { namespace db {
 
          virtual object_id_type get_next_id()const override              { return _next_id;    }
          virtual void           use_next_id()override                    { ++_next_id.number;  }
-         virtual void           set_next_id( object_id_type id )override { _next_id = id;      }
+         virtual void           set_next_id( object_id_type id )override { _next_id = id; _dirty = true; }
 
          /** @return the object with id or nullptr if not found */
          virtual const object*  find( object_id_type id )const override
          {
             if( DirectBits > 0 )
                return _direct_by_id->find( id );
+            if( _hashed_by_id != nullptr )
+               return _hashed_by_id->find( id );
             return DerivedIndex::find( id );
          }
 
+         /**
+          * Serves find() from a hash table instead of the ordered id index of DerivedIndex, for indexes with a sparse
+          * id space and many lookups by id. Indexes with DirectBits > 0 already have constant time lookups.
+          */
+         void enable_hashed_id_lookup()
+         {
+            static_assert( DirectBits == 0, "direct_index is used for lookups by id already" );
+            if( _hashed_by_id != nullptr ) return;
+            auto hashed = add_secondary_indexer< hashed_id_index< object_type > >();
+            this->inspect_all_objects( [hashed]( const object& o ) { hashed->object_inserted( o ); } );
+            _hashed_by_id = hashed;
+         }
+
          fc::sha256 get_object_version()const
          {
             std::string desc = "1.0";//get_type_description<object_type>();
@@ -364,47 +590,68 @@ namespace graphene { namespace db {
             if( !fc::exists( db ) ) return;
             fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
             fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
-            fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
-            fc::sha256 open_ver;
-
-            fc::raw::unpack(ds, _next_id);
-            fc::raw::unpack(ds, open_ver);
-            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            vector<char> tmp;
-            while( ds.remaining() > 0 )
-            {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
-            }
+            const char* data = (const char*)mr.get_address();
+            load_gaps gaps;
+            if( snapshot_writer::is_snapshot( data, mr.get_size() ) )
+               open_snapshot( data, mr.get_size(), gaps );
+            else
+               open_legacy( data, mr.get_size(), gaps );
+            if( DirectBits > 0 && gaps.unused * 4 > gaps.next )
+               wlog( "Index ${s}.${t} is sparse, ${u} of ${n} ids are unused and still take memory in direct_index",
+                     ("s",object_type::space_id)("t",object_type::type_id)("u",gaps.unused)("n",gaps.next) );
+            _dirty = false;
          }
 
          virtual void save( const path& db ) override 
          {
-            std::ofstream out( db.generic_string(), 
-                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
-            FC_ASSERT( out );
-            auto ver  = get_object_version();
-            fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
+            snapshot_writer out( db );
+            out.pack( get_object_version() );
+            out.pack( _next_id );
+            this->inspect_all_objects( [&]( const object& o ) {
+                out.pack_object( static_cast<const object_type&>(o) );
+            });
+            out.finish();
+         }
+
+         virtual void save_state( snapshot_writer& out, const rewound_state& rewound )const override
+         {
+            const object_id_type first( object_type::space_id, object_type::type_id, 0 );
+            const auto next_itr = rewound.next_ids.find( first );
+            out.pack( get_object_version() );
+            out.pack( next_itr != rewound.next_ids.end() ? next_itr->second : _next_id );
+
+            // merge the current objects with the earlier versions, both are sorted by id
+            auto itr = rewound.objects.lower_bound( first );
+            const auto end = rewound.objects.upper_bound( object_id_type( object_type::space_id, object_type::type_id,
+                                                                           GRAPHENE_DB_MAX_INSTANCE_ID ) );
+            auto pack_earlier = [&out]( const std::unique_ptr<object>& earlier ) {
+               if( earlier )
+                  out.pack_object( static_cast<const object_type&>( *earlier ) );
+            };
             this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+               for( ; itr != end && itr->first < o.id; ++itr )
+                  pack_earlier( itr->second );
+               if( itr != end && itr->first == o.id )
+                  pack_earlier( (itr++)->second );
+               else
+                  out.pack_object( static_cast<const object_type&>( o ) );
             });
+            for( ; itr != end; ++itr )
+               pack_earlier( itr->second );
+            out.pack( uint32_t(0) );
          }
 
          virtual const object&  load( const std::vector<char>& data )override
          {
             const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
+            notify_secondary_indexes( [&result]( secondary_index& item ) { item.object_inserted( result ); } );
             return result;
          }
 
 
-         virtual const object&  create(const std::function<void(object&)>& constructor )override
+         virtual const object&  create( const object_callback& constructor )override
          {
-            uint8_t type_id = object_type::type_id;
+#if GRAPHENE_DB_SAFETY_CHECKS
             try {
             FC_ASSERT(_check.allow_object_creation(_next_id),
                       "Safety Check: Creation of object ${ID} is not allowed", ("ID", _next_id));
@@ -412,12 +659,9 @@ namespace graphene { namespace db {
                // When debugging a safety check failure, throw a breakpoint here to see where it's coming from
                throw;
             }
+#endif
             const auto& result = DerivedIndex::create( constructor );
-            for( const auto& item : _sindex ) {
-               _check.pre_secondary_index_notification(type_id, *item);
-               item->object_inserted( result );
-               _check.post_secondary_index_notification(type_id, *item);
-            }
+            notify_secondary_indexes( [&result]( secondary_index& item ) { item.object_inserted( result ); } );
             on_add( result );
             return result;
          }
@@ -425,15 +669,14 @@ namespace graphene { namespace db {
          virtual const object& insert( object&& obj ) override
          {
             const auto& result = DerivedIndex::insert( std::move( obj ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
+            notify_secondary_indexes( [&result]( secondary_index& item ) { item.object_inserted( result ); } );
             on_add( result );
             return result;
          }
 
         virtual void  remove( const object& obj ) override
          {
-            uint8_t type_id = object_type::type_id;
+#if GRAPHENE_DB_SAFETY_CHECKS
             try {
             FC_ASSERT(_check.allow_object_deletion(_next_id), "Safety Check: Deletion of object ${ID} is not allowed",
                       ("ID", obj.id));
@@ -441,18 +684,15 @@ namespace graphene { namespace db {
                // When debugging a safety check failure, throw a breakpoint here to see where it's coming from
                 throw;
             }
-            for( const auto& item : _sindex ) {
-               _check.pre_secondary_index_notification(type_id, *item);
-               item->object_removed( obj );
-               _check.post_secondary_index_notification(type_id, *item);
-            }
+#endif
+            notify_secondary_indexes( [&obj]( secondary_index& item ) { item.object_removed( obj ); } );
             on_remove(obj);
             DerivedIndex::remove(obj);
          }
          
-         virtual void modify( const object& obj, const std::function<void(object&)>& m )override
+         virtual void modify( const object& obj, const object_callback& m )override
          {
-            uint8_t type_id = object_type::type_id;
+#if GRAPHENE_DB_SAFETY_CHECKS
             try {
             FC_ASSERT(_check.allow_object_modification(_next_id),
                       "Safety Check: Modification of object ${ID} is not allowed", ("ID", obj.id));
@@ -460,22 +700,20 @@ namespace graphene { namespace db {
                // When debugging a safety check failure, throw a breakpoint here to see where it's coming from
                 throw;
             }
+#endif
 
             save_undo( obj );
-            for( const auto& item : _sindex ) {
-               _check.pre_secondary_index_notification(type_id, *item);
-               item->about_to_modify( obj );
-               _check.post_secondary_index_notification(type_id, *item);
-            }
+            notify_secondary_indexes( [&obj]( secondary_index& item ) { item.about_to_modify( obj ); } );
             DerivedIndex::modify( obj, m );
-            for( const auto& item : _sindex ) {
-               _check.pre_secondary_index_notification(type_id, *item);
-               item->object_modified( obj );
-               _check.post_secondary_index_notification(type_id, *item);
-            }
+            notify_secondary_indexes( [&obj]( secondary_index& item ) { item.object_modified( obj ); } );
             on_modify( obj );
          }
 
+         virtual size_t secondary_index_memory_usage()const override
+         {
+            return secondary_indexes_memory_usage();
+         }
+
          virtual void add_observer( const shared_ptr<index_observer>& o ) override
          {
             _observers.emplace_back( o );
@@ -500,9 +738,99 @@ namespace graphene { namespace db {
          }
 
       private:
+         /** Calls @p notify for every secondary index, wrapped in the notifications of the safety check policy */
+         template<typename Notify>
+         void notify_secondary_indexes( const Notify& notify )
+         {
+#if GRAPHENE_DB_SAFETY_CHECKS
+            const uint8_t type_id = object_type::type_id;
+            for( const auto& item : _sindex ) {
+               _check.pre_secondary_index_notification(type_id, *item);
+               notify( *item );
+               _check.post_secondary_index_notification(type_id, *item);
+            }
+#else
+            for( const auto& item : _sindex )
+               notify( *item );
+#endif
+         }
+
+         /** ids skipped while loading an index, they take memory in direct_index */
+         struct load_gaps
+         {
+            uint64_t next   = 0;
+            uint64_t unused = 0;
+         };
+
+         /**
+          * Objects are loaded in id order. Fails with a clear message if a gap between ids is too large for
+          * direct_index, instead of an out-of-order insert error from the secondary index.
+          */
+         void check_gap( load_gaps& gaps, object_id_type id )const
+         {
+            if( DirectBits == 0 ) return;
+            const uint64_t instance = id.instance();
+            if( instance > gaps.next )
+            {
+               FC_ASSERT( instance - gaps.next <= direct_index< object_type, DirectBits >::MAX_HOLE,
+                          "Index ${s}.${t} has ${n} unused ids before ${id}, it is too sparse for direct_index",
+                          ("s",object_type::space_id)("t",object_type::type_id)("n",instance - gaps.next)("id",id) );
+               gaps.unused += instance - gaps.next;
+            }
+            gaps.next = instance + 1;
+         }
+
+         /** Loads the binary format written by save(), objects come sorted by id and are inserted in bulk */
+         void open_snapshot( const char* data, size_t size, load_gaps& gaps )
+         {
+            fc::datastream<const char*> ds( data, snapshot_writer::verify( data, size ) );
+            ds.skip( snapshot_writer::header_size );
+            fc::sha256 open_ver;
+            fc::raw::unpack(ds, open_ver);
+            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+            fc::raw::unpack(ds, _next_id);
+            while( ds.remaining() > 0 )
+            {
+               uint32_t object_size;
+               fc::raw::unpack( ds, object_size );
+               FC_ASSERT( object_size <= ds.remaining(), "Truncated object in index snapshot" );
+               fc::datastream<const char*> object_ds( ds.pos(), object_size );
+               object_type obj;
+               fc::raw::unpack( object_ds, obj );
+               ds.skip( object_size );
+               check_gap( gaps, obj.id );
+               const auto& result = DerivedIndex::insert_sorted( std::move( obj ) );
+               notify_secondary_indexes( [&result]( secondary_index& item ) { item.object_inserted( result ); } );
+            }
+         }
+
+         /** Loads the format used before snapshot_writer, with each object packed into a vector<char> */
+         void open_legacy( const char* data, size_t size, load_gaps& gaps )
+         {
+            fc::datastream<const char*> ds( data, size );
+            fc::sha256 open_ver;
+
+            fc::raw::unpack(ds, _next_id);
+            fc::raw::unpack(ds, open_ver);
+            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+            vector<char> tmp;
+            while( ds.remaining() > 0 )
+            {
+               fc::raw::unpack( ds, tmp );
+               object_type obj = fc::raw::unpack<object_type>( tmp );
+               check_gap( gaps, obj.id );
+               const auto& result = DerivedIndex::insert( std::move( obj ) );
+               notify_secondary_indexes( [&result]( secondary_index& item ) { item.object_inserted( result ); } );
+            }
+         }
+
          object_id_type                                 _next_id;
          const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
+         const hashed_id_index< object_type >*          _hashed_by_id = nullptr;
          safety_check_policy&                           _check;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::index_memory_usage,
+            (space_id)(type_id)(object_count)(object_bytes)(secondary_index_bytes) )
@@ -24,12 +24,18 @@
 #pragma once
 #include <boost/multiprecision/integer.hpp>
 #include <graphene/protocol/object_id.hpp>
+#include <graphene/db/undo_arena.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/crypto/city.hpp>
+#include <fc/crypto/sha256.hpp>
+
+#include <new>
 
 #define MAX_NESTING (200)
 
 namespace graphene { namespace db {
+   struct field_undo_record;
+
    /**
     *  @brief base for all database objects
     *
@@ -71,9 +77,21 @@ namespace graphene { namespace db {
          /// these methods are implemented for derived classes by inheriting base_abstract_object<DerivedClass>
          /// @{
          virtual std::unique_ptr<object> clone()const = 0;
+         /** copies the object into memory of @p arena, the caller is responsible for running the destructor */
+         virtual object*                 clone( undo_arena& arena )const = 0;
          virtual void                    move_from( object& obj ) = 0;
          virtual fc::variant             to_variant()const  = 0;
          virtual std::vector<char>       pack()const = 0;
+         /** @return the first 64 bits of the sha256 of the packed object, computed without packing into a buffer */
+         virtual uint64_t                digest()const = 0;
+         /// @}
+
+         /// field level undo, overridden by objects that opt in with GRAPHENE_DECLARE_FIELD_UNDO
+         /// @{
+         virtual bool field_undo_enabled()const { return false; }
+         virtual void capture_fields( field_undo_record& record )const {}
+         virtual void trim_fields( field_undo_record& record )const {}
+         virtual void restore_fields( const field_undo_record& record ) {}
          /// @}
    };
 
@@ -93,6 +111,11 @@ namespace graphene { namespace db {
          {
             return std::make_unique<DerivedClass>( *static_cast<const DerivedClass*>(this) );
          }
+         object* clone( undo_arena& arena )const override
+         {
+            return new( arena.allocate( sizeof(DerivedClass), alignof(DerivedClass) ) )
+                       DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
 
          void    move_from( object& obj ) override
          {
@@ -101,6 +124,12 @@ namespace graphene { namespace db {
          fc::variant to_variant()const override
          { return fc::variant( static_cast<const DerivedClass&>(*this), MAX_NESTING ); }
          std::vector<char> pack()const override { return fc::raw::pack( static_cast<const DerivedClass&>(*this) ); }
+         uint64_t digest()const override
+         {
+            fc::sha256::encoder enc;
+            fc::raw::pack( enc, static_cast<const DerivedClass&>(*this) );
+            return enc.result()._hash[0];
+         }
    };
 
    template<typename DerivedClass, uint8_t SpaceID, uint8_t TypeID>
@@ -25,6 +25,7 @@
 #include <graphene/db/object.hpp>
 #include <graphene/db/index.hpp>
 #include <graphene/db/undo_database.hpp>
+#include <graphene/db/state_hash.hpp>
 #include <graphene/db/safety_check_policy.hpp>
 
 #include <fc/log/logger.hpp>
@@ -33,6 +34,16 @@
 
 namespace graphene { namespace db {
 
+   /** Memory usage report of an object_database */
+   struct database_memory_usage
+   {
+      vector<index_memory_usage> indexes;
+      /** approximate bytes held by each undo state, oldest first */
+      vector<uint64_t>           undo_states;
+
+      uint64_t total_bytes()const;
+   };
+
    /**
     *   @class object_database
     *   @brief maintains a set of indexed objects that can be modified with multi-level rollback support
@@ -48,12 +59,25 @@ namespace graphene { namespace db {
          void open(const fc::path& data_dir );
 
          /**
-          * Saves the complete state of the object_database to disk, this could take a while
+          * Saves the complete state of the object_database to disk, this could take a while.
+          * Only indexes that changed since the last flush or open are serialized, the files of the others are
+          * hard linked (or copied) from the previous state.
           */
          void flush();
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
+         /**
+          * Packs all indexes, as they were before the newest @p undo_depth undo states, into a state snapshot.
+          * The state on disk and in memory is left untouched.
+          */
+         void save_state( snapshot_writer& out, size_t undo_depth )const;
+         /**
+          * Reads the indexes packed by save_state() from @p ds and writes them to @p data_dir in the format read
+          * by open(), replacing the object database stored there
+          */
+         static void restore_state( fc::datastream<const char*>& ds, const fc::path& data_dir );
+
          /**
           * @brief Allocate an object space, setting a safety check policy for that object space
           * @param space_id The ID of the object space to allocate
@@ -245,6 +269,20 @@ namespace graphene { namespace db {
 
          void pop_undo();
 
+         /** @return object count and approximate memory usage of every index and of the undo history */
+         database_memory_usage get_memory_usage()const;
+
+         /**
+          * Maintains a digest of every index from now on, see index_state_hasher. Indexes loaded by open() later are
+          * hashed once they are loaded.
+          */
+         void enable_state_hash();
+         bool state_hash_enabled()const { return !_state_hashers.empty(); }
+         /** @return the digests of all indexes ordered by space and type, state hashing must be enabled */
+         vector<index_state_digest> get_index_state_digests()const;
+         /** @return the sha256 of the digests of all indexes, state hashing must be enabled */
+         fc::sha256 get_state_hash()const;
+
          fc::path get_data_dir()const { return _data_dir; }
 
          /** public for testing purposes only... should be private in practice. */
@@ -261,6 +299,8 @@ namespace graphene { namespace db {
          index& get_mutable_index(uint8_t space_id, uint8_t type_id);
 
      private:
+         /** Puts the unchanged index file @p from of the previous state into the new state at @p to */
+         static void reuse_snapshot_file( const fc::path& from, const fc::path& to );
 
          friend class base_primary_index;
          friend class undo_database;
@@ -271,8 +311,11 @@ namespace graphene { namespace db {
          fc::path                                                  _data_dir;
          vector< std::unique_ptr<safety_check_policy> >            _safety_checks;
          vector< vector< unique_ptr<index> > >                     _index;
+         vector< shared_ptr<index_state_hasher> >                  _state_hashers;
    };
 
 } } // graphene::db
 
+FC_REFLECT( graphene::db::database_memory_usage, (indexes)(undo_states) )
+
 
@@ -25,6 +25,19 @@
 
 #include <graphene/protocol/object_id.hpp>
 
+/**
+ * primary_index only consults the safety check policy if this is nonzero. The checks guard against bugs during
+ * development and cost several virtual calls per object change, so they are compiled out of release builds unless
+ * enabled explicitly.
+ */
+#ifndef GRAPHENE_DB_SAFETY_CHECKS
+#  ifdef NDEBUG
+#    define GRAPHENE_DB_SAFETY_CHECKS 0
+#  else
+#    define GRAPHENE_DB_SAFETY_CHECKS 1
+#  endif
+#endif
+
 namespace graphene {
 namespace db {
 
@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/db/index.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace db {
 
    /**
@@ -40,7 +42,7 @@ namespace graphene { namespace db {
       public:
          typedef T object_type;
 
-         virtual const object&  create( const std::function<void(object&)>& constructor ) override
+         virtual const object&  create( const object_callback& constructor ) override
          {
              auto id = get_next_id();
              auto instance = id.instance();
@@ -53,7 +55,7 @@ namespace graphene { namespace db {
              return *_objects[instance];
          }
 
-         virtual void modify( const object& obj, const std::function<void(object&)>& modify_callback ) override
+         virtual void modify( const object& obj, const object_callback& modify_callback ) override
          {
             assert( obj.id.instance() < _objects.size() );
             modify_callback( *_objects[obj.id.instance()] );
@@ -69,6 +71,12 @@ namespace graphene { namespace db {
             return *_objects[instance];
          }
 
+         /** Objects are stored by instance, so loading a saved index needs no insertion hint */
+         const object& insert_sorted( object&& obj )
+         {
+            return simple_index::insert( std::move( obj ) );
+         }
+
          virtual void remove( const object& obj ) override
          {
             assert( nullptr != dynamic_cast<const T*>(&obj) );
@@ -88,6 +96,16 @@ namespace graphene { namespace db {
             return _objects[instance].get();
          }
 
+         virtual size_t object_count()const override
+         {
+            return std::count_if( _objects.begin(), _objects.end(), []( const unique_ptr<object>& o ) { return !!o; } );
+         }
+
+         virtual size_t object_memory_usage()const override
+         {
+            return _objects.capacity() * sizeof( unique_ptr<object> ) + object_count() * sizeof(T);
+         }
+
          virtual void inspect_all_objects(std::function<void (const object&)> inspector)const override
          {
             try {
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/db/index.hpp>
+#include <graphene/db/flat_id_map.hpp>
+
+namespace graphene { namespace db {
+
+   /** Digest of the objects in one index, see index_state_hasher */
+   struct index_state_digest
+   {
+      uint8_t  space_id = 0;
+      uint8_t  type_id  = 0;
+      uint64_t object_count = 0;
+      /** sum of the digests of all objects, it does not depend on the order the objects were changed in */
+      uint64_t digest = 0;
+   };
+
+   /**
+    * @brief Maintains the digest of an index as objects are added, modified and removed
+    *
+    * Every object contributes the first 64 bits of the sha256 of its packed form and the digest of the index is
+    * the sum of those, so every change is a constant time update, and two nodes with the same objects have the
+    * same digest however they got there. The digest of every object is kept to take it out of the sum again
+    * when the object is modified or removed.
+    */
+   class index_state_hasher : public index_observer
+   {
+      public:
+         index_state_hasher( uint8_t space_id, uint8_t type_id )
+         {
+            _result.space_id = space_id;
+            _result.type_id = type_id;
+         }
+
+         virtual void on_add( const object& obj ) override
+         {
+            const uint64_t digest = obj.digest();
+            _digests[obj.id] = digest;
+            _result.digest += digest;
+            ++_result.object_count;
+         }
+
+         virtual void on_remove( const object& obj ) override
+         {
+            auto itr = _digests.find( obj.id );
+            if( itr == _digests.end() ) return;
+            _result.digest -= itr->second;
+            --_result.object_count;
+            _digests.erase( obj.id );
+         }
+
+         virtual void on_modify( const object& obj ) override
+         {
+            auto itr = _digests.find( obj.id );
+            if( itr == _digests.end() ) return;
+            const uint64_t digest = obj.digest();
+            _result.digest += digest - itr->second;
+            itr->second = digest;
+         }
+
+         /** Recomputes the digest from all objects of @p idx, for indexes that were loaded without callbacks */
+         void reset( const index& idx )
+         {
+            _digests.clear();
+            _result.object_count = 0;
+            _result.digest = 0;
+            idx.inspect_all_objects( [this]( const object& obj ) { on_add( obj ); } );
+         }
+
+         const index_state_digest& result()const { return _result; }
+
+         size_t memory_usage()const { return _digests.memory_usage(); }
+
+      private:
+         index_state_digest    _result;
+         flat_id_map<uint64_t> _digests;
+   };
+
+} } // graphene::db
+
+FC_REFLECT( graphene::db::index_state_digest, (space_id)(type_id)(object_count)(digest) )
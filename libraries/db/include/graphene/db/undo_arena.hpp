@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @class undo_arena_pool
+    * @brief Keeps released undo_arena blocks for reuse, so steady state undo sessions do not hit the allocator
+    */
+   class undo_arena_pool
+   {
+      public:
+         static const size_t max_cached_blocks = 256;
+
+         undo_arena_pool() = default;
+         undo_arena_pool( const undo_arena_pool& ) = delete;
+         undo_arena_pool& operator=( const undo_arena_pool& ) = delete;
+         ~undo_arena_pool();
+
+         char* acquire();
+         void  release( char* block );
+
+      private:
+         std::vector<char*> _free_blocks;
+   };
+
+   /**
+    * @class undo_arena
+    * @brief A monotonic allocator backing the object copies of one undo_state
+    *
+    * Memory is handed out by bumping a pointer through fixed size blocks and is only given back when the arena
+    * is destroyed, which happens in one shot when the undo state is popped. Destructors of the objects are not
+    * run by the arena, their owners do that.
+    */
+   class undo_arena
+   {
+      public:
+         static const size_t block_size = 64 * 1024;
+
+         explicit undo_arena( undo_arena_pool* pool = nullptr ):_pool(pool) {}
+         undo_arena( undo_arena&& other );
+         undo_arena( const undo_arena& ) = delete;
+         undo_arena& operator=( const undo_arena& ) = delete;
+         ~undo_arena();
+
+         void* allocate( size_t size, size_t alignment );
+
+         /** Takes over all memory of @p other, so objects allocated there outlive it */
+         void adopt( undo_arena& other );
+
+         /** @return number of bytes held by this arena */
+         size_t allocated_bytes()const { return _blocks.size() * block_size + _large_bytes; }
+
+      private:
+         void release();
+
+         undo_arena_pool*   _pool;
+         std::vector<char*> _blocks;
+         /** Allocations that do not fit into a block get their own */
+         std::vector<char*> _large_blocks;
+         size_t             _large_bytes = 0;
+         char*              _pos = nullptr;
+         char*              _end = nullptr;
+   };
+
+} } // graphene::db
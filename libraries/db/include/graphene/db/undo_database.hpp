@@ -23,6 +23,9 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/field_undo.hpp>
+#include <graphene/db/flat_id_map.hpp>
+#include <graphene/db/undo_arena.hpp>
 #include <deque>
 #include <fc/exception/exception.hpp>
 
@@ -31,13 +34,43 @@ namespace graphene { namespace db {
    using std::unordered_map;
    using fc::flat_set;
    class object_database;
+   struct rewound_state;
+
+   /** Destroys an object copy that lives in an undo_arena, its memory is released with the arena */
+   struct arena_object_deleter
+   {
+      void operator()( object* obj )const { obj->~object(); }
+   };
+   typedef std::unique_ptr<object, arena_object_deleter> arena_object_ptr;
 
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
-      unordered_map<object_id_type, object_id_type>      old_index_next_ids;
-      std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      explicit undo_state( undo_arena_pool* pool = nullptr ):arena(pool) {}
+
+      /** backs the copies in old_values and removed, declared first so that it is destroyed after them */
+      undo_arena                        arena;
+      flat_id_map<arena_object_ptr>     old_values;
+      /** modified objects with field level undo, they are in this map instead of old_values */
+      flat_id_map<field_undo_record>    old_fields;
+      flat_id_map<object_id_type>       old_index_next_ids;
+      flat_id_set                       new_ids;
+      flat_id_map<arena_object_ptr>     removed;
+
+      /** @return approximate bytes held by this state, the copies of objects and the tables referring to them */
+      size_t memory_usage()const;
+   };
+
+   /**
+    * The changes recorded by an undo state, kept so that they can be applied again after the state was undone,
+    * see undo_database::capture_head and undo_database::redo
+    */
+   struct redo_state
+   {
+      /** created and modified objects as they were at the end of the state, by increasing id */
+      std::vector< std::unique_ptr<object> >               new_values;
+      std::vector< object_id_type >                        removed;
+      /** next ids of the indexes that objects were created in, as they were at the end of the state */
+      std::vector< std::pair<object_id_type, object_id_type> > index_next_ids;
    };
 
 
@@ -120,16 +153,39 @@ namespace graphene { namespace db {
          void set_max_size(size_t new_max_size) { _max_size = new_max_size; }
          size_t max_size()const { return _max_size; }
          uint32_t active_sessions()const { return _active_sessions; }
+         /// Number of object creations, modifications and removals reported so far, including those made while
+         /// disabled. Comparing two values tells whether the object database changed in between.
+         uint64_t change_count()const { return _change_count; }
 
          const undo_state& head()const;
 
+         /** Records the changes of the newest undo state, as they are now, into @p result */
+         void capture_head( redo_state& result )const;
+         /**
+          * Applies changes recorded by capture_head() after the undo state they came from was undone, with the object
+          * database back in the state it was in before them. The changes are recorded in the current undo state.
+          */
+         void redo( const redo_state& state );
+
+         /** @return the memory usage of every undo state, oldest first */
+         std::vector<size_t> state_memory_usage()const;
+
+         /**
+          * Computes the state as it was before the newest @p depth undo states were recorded, without undoing
+          * anything. @p result receives copies of the earlier versions of all objects touched since.
+          */
+         void rewind( size_t depth, rewound_state& result )const;
+
       private:
          void undo();
          void merge();
          void commit();
 
          uint32_t                _active_sessions = 0;
+         uint64_t                _change_count = 0;
          bool                    _disabled = true;
+         /** declared before _stack so that it outlives the arenas returning blocks to it */
+         undo_arena_pool         _arena_pool;
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
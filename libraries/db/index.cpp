@@ -25,19 +25,138 @@
 #include <graphene/db/index.hpp>
 #include <graphene/db/object_database.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 namespace graphene { namespace db {
    void base_primary_index::save_undo( const object& obj )
    { _db.save_undo( obj ); }
 
    void base_primary_index::on_add( const object& obj )
    {
+      _dirty = true;
       _db.save_undo_add( obj );
       for( auto ob : _observers ) ob->on_add( obj );
    }
 
    void base_primary_index::on_remove( const object& obj )
-   { _db.save_undo_remove( obj ); for( auto ob : _observers ) ob->on_remove( obj ); }
+   { _dirty = true; _db.save_undo_remove( obj ); for( auto ob : _observers ) ob->on_remove( obj ); }
 
    void base_primary_index::on_modify( const object& obj )
-   {for( auto ob : _observers ) ob->on_modify(  obj ); }
+   { _dirty = true; for( auto ob : _observers ) ob->on_modify(  obj ); }
+
+   const uint64_t snapshot_writer::magic;
+   const uint32_t snapshot_writer::format_version;
+   const size_t   snapshot_writer::header_size;
+
+   snapshot_writer::snapshot_writer( const fc::path& file, size_t buffer_size )
+   : _out( file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc )
+   {
+      FC_ASSERT( _out, "Unable to open ${f} for writing", ("f", file) );
+      _buffer.resize( buffer_size );
+      pack( magic );
+      pack( format_version );
+   }
+
+   snapshot_writer::snapshot_writer( size_t buffer_size )
+   {
+      _buffer.resize( buffer_size );
+      pack( magic );
+      pack( format_version );
+   }
+
+   char* snapshot_writer::reserve( size_t size )
+   {
+      if( _used + size > _buffer.size() )
+      {
+         write_buffer();
+         if( size > _buffer.size() )
+            _buffer.resize( size );
+      }
+      char* result = _buffer.data() + _used;
+      _used += size;
+      return result;
+   }
+
+   void snapshot_writer::write_buffer()
+   {
+      if( _used == 0 )
+         return;
+      if( !_out.is_open() )
+      {
+         // kept in memory, a new buffer replaces the one that was filled
+         const size_t buffer_size = _buffer.size();
+         _buffer.resize( _used );
+         _chunks.push_back( std::move( _buffer ) );
+         _buffer = vector<char>( buffer_size );
+         _used = 0;
+         return;
+      }
+      _checksum.write( _buffer.data(), _used );
+      _out.write( _buffer.data(), _used );
+      FC_ASSERT( _out, "Failed to write index snapshot" );
+      _used = 0;
+   }
+
+   fc::sha256 snapshot_writer::finish()
+   {
+      write_buffer();
+      const fc::sha256 checksum = _checksum.result();
+      _out.write( checksum.data(), checksum.data_size() );
+      _out.flush();
+      FC_ASSERT( _out, "Failed to write index snapshot" );
+      return checksum;
+   }
+
+   vector< vector<char> > snapshot_writer::release()
+   {
+      FC_ASSERT( !_out.is_open(), "The snapshot is written to a file" );
+      write_buffer();
+      return std::move( _chunks );
+   }
+
+   fc::sha256 snapshot_writer::write_file( const fc::path& file, const vector< vector<char> >& chunks )
+   {
+      std::ofstream out( file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out, "Unable to open ${f} for writing", ("f", file) );
+      fc::sha256::encoder checksum;
+      for( const auto& chunk : chunks )
+      {
+         checksum.write( chunk.data(), chunk.size() );
+         out.write( chunk.data(), chunk.size() );
+      }
+      const fc::sha256 result = checksum.result();
+      out.write( result.data(), result.data_size() );
+      out.flush();
+      FC_ASSERT( out, "Failed to write index snapshot" );
+      return result;
+   }
+
+   bool snapshot_writer::is_snapshot( const char* data, size_t size )
+   {
+      if( size < header_size )
+         return false;
+      uint64_t file_magic;
+      memcpy( &file_magic, data, sizeof(file_magic) );
+      return file_magic == magic;
+   }
+
+   size_t snapshot_writer::verify( const char* data, size_t size )
+   {
+      FC_ASSERT( is_snapshot( data, size ) && size >= header_size + sizeof(fc::sha256),
+                 "Not an index snapshot" );
+      uint32_t file_format;
+      memcpy( &file_format, data + sizeof(uint64_t), sizeof(file_format) );
+      FC_ASSERT( file_format == format_version, "Unsupported index snapshot format ${v}", ("v", file_format) );
+
+      const size_t data_size = size - sizeof(fc::sha256);
+      fc::sha256::encoder enc;
+      // the encoder takes 32 bit lengths
+      for( size_t pos = 0; pos < data_size; pos += 0x40000000 )
+         enc.write( data + pos, uint32_t( std::min<size_t>( data_size - pos, 0x40000000 ) ) );
+      fc::sha256 checksum;
+      memcpy( checksum.data(), data + data_size, sizeof(checksum) );
+      FC_ASSERT( enc.result() == checksum, "Checksum mismatch, index snapshot is corrupted" );
+      return data_size;
+   }
 } } // graphene::chain
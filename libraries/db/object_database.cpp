@@ -37,6 +37,7 @@ object_database::object_database()
    _undo_db.enable();
 }
 void object_database::reset_indexes() {
+   _state_hashers.clear();
    _index.clear();
    _index.resize(255);
    _safety_checks.clear();
@@ -49,6 +50,65 @@ void object_database::close()
 {
 }
 
+uint64_t database_memory_usage::total_bytes()const
+{
+   uint64_t result = 0;
+   for( const auto& item : indexes )
+      result += item.object_bytes + item.secondary_index_bytes;
+   for( auto bytes : undo_states )
+      result += bytes;
+   return result;
+}
+
+database_memory_usage object_database::get_memory_usage()const
+{
+   database_memory_usage result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+      {
+         if( !idx ) continue;
+         index_memory_usage usage;
+         usage.space_id = idx->object_space_id();
+         usage.type_id = idx->object_type_id();
+         usage.object_count = idx->object_count();
+         usage.object_bytes = idx->object_memory_usage();
+         usage.secondary_index_bytes = idx->secondary_index_memory_usage();
+         result.indexes.push_back( usage );
+      }
+   for( auto bytes : _undo_db.state_memory_usage() )
+      result.undo_states.push_back( bytes );
+   return result;
+}
+
+void object_database::enable_state_hash()
+{
+   if( state_hash_enabled() ) return;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+      {
+         if( !idx ) continue;
+         auto hasher = std::make_shared<index_state_hasher>( idx->object_space_id(), idx->object_type_id() );
+         hasher->reset( *idx );
+         idx->add_observer( hasher );
+         _state_hashers.push_back( hasher );
+      }
+}
+
+vector<index_state_digest> object_database::get_index_state_digests()const
+{
+   FC_ASSERT( state_hash_enabled(), "State hashing is not enabled" );
+   vector<index_state_digest> result;
+   result.reserve( _state_hashers.size() );
+   for( const auto& hasher : _state_hashers )
+      result.push_back( hasher->result() );
+   return result;
+}
+
+fc::sha256 object_database::get_state_hash()const
+{
+   return fc::sha256::hash( get_index_state_digests() );
+}
+
 const object* object_database::find_object( object_id_type id )const
 {
    return get_index(id.space(),id.type()).find( id );
@@ -85,28 +145,121 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 void object_database::flush()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
-   fc::create_directories( _data_dir / "object_database.tmp" / "lock" );
+   const fc::path snapshot_dir = _data_dir / "object_database";
+   const fc::path tmp_dir = _data_dir / "object_database.tmp";
+   // files of indexes that did not change since the last flush or open are taken over from the previous snapshot
+   const bool have_snapshot = fc::exists( snapshot_dir ) && !fc::exists( snapshot_dir / "lock" );
+   // files left by a crashed flush may be links to the files of the snapshot, writing to them would corrupt it
+   fc::remove_all( tmp_dir );
+   fc::create_directories( tmp_dir / "lock" );
    std::vector<fc::future<void>> tasks;
    tasks.reserve(200);
+   std::vector<base_primary_index*> saved;
+   uint32_t reused = 0;
    for( uint32_t space = 0; space < _index.size(); ++space )
    {
-      fc::create_directories( _data_dir / "object_database.tmp" / fc::to_string(space) );
+      fc::create_directories( tmp_dir / fc::to_string(space) );
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
-            tasks.push_back( fc::do_parallel( [this,space,type] () {
-               _index[space][type]->save( _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
+         {
+            const fc::path file = fc::path( fc::to_string(space) ) / fc::to_string(type);
+            auto* primary = dynamic_cast<base_primary_index*>( _index[space][type].get() );
+            if( have_snapshot && primary != nullptr && !primary->is_dirty() && fc::exists( snapshot_dir / file ) )
+            {
+               reuse_snapshot_file( snapshot_dir / file, tmp_dir / file );
+               ++reused;
+               continue;
+            }
+            if( primary != nullptr )
+               saved.push_back( primary );
+            tasks.push_back( fc::do_parallel( [this,&tmp_dir,file,space,type] () {
+               _index[space][type]->save( tmp_dir / file );
             } ) );
+         }
    }
    for( auto& task : tasks )
       task.wait();
-   fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
-   if( fc::exists( _data_dir / "object_database" ) )
-      fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
-   fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
+   fc::remove_all( tmp_dir / "lock" );
+   if( fc::exists( snapshot_dir ) )
+      fc::rename( snapshot_dir, _data_dir / "object_database.old" );
+   fc::rename( tmp_dir, snapshot_dir );
    fc::remove_all( _data_dir / "object_database.old" );
+
+   for( auto* primary : saved )
+      primary->set_dirty( false );
+   dlog( "Saved ${n} indexes of object_database, ${r} unchanged ones taken over", ("n", tasks.size())("r", reused) );
+}
+
+void object_database::reuse_snapshot_file( const fc::path& from, const fc::path& to )
+{
+   try
+   {
+      fc::create_hard_link( from, to );
+      return;
+   }
+   catch( const fc::exception& e )
+   {
+      dlog( "Unable to hard link ${f}, copying it: ${e}", ("f", from)("e", e.to_string()) );
+   }
+   fc::copy( from, to );
 }
 
+void object_database::save_state( snapshot_writer& out, size_t undo_depth )const
+{ try {
+   rewound_state rewound;
+   _undo_db.rewind( undo_depth, rewound );
+   uint32_t count = 0;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            ++count;
+   out.pack( count );
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+      {
+         if( !idx ) continue;
+         out.pack( idx->object_space_id() );
+         out.pack( idx->object_type_id() );
+         idx->save_state( out, rewound );
+      }
+} FC_CAPTURE_AND_RETHROW( (undo_depth) ) }
+
+void object_database::restore_state( fc::datastream<const char*>& ds, const fc::path& data_dir )
+{ try {
+   const fc::path dir = data_dir / "object_database";
+   fc::remove_all( dir );
+   uint32_t count;
+   fc::raw::unpack( ds, count );
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      uint8_t space;
+      uint8_t type;
+      fc::raw::unpack( ds, space );
+      fc::raw::unpack( ds, type );
+      fc::create_directories( dir / fc::to_string(uint32_t(space)) );
+      snapshot_writer out( dir / fc::to_string(uint32_t(space)) / fc::to_string(uint32_t(type)) );
+      fc::sha256 version;
+      object_id_type next_id;
+      fc::raw::unpack( ds, version );
+      fc::raw::unpack( ds, next_id );
+      out.pack( version );
+      out.pack( next_id );
+      while( true )
+      {
+         uint32_t object_size;
+         fc::raw::unpack( ds, object_size );
+         if( object_size == 0 )
+            break;
+         FC_ASSERT( object_size <= ds.remaining(), "Truncated object in state snapshot" );
+         out.pack( object_size );
+         out.write( ds.pos(), object_size );
+         ds.skip( object_size );
+      }
+      out.finish();
+   }
+} FC_CAPTURE_AND_RETHROW( (data_dir) ) }
+
 void object_database::wipe(const fc::path& data_dir)
 {
    close();
@@ -134,6 +287,9 @@ void object_database::open(const fc::path& data_dir)
             } ) );
    for( auto& task : tasks )
       task.wait();
+   // loading does not notify observers
+   for( const auto& hasher : _state_hashers )
+      hasher->reset( get_index( hasher->result().space_id, hasher->result().type_id ) );
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/db/undo_arena.hpp>
+
+#include <cstdint>
+#include <utility>
+
+namespace graphene { namespace db {
+
+undo_arena_pool::~undo_arena_pool()
+{
+   for( char* block : _free_blocks )
+      delete[] block;
+}
+
+char* undo_arena_pool::acquire()
+{
+   if( _free_blocks.empty() )
+      return new char[undo_arena::block_size];
+   char* block = _free_blocks.back();
+   _free_blocks.pop_back();
+   return block;
+}
+
+void undo_arena_pool::release( char* block )
+{
+   if( _free_blocks.size() < max_cached_blocks )
+      _free_blocks.push_back( block );
+   else
+      delete[] block;
+}
+
+undo_arena::undo_arena( undo_arena&& other )
+:_pool(other._pool),_blocks(std::move(other._blocks)),_large_blocks(std::move(other._large_blocks)),
+ _large_bytes(other._large_bytes),_pos(other._pos),_end(other._end)
+{
+   other._blocks.clear();
+   other._large_blocks.clear();
+   other._large_bytes = 0;
+   other._pos = other._end = nullptr;
+}
+
+undo_arena::~undo_arena()
+{
+   release();
+}
+
+void undo_arena::release()
+{
+   for( char* block : _blocks )
+   {
+      if( _pool != nullptr )
+         _pool->release( block );
+      else
+         delete[] block;
+   }
+   for( char* block : _large_blocks )
+      delete[] block;
+   _blocks.clear();
+   _large_blocks.clear();
+   _large_bytes = 0;
+   _pos = _end = nullptr;
+}
+
+void* undo_arena::allocate( size_t size, size_t alignment )
+{
+   if( size + alignment > block_size )
+   {
+      // operator new[] returns memory aligned for any fundamental type
+      char* block = new char[size];
+      _large_blocks.push_back( block );
+      _large_bytes += size;
+      return block;
+   }
+
+   uintptr_t aligned = ( uintptr_t(_pos) + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+   if( _pos == nullptr || aligned + size > uintptr_t(_end) )
+   {
+      char* block = _pool != nullptr ? _pool->acquire() : new char[block_size];
+      _blocks.push_back( block );
+      _pos = block;
+      _end = block + block_size;
+      aligned = ( uintptr_t(_pos) + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+   }
+   _pos = (char*)( aligned + size );
+   return (void*)aligned;
+}
+
+void undo_arena::adopt( undo_arena& other )
+{
+   // blocks of other that came from its pool are handed back to ours, which is the same pool of the undo_database
+   _blocks.insert( _blocks.end(), other._blocks.begin(), other._blocks.end() );
+   _large_blocks.insert( _large_blocks.end(), other._large_blocks.begin(), other._large_blocks.end() );
+   _large_bytes += other._large_bytes;
+   other._blocks.clear();
+   other._large_blocks.clear();
+   other._large_bytes = 0;
+   other._pos = other._end = nullptr;
+}
+
+} } // graphene::db
@@ -26,8 +26,19 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace db {
 
+size_t undo_state::memory_usage()const
+{
+   size_t result = arena.allocated_bytes() + old_values.memory_usage() + old_fields.memory_usage()
+                   + old_index_next_ids.memory_usage() + new_ids.memory_usage() + removed.memory_usage();
+   for( const auto& item : old_fields )
+      result += item.second.data.capacity();
+   return result;
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -54,16 +65,17 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
    while( size() > max_size() )
       _stack.pop_front();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_arena_pool );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
 void undo_database::on_create( const object& obj )
 {
+   ++_change_count;
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_arena_pool );
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
@@ -73,23 +85,31 @@ void undo_database::on_create( const object& obj )
 }
 void undo_database::on_modify( const object& obj )
 {
+   ++_change_count;
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_arena_pool );
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
       return;
+   if( obj.field_undo_enabled() )
+   {
+      // a record that was trimmed on commit lacks the fields that did not change, which still hold their old value
+      obj.capture_fields( state.old_fields[obj.id] );
+      return;
+   }
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.old_values.emplace( obj.id, arena_object_ptr( obj.clone( state.arena ) ) );
 }
 void undo_database::on_remove( const object& obj )
 {
+   ++_change_count;
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_arena_pool );
    undo_state& state = _stack.back();
    if( state.new_ids.count(obj.id) > 0 )
    {
@@ -102,8 +122,17 @@ void undo_database::on_remove( const object& obj )
       state.old_values.erase(obj.id);
       return;
    }
+   auto fields = state.old_fields.find(obj.id);
+   if( fields != state.old_fields.end() )
+   {
+      arena_object_ptr old_value( obj.clone( state.arena ) );
+      old_value->restore_fields( fields->second );
+      state.old_fields.erase(obj.id);
+      state.removed.emplace( obj.id, std::move(old_value) );
+      return;
+   }
    if( state.removed.count(obj.id) > 0 ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed.emplace( obj.id, arena_object_ptr( obj.clone( state.arena ) ) );
 }
 
 void undo_database::undo()
@@ -118,6 +147,11 @@ void undo_database::undo()
       _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
    }
 
+   for( auto& item : state.old_fields )
+   {
+      _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.restore_fields( item.second ); } );
+   }
+
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
    {
       _db.remove( _db.get_object(*ritr) );
@@ -210,6 +244,28 @@ void undo_database::merge()
       prev_state.old_values[obj.second->id] = std::move(obj.second);
    }
 
+   // *+upd for objects with field level undo, the merged record is the one of A completed by the fields that only
+   // changed in B, as those still held their value of before A when B started
+   for( auto& item : state.old_fields )
+   {
+      if( prev_state.new_ids.find(item.first) != prev_state.new_ids.end() )
+      {
+         // new+upd -> new, type A
+         continue;
+      }
+      auto it = prev_state.old_fields.find(item.first);
+      if( it != prev_state.old_fields.end() )
+      {
+         // upd(was=X) + upd(was=Y) -> upd(was=X), type A, filling in what X lacks from Y
+         it->second.add_missing( item.second );
+         continue;
+      }
+      // del+upd -> N/A
+      assert( prev_state.removed.find(item.first) == prev_state.removed.end() );
+      // nop+upd(was=Y) -> upd(was=Y), type B
+      prev_state.old_fields[item.first] = std::move(item.second);
+   }
+
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
    for( auto id : state.new_ids )
       prev_state.new_ids.insert(id);
@@ -248,11 +304,22 @@ void undo_database::merge()
          prev_state.old_values.erase(obj.second->id);
          continue;
       }
+      auto fields = prev_state.old_fields.find(obj.second->id);
+      if( fields != prev_state.old_fields.end() )
+      {
+         // upd(was=X) + del(was=Y) -> del(was=X), X is Y with the fields recorded in A restored
+         obj.second->restore_fields( fields->second );
+         prev_state.old_fields.erase(obj.second->id);
+         prev_state.removed[obj.second->id] = std::move(obj.second);
+         continue;
+      }
       // del + del -> N/A
       assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
       prev_state.removed[obj.second->id] = std::move(obj.second);
    }
+   // the copies that were moved to prev_state live in the arena of state
+   prev_state.arena.adopt( state.arena );
    _stack.pop_back();
    --_active_sessions;
 }
@@ -260,6 +327,21 @@ void undo_database::commit()
 {
    FC_ASSERT( _active_sessions > 0 );
    --_active_sessions;
+
+   // drop the fields that did not change from the records of the committed state, they are kept until the state is
+   // popped and only the modified fields are needed to restore the objects
+   if( _stack.empty() ) return;
+   auto& state = _stack.back();
+   std::vector<object_id_type> unchanged;
+   for( auto& item : state.old_fields )
+   {
+      if( !item.second.complete ) continue;
+      _db.get_object( item.first ).trim_fields( item.second );
+      if( item.second.empty() )
+         unchanged.push_back( item.first );
+   }
+   for( const auto& id : unchanged )
+      state.old_fields.erase( id );
 }
 
 void undo_database::pop_commit()
@@ -276,6 +358,11 @@ void undo_database::pop_commit()
          _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
       }
 
+      for( auto& item : state.old_fields )
+      {
+         _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.restore_fields( item.second ); } );
+      }
+
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
       {
          _db.remove( _db.get_object(*ritr) );
@@ -305,4 +392,91 @@ const undo_state& undo_database::head()const
    return _stack.back();
 }
 
+void undo_database::capture_head( redo_state& result )const
+{
+   const undo_state& state = head();
+   result.new_values.clear();
+   result.new_values.reserve( state.old_values.size() + state.old_fields.size() + state.new_ids.size() );
+   for( const auto& item : state.old_values )
+      result.new_values.push_back( _db.get_object( item.first ).clone() );
+   for( const auto& item : state.old_fields )
+      result.new_values.push_back( _db.get_object( item.first ).clone() );
+   for( const auto& id : state.new_ids )
+      result.new_values.push_back( _db.get_object( id ).clone() );
+   std::sort( result.new_values.begin(), result.new_values.end(),
+              []( const std::unique_ptr<object>& a, const std::unique_ptr<object>& b ) { return a->id < b->id; } );
+
+   result.removed.clear();
+   for( const auto& item : state.removed )
+      result.removed.push_back( item.first );
+
+   result.index_next_ids.clear();
+   for( const auto& item : state.old_index_next_ids )
+      result.index_next_ids.emplace_back( item.first,
+                                          _db.get_index( item.first.space(), item.first.type() ).get_next_id() );
+}
+
+void undo_database::redo( const redo_state& state )
+{ try {
+   FC_ASSERT( !_disabled );
+   if( _stack.empty() )
+      _stack.emplace_back( &_arena_pool );
+
+   // the objects are inserted with their recorded ids, undoing this must go back to the next ids of before
+   auto& old_next_ids = _stack.back().old_index_next_ids;
+   for( const auto& item : state.index_next_ids )
+      if( old_next_ids.find( item.first ) == old_next_ids.end() )
+         old_next_ids[item.first] = _db.get_index( item.first.space(), item.first.type() ).get_next_id();
+
+   for( const auto& id : state.removed )
+      _db.remove( _db.get_object( id ) );
+
+   for( const auto& value : state.new_values )
+   {
+      std::unique_ptr<object> copy = value->clone();
+      const object* current = _db.find_object( value->id );
+      if( current )
+         _db.modify( *current, [&copy]( object& obj ){ obj.move_from( *copy ); } );
+      else
+         _db.insert( std::move(*copy) );
+   }
+
+   for( const auto& item : state.index_next_ids )
+      _db.get_mutable_index( item.first.space(), item.first.type() ).set_next_id( item.second );
+} FC_CAPTURE_AND_RETHROW() }
+
+std::vector<size_t> undo_database::state_memory_usage()const
+{
+   std::vector<size_t> result;
+   result.reserve( _stack.size() );
+   for( const auto& state : _stack )
+      result.push_back( state.memory_usage() );
+   return result;
+}
+
+void undo_database::rewind( size_t depth, rewound_state& result )const
+{ try {
+   FC_ASSERT( depth <= _stack.size(), "Only ${n} undo states are available", ("n", _stack.size()) );
+   // walk from the newest state to the oldest, so that the versions recorded by older states win
+   for( auto state = _stack.rbegin(); state != _stack.rbegin() + depth; ++state )
+   {
+      for( const auto& id : state->new_ids )
+         result.objects[id].reset();
+      for( const auto& item : state->old_values )
+         result.objects[item.first] = item.second->clone();
+      for( const auto& item : state->removed )
+         result.objects[item.first] = item.second->clone();
+      for( const auto& item : state->old_fields )
+      {
+         // the record only holds the fields that changed, restore them on the version after this state
+         auto& earlier = result.objects[item.first];
+         if( !earlier )
+            earlier = _db.get_object( item.first ).clone();
+         earlier->restore_fields( item.second );
+      }
+      for( const auto& item : state->old_index_next_ids )
+         result.next_ids[item.first] = item.second;
+   }
+} FC_CAPTURE_AND_RETHROW( (depth) ) }
+
 } } // graphene::db
@@ -98,6 +98,13 @@ namespace graphene { namespace protocol {
       }
       return _calculated_merkle_root;
    }
+
+   uint64_t signed_block::get_packed_size()const
+   {
+      if( _packed_size == 0 )
+         _packed_size = fc::raw::pack_size( *this );
+      return _packed_size;
+   }
 } }
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::protocol::block_header)
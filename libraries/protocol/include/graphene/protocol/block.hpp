@@ -62,9 +62,12 @@ namespace graphene { namespace protocol {
    {
    public:
       const checksum_type& calculate_merkle_root()const;
+      /// Size of the serialized block, computed once and cached like the merkle root
+      uint64_t             get_packed_size()const;
       vector<processed_transaction> transactions;
    protected:
       mutable checksum_type   _calculated_merkle_root;
+      mutable uint64_t        _packed_size = 0;
    };
 
 } } // graphene::protocol
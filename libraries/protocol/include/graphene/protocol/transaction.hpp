@@ -256,6 +256,25 @@ namespace graphene { namespace protocol {
                           const flat_set<account_id_type>& active_approvals = flat_set<account_id_type>(),
                           const flat_set<account_id_type>& owner_approvals = flat_set<account_id_type>() );
 
+   /**
+    * Recovers the public key which created @p sig over @p digest. Recovered keys are kept in a bounded process wide
+    * cache, so a transaction seen before, e.g. when it was broadcast, does not need its keys recovered again when it
+    * arrives in a block. Thread safe.
+    */
+   public_key_type recover_signature_key( const signature_type& sig, const digest_type& digest );
+
+   /// Sets the number of keys kept by recover_signature_key(), 0 (the default) disables the cache
+   void set_recovered_key_cache_size( size_t max_entries );
+
+   /// Cache statistics of recover_signature_key()
+   struct recovered_key_cache_stats
+   {
+      size_t   size = 0;
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+   };
+   recovered_key_cache_stats get_recovered_key_cache_stats();
+
    /**
     *  @brief captures the result of evaluating the operations contained in the transaction
     *
@@ -277,7 +296,10 @@ namespace graphene { namespace protocol {
 
       vector<operation_result> operation_results;
 
-      digest_type merkle_digest()const;
+      /// Hash of the packed transaction including its results, cached like the other precomputed values
+      const digest_type& merkle_digest()const;
+   protected:
+      mutable digest_type _merkle_digest;
    };
 
    /// @} transactions group
@@ -9,13 +9,23 @@
 
 #include <fc/io/raw.hpp>
 
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 namespace graphene { namespace protocol {
 
-digest_type processed_transaction::merkle_digest()const
+const digest_type& processed_transaction::merkle_digest()const
 {
-   digest_type::encoder enc;
-   fc::raw::pack( enc, *this );
-   return enc.result();
+   if( !_merkle_digest._hash[0].value() )
+   {
+      digest_type::encoder enc;
+      fc::raw::pack( enc, *this );
+      _merkle_digest = enc.result();
+   }
+   return _merkle_digest;
 }
 
 digest_type transaction::digest()const
@@ -326,6 +336,124 @@ void verify_authority( const vector<operation>& ops, const flat_set<public_key_t
 } FC_CAPTURE_AND_RETHROW( (rejected_custom_auths)(ops)(sigs) ) }
 
 
+namespace {
+   /// Least recently used cache of keys recovered from signatures
+   class recovered_key_cache
+   {
+   public:
+      struct key_type
+      {
+         digest_type    digest;
+         signature_type signature;
+         bool operator==( const key_type& other )const
+         { return digest == other.digest && signature == other.signature; }
+      };
+      struct key_hash
+      {
+         size_t operator()( const key_type& k )const
+         {
+            uint64_t digest_bits;
+            uint64_t sig_bits;
+            memcpy( &digest_bits, k.digest.data(), sizeof(digest_bits) );
+            memcpy( &sig_bits, k.signature.data + 1, sizeof(sig_bits) );
+            return digest_bits ^ sig_bits;
+         }
+      };
+
+      bool get( const key_type& k, public_key_type& result )
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         auto itr = _entries.find( k );
+         if( itr == _entries.end() )
+         {
+            ++_misses;
+            return false;
+         }
+         ++_hits;
+         _lru.splice( _lru.begin(), _lru, itr->second );
+         result = itr->second->second;
+         return true;
+      }
+
+      void put( const key_type& k, const public_key_type& key )
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         if( _max_entries == 0 || _entries.find( k ) != _entries.end() )
+            return;
+         _lru.emplace_front( k, key );
+         _entries.emplace( k, _lru.begin() );
+         while( _entries.size() > _max_entries )
+         {
+            _entries.erase( _lru.back().first );
+            _lru.pop_back();
+         }
+      }
+
+      void resize( size_t max_entries )
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         _max_entries = max_entries;
+         while( _entries.size() > _max_entries )
+         {
+            _entries.erase( _lru.back().first );
+            _lru.pop_back();
+         }
+      }
+
+      bool enabled()const { return _max_entries > 0; }
+
+      recovered_key_cache_stats stats()
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         recovered_key_cache_stats result;
+         result.size = _entries.size();
+         result.hits = _hits;
+         result.misses = _misses;
+         return result;
+      }
+
+   private:
+      typedef std::list< std::pair<key_type, public_key_type> > lru_list;
+      std::mutex                                                     _mutex;
+      std::atomic<size_t>                                            _max_entries { 0 };
+      lru_list                                                       _lru;
+      std::unordered_map<key_type, lru_list::iterator, key_hash>     _entries;
+      uint64_t                                                       _hits = 0;
+      uint64_t                                                       _misses = 0;
+   };
+
+   recovered_key_cache& get_recovered_key_cache()
+   {
+      static recovered_key_cache cache;
+      return cache;
+   }
+}
+
+public_key_type recover_signature_key( const signature_type& sig, const digest_type& digest )
+{
+   auto& cache = get_recovered_key_cache();
+   if( !cache.enabled() )
+      return fc::ecc::public_key( sig, digest );
+   const recovered_key_cache::key_type k { digest, sig };
+   public_key_type result;
+   if( !cache.get( k, result ) )
+   {
+      result = fc::ecc::public_key( sig, digest );
+      cache.put( k, result );
+   }
+   return result;
+}
+
+void set_recovered_key_cache_size( size_t max_entries )
+{
+   get_recovered_key_cache().resize( max_entries );
+}
+
+recovered_key_cache_stats get_recovered_key_cache_stats()
+{
+   return get_recovered_key_cache().stats();
+}
+
 const flat_set<public_key_type>& signed_transaction::get_signature_keys( const chain_id_type& chain_id )const
 { try {
    auto d = sig_digest( chain_id );
@@ -333,7 +461,7 @@ const flat_set<public_key_type>& signed_transaction::get_signature_keys( const c
    for( const auto&  sig : signatures )
    {
       GRAPHENE_ASSERT(
-         result.insert( fc::ecc::public_key(sig,d) ).second,
+         result.insert( recover_signature_key( sig, d ) ).second,
             tx_duplicate_sig,
             "Duplicate Signature detected" );
    }
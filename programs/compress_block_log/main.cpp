@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ * Copyright (c) 2020-2023 Revolution Populi Limited, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/chunked_block_log.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace graphene::chain;
+
+/**
+ * Converts the uncompressed block database of a node (the @c index / @c blocks pair in
+ * <tt>blockchain/database/block_num_to_block</tt>) into the chunked compressed format. The result is written
+ * into a new directory, which replaces the original one after the node has been stopped.
+ */
+int main( int argc, char** argv )
+{
+   try
+   {
+      if( argc < 3 || argc > 4 )
+      {
+         std::cerr << "Usage: " << argv[0] << " <source block_num_to_block dir> <target dir> [blocks per chunk]\n"
+                   << "Default blocks per chunk: " << chunked_block_log::default_blocks_per_chunk << "\n";
+         return 1;
+      }
+
+      const fc::path source_dir( argv[1] );
+      const fc::path target_dir( argv[2] );
+      uint32_t blocks_per_chunk = chunked_block_log::default_blocks_per_chunk;
+      if( argc == 4 )
+         blocks_per_chunk = boost::lexical_cast<uint32_t>( argv[3] );
+
+      FC_ASSERT( fc::exists( source_dir / "index" ), "${d} does not contain an uncompressed block database",
+                 ("d", source_dir) );
+
+      block_database source;
+      source.open( source_dir );
+      chunked_block_log::import( source, target_dir, blocks_per_chunk );
+      source.close();
+
+      // compare what both formats occupy on disk, including their index files
+      const uint64_t source_size = fc::file_size( source_dir / "index" ) + fc::file_size( source_dir / "blocks" );
+      const uint64_t target_size = fc::file_size( target_dir / "chunk_index" ) + fc::file_size( target_dir / "chunks" )
+                                   + fc::file_size( target_dir / "tail" );
+      std::cout << "Uncompressed block log: " << source_size << " bytes\n"
+                << "Chunked block log:      " << target_size << " bytes\n"
+                << "Ratio:                  " << std::fixed << std::setprecision(2)
+                << double( source_size ) / std::max<uint64_t>( target_size, 1 ) << "x\n";
+   }
+   catch ( const fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      return 1;
+   }
+   return 0;
+}
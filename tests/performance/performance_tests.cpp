@@ -30,6 +30,7 @@
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/market_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 
 #include <graphene/db/simple_index.hpp>
@@ -56,6 +57,31 @@ BOOST_AUTO_TEST_CASE( sigcheck_benchmark )
    auto end = fc::time_point::now();
    auto elapsed = end-start;
    wlog( "Benchmark: verify ${sps} signatures/s", ("sps",(cycles*1000000)/elapsed.count()) );
+
+   // The same signatures once more through the recovered key cache, as when a block contains transactions that
+   // were already verified in the mempool
+   const uint32_t distinct = 1000;
+   std::vector<std::pair<digest_type,signature_type>> sigs;
+   sigs.reserve( distinct );
+   for( uint32_t i = 0; i < distinct; ++i )
+   {
+      auto d = digest_type::hash( i );
+      sigs.emplace_back( d, rsquaredchp1_key.sign_compact( d ) );
+   }
+   graphene::protocol::set_recovered_key_cache_size( distinct );
+   for( const auto& s : sigs )
+      graphene::protocol::recover_signature_key( s.second, s.first );
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < cycles; ++i )
+   {
+      const auto& s = sigs[i % distinct];
+      graphene::protocol::recover_signature_key( s.second, s.first );
+   }
+   elapsed = fc::time_point::now() - start;
+   const auto stats = graphene::protocol::get_recovered_key_cache_stats();
+   graphene::protocol::set_recovered_key_cache_size( 0 );
+   BOOST_CHECK_EQUAL( stats.hits, cycles );
+   wlog( "Benchmark: verify ${sps} cached signatures/s", ("sps",(cycles*1000000)/elapsed.count()) );
 }
 
 // See https://bitshares.org/blog/2015/06/08/measuring-performance/
@@ -210,4 +236,118 @@ BOOST_AUTO_TEST_CASE( one_hundred_k_benchmark )
    db._undo_db.enable();
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( id_lookup_benchmark )
+{ try {
+   db._undo_db.disable();
+
+   const uint64_t count = 200000;
+   const uint64_t cycles = 2000000;
+   for( uint64_t i = 0; i < count; ++i )
+      db.create<account_statistics_object>( [i]( account_statistics_object& s ) {
+         s.owner = account_id_type( i );
+         s.total_ops = i;
+      });
+
+   const auto& stats = db.get_index_type< primary_index< account_stats_index, 20 > >();
+   const auto& by_id = stats.indices().get<graphene::db::by_id>();
+   // visit the objects in an order that defeats the caches, as lookups on a live chain do
+   std::vector<object_id_type> ids;
+   ids.reserve( cycles );
+   for( uint64_t i = 0; i < cycles; ++i )
+      ids.push_back( account_statistics_id_type( i * 7919 % count ) );
+
+   uint64_t ordered_sum = 0;
+   auto start = fc::time_point::now();
+   for( const auto& id : ids )
+      ordered_sum += by_id.find( id )->total_ops;
+   auto ordered = fc::time_point::now() - start;
+
+   uint64_t direct_sum = 0;
+   start = fc::time_point::now();
+   for( const auto& id : ids )
+      direct_sum += static_cast<const account_statistics_object*>( stats.find( id ) )->total_ops;
+   auto direct = fc::time_point::now() - start;
+
+   BOOST_CHECK_EQUAL( ordered_sum, direct_sum );
+   wlog( "Benchmark: ${o} lookups/s by ordered id index, ${d} lookups/s by direct_index",
+         ("o",(cycles*1000000)/ordered.count())("d",(cycles*1000000)/direct.count()) );
+
+   db._undo_db.enable();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( modify_benchmark )
+{ try {
+   db._undo_db.disable();
+
+   const uint64_t count = 1000;
+   const uint64_t cycles = 5000000;
+   std::vector<const account_balance_object*> balances;
+   balances.reserve( count );
+   for( uint64_t i = 0; i < count; ++i )
+      balances.push_back( &db.create<account_balance_object>( [i]( account_balance_object& b ) {
+         b.owner = account_id_type( i );
+      }) );
+
+   auto start = fc::time_point::now();
+   for( uint64_t i = 0; i < cycles; ++i )
+      db.modify( *balances[i % count], []( account_balance_object& b ) { b.balance += 1; } );
+   auto elapsed = fc::time_point::now() - start;
+
+   BOOST_CHECK_EQUAL( static_cast<int64_t>( cycles / count ), balances[0]->balance.value );
+   wlog( "Benchmark: ${mps} modifications/s over ${total}ms",
+         ("mps",(cycles*1000000)/elapsed.count())("total",elapsed.count()/1000) );
+
+   db._undo_db.enable();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( market_sweep_benchmark )
+{ try {
+   ACTORS( (alice)(bob) );
+
+   const uint32_t makers = 200;
+   const uint32_t rounds = 20;
+   const asset_object& sweep = create_user_issued_asset( "SWEEP", alice_id(db), charge_market_fee,
+                                                         price( asset( 1, asset_id_type(1) ), asset( 1 ) ), 2, 100 );
+   const asset_id_type sweep_id = sweep.id;
+   issue_uia( alice_id, asset( 2 * makers * rounds * 100, sweep_id ) );
+   fund( bob_id(db), asset( 2 * makers * rounds * 300 ) );
+
+   // the same sweeps with the credits to the taker applied per fill, then once per sweep
+   auto run = [&]( bool batched, share_type& received ) {
+      db.enable_taker_fill_batching( batched );
+      const share_type balance_before = db.get_balance( bob_id, sweep_id ).amount;
+      uint64_t total_time = 0;
+      for( uint32_t r = 0; r < rounds; ++r )
+      {
+         // alice puts up a ladder of asks, then bob buys them all with one order, receiving SWEEP with a market fee
+         for( uint32_t i = 0; i < makers; ++i )
+            BOOST_REQUIRE( create_sell_order( alice_id, asset( 100, sweep_id ), asset( 100 + i ) ) != nullptr );
+
+         auto start = fc::time_point::now();
+         const limit_order_object* taker = create_sell_order( bob_id, asset( makers * 300 ),
+                                                              asset( makers * 100, sweep_id ) );
+         total_time += ( fc::time_point::now() - start ).count();
+
+         BOOST_REQUIRE( db.get_limit_order_book().best_order( sweep_id, asset_id_type() ) == nullptr );
+         if( taker != nullptr )
+            cancel_limit_order( *taker );
+      }
+      received = db.get_balance( bob_id, sweep_id ).amount - balance_before;
+      return total_time;
+   };
+
+   share_type received_per_fill;
+   share_type received_batched;
+   const uint64_t per_fill_time = run( false, received_per_fill );
+   const uint64_t batched_time = run( true, received_batched );
+
+   const uint64_t fills = uint64_t( makers ) * rounds;
+   BOOST_CHECK( received_batched > 0 );
+   BOOST_CHECK_EQUAL( received_per_fill.value, received_batched.value );
+   BOOST_CHECK( sweep_id(db).dynamic_asset_data_id(db).accumulated_fees > 0 );
+   wlog( "Benchmark: sweeping ${m} makers with one order, ${p} fills/s applying credits per fill, "
+         "${b} fills/s applying them once per sweep",
+         ("m",makers)("p",(fills*1000000)/per_fill_time)("b",(fills*1000000)/batched_time) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -630,4 +630,31 @@ BOOST_AUTO_TEST_CASE( bitasset_feed_expiration_test )
    BOOST_CHECK( !o.feed_is_expired( now ) );
 }
 
+BOOST_AUTO_TEST_CASE( recovered_key_cache )
+{ try {
+   const auto key = generate_private_key("cache");
+   const auto other = generate_private_key("other");
+   const auto d1 = digest_type::hash( std::string("one") );
+   const auto d2 = digest_type::hash( std::string("two") );
+   const auto s1 = key.sign_compact( d1 );
+   const auto s2 = other.sign_compact( d2 );
+
+   set_recovered_key_cache_size( 1 );
+   const auto before = get_recovered_key_cache_stats();
+   BOOST_CHECK( recover_signature_key( s1, d1 ) == public_key_type( key.get_public_key() ) );
+   BOOST_CHECK( recover_signature_key( s1, d1 ) == public_key_type( key.get_public_key() ) );
+   // evicts the first entry
+   BOOST_CHECK( recover_signature_key( s2, d2 ) == public_key_type( other.get_public_key() ) );
+   BOOST_CHECK( recover_signature_key( s1, d1 ) == public_key_type( key.get_public_key() ) );
+   // a cached key must not be returned for a different digest
+   BOOST_CHECK( recover_signature_key( s1, d2 ) != public_key_type( key.get_public_key() ) );
+   auto after = get_recovered_key_cache_stats();
+   BOOST_CHECK_EQUAL( after.size, 1u );
+   BOOST_CHECK_EQUAL( after.hits - before.hits, 1u );
+   BOOST_CHECK_EQUAL( after.misses - before.misses, 4u );
+
+   set_recovered_key_cache_size( 0 );
+   BOOST_CHECK_EQUAL( get_recovered_key_cache_stats().size, 0u );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
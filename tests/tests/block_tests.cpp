@@ -27,6 +27,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/chunked_block_log.hpp>
 #include <graphene/chain/exceptions.hpp>
 
 #include <graphene/chain/account_object.hpp>
@@ -43,6 +44,8 @@
 #include <fc/crypto/digest.hpp>
 #include <fc/io/fstream.hpp>
 
+#include <thread>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -72,6 +75,59 @@ genesis_state_type make_genesis() {
    return genesis_state;
 }
 
+/** Account update of @p account that only changes its memo key, to a key derived from @p seed */
+account_update_operation make_memo_key_update( const database& db, account_id_type account, uint32_t seed )
+{
+   account_update_operation op;
+   op.account = account;
+   op.new_options = account(db).options;
+   op.new_options->memo_key = fc::ecc::private_key::regenerate( fc::sha256::hash( seed ) ).get_public_key();
+   return op;
+}
+
+/** Pushes @p op, signed by the init key on top of the head block of the first database, to all of @p dbs */
+void push_init_signed( const std::vector<database*>& dbs, const operation& op )
+{
+   auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+   const database& db = *dbs.front();
+   signed_transaction trx;
+   trx.operations.push_back( op );
+   trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+   trx.set_reference_block( db.head_block_id() );
+   trx.sign( init_account_priv_key, db.get_chain_id() );
+   for( database* d : dbs )
+      d->push_transaction( precomputable_transaction(trx), database::skip_nothing );
+}
+
+/**
+ * Pushes the 13 transactions of a block of the authority verification tests to @p dbs: memo key updates of
+ * init0 to init9, which are independent of each other, a second update of init0, which conflicts with the
+ * first one, the creation of @p name by init1, whose registrar was updated earlier in the block, and an update
+ * of the new account, whose authority does not exist before the block.
+ */
+void push_authority_test_transactions( const std::vector<database*>& dbs, const string& name, uint32_t& seed )
+{
+   const database& db = *dbs.front();
+   const public_key_type init_pub_key =
+      fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) ).get_public_key();
+   const auto& by_name = db.get_index_type<account_index>().indices().get<by_name>();
+   for( uint32_t i = 0; i < 10; ++i )
+      push_init_signed( dbs, make_memo_key_update( db, by_name.find( "init" + fc::to_string(i) )->id, ++seed ) );
+   push_init_signed( dbs, make_memo_key_update( db, by_name.find( "init0" )->id, ++seed ) );
+
+   account_create_operation create;
+   create.registrar = by_name.find( "init1" )->id;
+   create.referrer = create.registrar;
+   create.name = name;
+   create.owner = authority( 1, init_pub_key, 1 );
+   create.active = authority( 1, init_pub_key, 1 );
+   create.options.memo_key = init_pub_key;
+   create.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+   const account_id_type created( db.get_index_type<account_index>().get_next_id() );
+   push_init_signed( dbs, create );
+   push_init_signed( dbs, make_memo_key_update( db, created, ++seed ) );
+}
+
 BOOST_AUTO_TEST_SUITE(block_tests)
 
 BOOST_AUTO_TEST_CASE( block_database_test )
@@ -135,6 +191,143 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( block_database_concurrent_read_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      clearable_block b;
+      std::vector<block_id_type> ids;
+      for( uint32_t i = 0; i < 100; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+         ids.push_back( b.id() );
+      }
+
+      // readers run in parallel while the writer keeps appending to the mapped files
+      std::atomic<uint32_t> failures{0};
+      std::vector<std::thread> readers;
+      for( uint32_t t = 0; t < 4; ++t )
+         readers.emplace_back( [&bdb,&ids,&failures]() {
+            for( uint32_t round = 0; round < 20; ++round )
+               for( uint32_t i = 0; i < ids.size(); ++i )
+               {
+                  auto blk = bdb.fetch_by_number( i+1 );
+                  if( !blk.valid() || blk->id() != ids[i] || !bdb.contains( ids[i] ) )
+                     ++failures;
+               }
+         } );
+
+      for( uint32_t i = 100; i < 200; ++i )
+      {
+         b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+      }
+      for( auto& reader : readers )
+         reader.join();
+      BOOST_CHECK_EQUAL( failures.load(), 0u );
+
+      auto blk = bdb.fetch_by_number( 200 );
+      BOOST_REQUIRE( blk.valid() );
+      BOOST_CHECK( blk->id() == b.id() );
+      BOOST_CHECK( bdb.fetch_block_id( 200 ) == b.id() );
+
+      bdb.remove( b.id() );
+      BOOST_CHECK( !bdb.contains( b.id() ) );
+      BOOST_CHECK( bdb.last_id().valid() );
+      BOOST_CHECK( *bdb.last_id() == b.previous );
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( chunked_block_log_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path raw_dir = data_dir.path() / "raw";
+      const fc::path chunked_dir = data_dir.path() / "chunked";
+
+      block_database raw;
+      raw.open( raw_dir );
+      block_database bdb;
+      bdb.enable_compression( 16 );
+      bdb.open( chunked_dir );
+      BOOST_REQUIRE( chunked_block_log::exists( chunked_dir ) );
+
+      clearable_block b;
+      std::vector<block_id_type> ids;
+      for( uint32_t i = 0; i < 100; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         raw.store( b.id(), b );
+         bdb.store( b.id(), b );
+         ids.push_back( b.id() );
+      }
+
+      auto check_all = [&ids]( const block_database& db ) {
+         for( uint32_t i = 0; i < ids.size(); ++i )
+         {
+            auto blk = db.fetch_by_number( i+1 );
+            BOOST_REQUIRE( blk.valid() );
+            BOOST_CHECK( blk->id() == ids[i] );
+            BOOST_CHECK( db.contains( ids[i] ) );
+            BOOST_CHECK( db.fetch_block_id( i+1 ) == ids[i] );
+            BOOST_CHECK( db.fetch_optional( ids[i] ).valid() );
+         }
+         BOOST_CHECK( !db.fetch_by_number( ids.size()+1 ).valid() );
+         BOOST_REQUIRE( db.last_id().valid() );
+         BOOST_CHECK( *db.last_id() == ids.back() );
+      };
+      check_all( bdb );
+
+      // the newest block can still be removed and replaced
+      bdb.remove( ids.back() );
+      BOOST_CHECK( !bdb.contains( ids.back() ) );
+      BOOST_CHECK( *bdb.last_id() == ids[ids.size()-2] );
+      bdb.store( ids.back(), *raw.fetch_by_number( ids.size() ) );
+
+      // chunks are only sealed once all of their blocks are irreversible
+      bdb.store( ids.front(), *raw.fetch_by_number( 1 ) );
+      bdb.set_last_irreversible_block( 64 );
+
+      // blocks in sealed chunks can not be replaced any more, the ones above them still can
+      BOOST_CHECK_THROW( bdb.store( ids.front(), *raw.fetch_by_number( 1 ) ), fc::exception );
+      BOOST_CHECK_THROW( bdb.store( ids[62], *raw.fetch_by_number( 63 ) ), fc::exception );
+      bdb.store( ids[64], *raw.fetch_by_number( 65 ) );
+
+      bdb.close();
+      bdb.open( chunked_dir );
+      check_all( bdb );
+      bdb.close();
+
+      // convert the uncompressed database
+      const fc::path imported_dir = data_dir.path() / "imported";
+      chunked_block_log::import( raw, imported_dir, 32 );
+      block_database imported;
+      imported.open( imported_dir );
+      check_all( imported );
+      imported.close();
+      raw.close();
+
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -194,6 +387,183 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( pipelined_reindex )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type head_id;
+      uint32_t head_num;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         for( uint32_t i = 0; i < 100; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         head_id = db.head_block_id();
+         head_num = db.head_block_num();
+         db.close( false );
+      }
+      // a queue much shorter than the chain makes every slot of the ring get reused many times
+      for( uint32_t threads : { 1u, 3u } )
+      {
+         database db;
+         db.wipe( data_dir.path(), false );
+         db.set_reindex_pipeline( 4, threads );
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_num );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         db.close( false );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( optimistic_execution_determinism )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      database db;
+      db.track_state_hash( 0 );
+      db.open(data_dir.path(), make_genesis, "TEST" );
+      db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+      uint32_t seed = 0;
+      for( uint32_t b = 0; b < 5; ++b )
+      {
+         push_authority_test_transactions( { &db }, "spec" + fc::to_string(b), seed );
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      }
+
+      // init3 changes its active key, and a later transaction of the block is still signed by the old key
+      const account_id_type init3 = db.get_index_type<account_index>().indices().get<by_name>().find( "init3" )->id;
+      const public_key_type new_active_key =
+         fc::ecc::private_key::regenerate( fc::sha256::hash( string("init3 active") ) ).get_public_key();
+      account_update_operation change_key;
+      change_key.account = init3;
+      change_key.active = authority( 1, new_active_key, 1 );
+      push_init_signed( { &db }, change_key );
+      signed_transaction stale_trx;
+      stale_trx.operations.push_back( make_memo_key_update( db, init3, ++seed ) );
+      stale_trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+      stale_trx.set_reference_block( db.head_block_id() );
+      stale_trx.sign( init_account_priv_key, db.get_chain_id() );
+      db.push_transaction( precomputable_transaction(stale_trx), database::skip_transaction_signatures );
+      const signed_block invalid_block = db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1),
+                                                            init_account_priv_key, database::skip_transaction_signatures );
+      BOOST_REQUIRE_EQUAL( invalid_block.transactions.size(), 2u );
+      db.pop_block();
+
+      optional<int64_t> rejection_code;
+      for( bool optimistic : { false, true } )
+      {
+         fc::temp_directory replay_dir( graphene::utilities::temp_directory_path() );
+         database replay;
+         replay.track_state_hash( 0 );
+         replay.enable_optimistic_execution( optimistic );
+         replay.open(replay_dir.path(), make_genesis, "TEST" );
+         while( replay.head_block_num() < db.head_block_num() )
+         {
+            replay.push_block( *db.fetch_block_by_number( replay.head_block_num() + 1 ), database::skip_nothing );
+            BOOST_CHECK( replay.get_block_state_hash().state_hash == replay.get_state_hash() );
+         }
+         BOOST_CHECK( replay.head_block_id() == db.head_block_id() );
+         BOOST_CHECK( replay.get_block_state_hash().state_hash == db.get_block_state_hash().state_hash );
+
+         const optimistic_execution_stats& stats = replay.get_optimistic_execution_stats();
+         if( optimistic )
+         {
+            BOOST_CHECK_EQUAL( stats.speculated, 50u );
+            BOOST_CHECK_EQUAL( stats.reverified, 15u );
+         }
+         else
+            BOOST_CHECK_EQUAL( stats.speculated + stats.reverified, 0u );
+
+         // the stale signature was valid on top of the head block, the block must still be rejected
+         try {
+            replay.push_block( invalid_block, database::skip_nothing );
+            BOOST_ERROR( "Block with a transaction signed by a replaced key was accepted" );
+         } catch( const fc::exception& e ) {
+            if( rejection_code.valid() )
+               BOOST_CHECK_EQUAL( e.code(), *rejection_code );
+            rejection_code = e.code();
+         }
+         BOOST_CHECK( replay.head_block_id() == db.head_block_id() );
+         BOOST_CHECK( replay.get_state_hash() == db.get_block_state_hash().state_hash );
+         replay.close();
+      }
+      db.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( authority_cache_block_apply )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      database db;
+      db.track_state_hash( 0 );
+      db.open(data_dir.path(), make_genesis, "TEST" );
+      database db2;
+      db2.track_state_hash( 0 );
+      db2.set_authority_cache_size( 100 );
+      db2.open(data_dir2.path(), make_genesis, "TEST" );
+      db2.push_block( db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                        database::skip_nothing), database::skip_nothing );
+
+      const auto& by_name = db.get_index_type<account_index>().indices().get<by_name>();
+      uint32_t seed = 0;
+      for( uint32_t b = 0; b < 3; ++b )
+      {
+         // both nodes receive the transactions before the block. The independent updates are verified on top
+         // of the head block and cached, the other three are verified on top of earlier pending transactions
+         push_authority_test_transactions( { &db, &db2 }, "cached" + fc::to_string(b), seed );
+
+         const signed_block block = db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1),
+                                                       init_account_priv_key, database::skip_nothing );
+         BOOST_CHECK_EQUAL( block.transactions.size(), 13u );
+         db2.push_block( block, database::skip_nothing );
+         BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+         BOOST_CHECK( db2.get_block_state_hash().state_hash == db.get_block_state_hash().state_hash );
+         BOOST_CHECK( db2.get_pending_transactions().empty() );
+      }
+
+      const authority_cache_stats stats = db2.get_authority_cache_stats();
+      BOOST_CHECK_EQUAL( stats.hits, 30u );
+      BOOST_CHECK_EQUAL( stats.misses, 9u );
+      BOOST_CHECK_EQUAL( stats.size, 0u );
+
+      // a transaction still pending after a block is verified on top of the new head block
+      signed_transaction trx;
+      trx.operations.push_back( make_memo_key_update( db, by_name.find( "init2" )->id, ++seed ) );
+      trx.set_expiration( db.head_block_time() + fc::minutes(5) );
+      trx.set_reference_block( db.head_block_id() );
+      trx.sign( init_account_priv_key, db.get_chain_id() );
+      db2.push_transaction( precomputable_transaction(trx), database::skip_nothing );
+      db2.push_block( db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                        database::skip_nothing), database::skip_nothing );
+      BOOST_CHECK_EQUAL( db2.get_pending_transactions().size(), 1u );
+      BOOST_CHECK_EQUAL( db2.get_authority_cache_stats().size, 1u );
+      db.push_transaction( precomputable_transaction(trx), database::skip_nothing );
+      db2.push_block( db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                        database::skip_nothing), database::skip_nothing );
+      BOOST_CHECK_EQUAL( db2.get_authority_cache_stats().hits, 31u );
+      BOOST_CHECK( db2.get_block_state_hash().state_hash == db.get_block_state_hash().state_hash );
+
+      db2.close();
+      db.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -489,6 +859,116 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
 /**
  *  These test has been disabled, out of order blocks should result in the node getting disconnected.
  *  
+BOOST_AUTO_TEST_CASE( fork_switch_reuses_changes )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir3( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      const public_key_type init_pub_key = init_account_priv_key.get_public_key();
+
+      // db1 and db2 produce competing forks, db3 follows whichever is longer
+      database db1;
+      database db2;
+      database db3;
+      for( database* db : { &db1, &db2, &db3 } )
+         db->track_state_hash( 0 );
+      db3.enable_fork_change_reuse( true );
+      db1.open(data_dir1.path(), make_genesis, "TEST");
+      db2.open(data_dir2.path(), make_genesis, "TEST");
+      db3.open(data_dir3.path(), make_genesis, "TEST");
+      std::vector< std::pair<block_id_type, size_t> > applied;
+      db3.applied_block.connect( [&db3,&applied]( const signed_block& b ) {
+         applied.emplace_back( b.id(), db3.get_applied_operations().size() );
+      });
+
+      uint32_t seed = 0;
+      auto produce = [&]( database& db, uint32_t slot ) {
+         const auto& by_name = db.get_index_type<account_index>().indices().get<by_name>();
+         signed_transaction trx;
+         account_update_operation update;
+         update.account = by_name.find( "init" + fc::to_string( seed % 10 ) )->id;
+         update.new_options = update.account(db).options;
+         update.new_options->memo_key = fc::ecc::private_key::regenerate( fc::sha256::hash( ++seed ) ).get_public_key();
+         trx.operations.push_back( update );
+         account_create_operation create;
+         create.registrar = by_name.find( "init0" )->id;
+         create.referrer = create.registrar;
+         create.name = "fork" + fc::to_string( seed );
+         create.owner = authority( 1, init_pub_key, 1 );
+         create.active = authority( 1, init_pub_key, 1 );
+         create.options.memo_key = init_pub_key;
+         create.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+         trx.operations.push_back( create );
+         trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+         trx.set_reference_block( db.head_block_id() );
+         trx.sign( init_account_priv_key, db.get_chain_id() );
+         db.push_transaction( precomputable_transaction(trx), database::skip_nothing );
+         return db.generate_block( db.get_slot_time(slot), db.get_scheduled_witness(slot), init_account_priv_key,
+                                   database::skip_nothing );
+      };
+
+      for( uint32_t i = 0; i < 3; ++i )
+      {
+         const signed_block b = produce( db1, 1 );
+         PUSH_BLOCK( db2, b );
+         PUSH_BLOCK( db3, b );
+      }
+
+      // db3 follows db1
+      for( uint32_t i = 0; i < 2; ++i )
+         PUSH_BLOCK( db3, produce( db1, 1 ) );
+      // db2 produces in other slots, its fork becomes longer
+      PUSH_BLOCK( db3, produce( db2, 2 ) );
+      PUSH_BLOCK( db3, produce( db2, 1 ) );
+      BOOST_CHECK( db3.head_block_id() == db1.head_block_id() );
+      PUSH_BLOCK( db3, produce( db2, 1 ) );
+      BOOST_CHECK( db3.head_block_id() == db2.head_block_id() );
+      BOOST_CHECK( db3.get_block_state_hash().state_hash == db2.get_block_state_hash().state_hash );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().switches, 1u );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().blocks_popped, 2u );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().blocks_reused, 0u );
+
+      // back to db1, whose first two blocks were applied by db3 before
+      PUSH_BLOCK( db3, produce( db1, 1 ) );
+      PUSH_BLOCK( db3, produce( db1, 1 ) );
+      BOOST_CHECK( db3.head_block_id() == db1.head_block_id() );
+      BOOST_CHECK( db3.get_block_state_hash().state_hash == db1.get_block_state_hash().state_hash );
+      BOOST_CHECK( db3.get_state_hash() == db1.get_state_hash() );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().switches, 2u );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().blocks_reused, 2u );
+      // reused blocks are announced like executed ones, with their operations
+      BOOST_REQUIRE_GE( applied.size(), 4u );
+      for( uint32_t i = 0; i < 4; ++i )
+      {
+         const auto& entry = applied[ applied.size() - 4 + i ];
+         BOOST_CHECK( entry.first == db1.fetch_block_by_number( db1.head_block_num() - 3 + i )->id() );
+         BOOST_CHECK_GT( entry.second, 0u );
+      }
+
+      // and to db2 again, whose blocks are reused this time
+      PUSH_BLOCK( db3, produce( db2, 1 ) );
+      PUSH_BLOCK( db3, produce( db2, 1 ) );
+      BOOST_CHECK( db3.head_block_id() == db2.head_block_id() );
+      BOOST_CHECK( db3.get_block_state_hash().state_hash == db2.get_block_state_hash().state_hash );
+      BOOST_CHECK( db3.get_state_hash() == db2.get_state_hash() );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().switches, 3u );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().blocks_popped, 2u + 3u + 4u );
+      BOOST_CHECK_EQUAL( db3.get_fork_switch_stats().blocks_reused, 2u + 3u );
+
+      // the new head extends the chain as usual
+      const signed_block b = produce( db2, 1 );
+      PUSH_BLOCK( db3, b );
+      BOOST_CHECK( db3.get_block_state_hash().state_hash == db2.get_block_state_hash().state_hash );
+      const auto& by_name = db3.get_index_type<account_index>().indices().get<by_name>();
+      BOOST_CHECK( by_name.find( "fork" + fc::to_string( seed ) ) != by_name.end() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( fork_db_tests )
 {
    try {
@@ -1874,4 +2354,81 @@ BOOST_FIXTURE_TEST_CASE( block_size_test, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( generate_block_from_pending_state, database_fixture )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      const asset_id_type test_asset = create_user_issued_asset( "PENDTEST", alice, 0 ).id;
+      transfer(committee_account, alice_id, asset(100000));
+      generate_block();
+
+      for( bool touch_pending_state : { false, true } )
+      {
+         vector<limit_order_id_type> orders;
+         for( int64_t i = 1; i <= 3; ++i )
+         {
+            transfer( alice_id, bob_id, asset(i) );
+            orders.push_back( create_sell_order( alice_id, asset(100 * i), asset(i, test_asset) )->id );
+         }
+         // a change outside of the pending transactions makes block generation apply them again
+         if( touch_pending_state )
+            db.modify( db.get_dynamic_global_properties(), []( dynamic_global_property_object& ) {} );
+
+         const signed_block block = generate_block();
+         BOOST_REQUIRE_EQUAL( block.transactions.size(), 6u );
+         for( size_t i = 0; i < orders.size(); ++i )
+         {
+            BOOST_REQUIRE( block.transactions[2*i+1].operation_results.size() == 1u );
+            BOOST_CHECK( block.transactions[2*i+1].operation_results[0].get<object_id_type>() == orders[i] );
+            BOOST_REQUIRE( db.find( orders[i] ) != nullptr );
+            BOOST_CHECK( orders[i](db).seller == alice_id );
+         }
+      }
+      BOOST_CHECK_EQUAL( get_balance( bob_id, asset_id_type() ), 12 );
+   }
+   catch( fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( precompute_block_caches, database_fixture )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      transfer(committee_account, alice_id, asset(10000000));
+      for( int64_t i = 1; i <= 20; ++i )
+         transfer(alice_id, bob_id, asset(i));
+      generate_block();
+
+      // a freshly deserialized block has nothing cached yet
+      fc::optional<signed_block> blk = db.fetch_block_by_number( db.head_block_num() );
+      BOOST_REQUIRE( blk.valid() );
+      BOOST_REQUIRE_GT( blk->transactions.size(), 20u );
+      db.precompute_parallel( *blk ).wait();
+
+      BOOST_CHECK( blk->calculate_merkle_root() == blk->transaction_merkle_root );
+      BOOST_CHECK_EQUAL( blk->get_packed_size(), fc::raw::pack_size( *blk ) );
+      for( const auto& trx : blk->transactions )
+      {
+         digest_type::encoder enc;
+         fc::raw::pack( enc, trx );
+         BOOST_CHECK( trx.merkle_digest() == enc.result() );
+      }
+
+      // the cached values must also be accepted by apply_block
+      db.pop_block();
+      db.push_block( *blk );
+      BOOST_CHECK( db.head_block_id() == blk->id() );
+   }
+   catch( fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,9 +28,20 @@
 #include <graphene/chain/database.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/expiration_wheel.hpp>
+#include <graphene/chain/global_property_object.hpp>
+#include <graphene/chain/lottery_schedule.hpp>
+#include <graphene/chain/margin_call_watermarks.hpp>
+#include <graphene/chain/market_object.hpp>
+#include <graphene/chain/nft_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
+#include <fc/io/fstream.hpp>
+#include <fstream>
 
 #include "../common/database_fixture.hpp"
 
@@ -109,6 +120,323 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( flat_id_map_test )
+{ try {
+   graphene::db::flat_id_map<uint64_t> map;
+   std::map<object_id_type, uint64_t> reference;
+   // ids of several types interleaved, erased in an order that exercises the backward shift of erase
+   for( uint64_t i = 0; i < 5000; ++i )
+   {
+      object_id_type id( 1 + i % 2, i % 7, i * 13 % 4001 );
+      map[id] = i;
+      reference[id] = i;
+      if( i % 3 == 0 )
+      {
+         object_id_type old_id( 1 + (i/2) % 2, (i/2) % 7, (i/2) * 13 % 4001 );
+         BOOST_CHECK_EQUAL( reference.erase( old_id ), map.erase( old_id ) );
+      }
+   }
+   BOOST_CHECK_EQUAL( reference.size(), map.size() );
+   for( const auto& item : reference )
+   {
+      auto itr = map.find( item.first );
+      BOOST_REQUIRE( itr != map.end() );
+      BOOST_CHECK_EQUAL( item.second, itr->second );
+   }
+   size_t count = 0;
+   for( const auto& item : map )
+   {
+      BOOST_CHECK_EQUAL( 1u, reference.count( item.first ) );
+      ++count;
+   }
+   BOOST_CHECK_EQUAL( reference.size(), count );
+
+   graphene::db::flat_id_set set;
+   set.insert( account_id_type(1) );
+   set.insert( account_id_type(1) );
+   set.insert( asset_id_type(1) );
+   BOOST_CHECK_EQUAL( 2u, set.size() );
+   BOOST_CHECK( set.find( account_id_type(1) ) != set.end() );
+   BOOST_CHECK_EQUAL( 1u, set.erase( asset_id_type(1) ) );
+   BOOST_CHECK_EQUAL( 0u, set.count( asset_id_type(1) ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( field_undo_test )
+{ try {
+   auto count_fields = []( const graphene::db::field_undo_record& record ) {
+      size_t count = 0;
+      for( graphene::db::field_undo_record::reader r( record ); r.valid(); r.next() )
+         ++count;
+      return count;
+   };
+
+   const global_property_object& gpo = db.get_global_properties();
+   const uint32_t vote_id = gpo.next_available_vote_id;
+   const auto witnesses = gpo.active_witnesses;
+   const auto committee = gpo.active_committee_members;
+   BOOST_REQUIRE( gpo.field_undo_enabled() );
+   BOOST_REQUIRE( !witnesses.empty() );
+
+   // trimming keeps only the modified fields, restoring them gives back the original object
+   global_property_object copy = gpo;
+   graphene::db::field_undo_record record;
+   copy.capture_fields( record );
+   BOOST_CHECK( record.complete );
+   copy.next_available_vote_id += 7;
+   copy.active_witnesses.clear();
+   copy.trim_fields( record );
+   BOOST_CHECK( !record.complete );
+   BOOST_CHECK_EQUAL( 2u, count_fields( record ) );
+   copy.restore_fields( record );
+   BOOST_CHECK_EQUAL( vote_id, copy.next_available_vote_id );
+   BOOST_CHECK( witnesses == copy.active_witnesses );
+
+   // undo of nested modifications that were merged
+   {
+      auto outer = db._undo_db.start_undo_session();
+      db.modify( gpo, []( global_property_object& p ) { p.next_available_vote_id += 10; } );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         db.modify( gpo, []( global_property_object& p ) {
+            p.next_available_vote_id += 5;
+            p.active_witnesses.clear();
+            p.active_committee_members.clear();
+         });
+         inner.merge();
+      }
+      BOOST_CHECK_EQUAL( 0u, db._undo_db.head().old_values.count( gpo.id ) );
+      BOOST_REQUIRE_EQUAL( 1u, db._undo_db.head().old_fields.count( gpo.id ) );
+      BOOST_CHECK_EQUAL( vote_id + 15, gpo.next_available_vote_id );
+      outer.undo();
+   }
+   BOOST_CHECK_EQUAL( vote_id, gpo.next_available_vote_id );
+   BOOST_CHECK( witnesses == gpo.active_witnesses );
+   BOOST_CHECK( committee == gpo.active_committee_members );
+
+   // merging a trimmed record with a later one keeps the older values
+   graphene::db::field_undo_record older;
+   copy.capture_fields( older );
+   copy.next_available_vote_id += 1;
+   copy.trim_fields( older );
+   graphene::db::field_undo_record newer;
+   copy.capture_fields( newer );
+   copy.next_available_vote_id += 1;
+   copy.active_witnesses.clear();
+   older.add_missing( newer );
+   BOOST_CHECK( older.complete );
+   copy.restore_fields( older );
+   BOOST_CHECK_EQUAL( vote_id, copy.next_available_vote_id );
+   BOOST_CHECK( witnesses == copy.active_witnesses );
+
+   // members that are not reflected are restored too
+   const account_statistics_object& stats = account_id_type()(db).statistics(db);
+   BOOST_REQUIRE( stats.field_undo_enabled() );
+   const share_type pob = stats.total_core_pob;
+   const share_type fees = stats.pending_fees;
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( stats, []( account_statistics_object& s ) {
+         s.total_core_pob += 100;
+         s.pending_fees += 10;
+      });
+      BOOST_REQUIRE_EQUAL( 1u, db._undo_db.head().old_fields.count( stats.id ) );
+      session.undo();
+   }
+   BOOST_CHECK_EQUAL( pob.value, stats.total_core_pob.value );
+   BOOST_CHECK_EQUAL( fees.value, stats.pending_fees.value );
+
+   const asset_dynamic_data_object& core_dd = asset_id_type()(db).dynamic_asset_data_id(db);
+   BOOST_REQUIRE( core_dd.field_undo_enabled() );
+   asset_dynamic_data_object dd_copy = core_dd;
+   graphene::db::field_undo_record dd_record;
+   dd_copy.capture_fields( dd_record );
+   dd_copy.sweeps_tickets_sold = 5;
+   dd_copy.trim_fields( dd_record );
+   BOOST_CHECK_EQUAL( 1u, count_fields( dd_record ) );
+   dd_copy.restore_fields( dd_record );
+   BOOST_CHECK( dd_copy.sweeps_tickets_sold == core_dd.sweeps_tickets_sold );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( hashed_id_lookup_test )
+{ try {
+   database db;
+   const auto& orders = db.get_index_type< primary_index< limit_order_index > >();
+   std::vector<limit_order_id_type> ids;
+   for( int i = 0; i < 1000; ++i )
+   {
+      ids.push_back( db.create<limit_order_object>( [i]( limit_order_object& o ) {
+         o.for_sale = i;
+      }).get_id() );
+   }
+   // remove every third order, as a sparse id space is what the hash table is for
+   for( size_t i = 0; i < ids.size(); i += 3 )
+      db.remove( db.get( ids[i] ) );
+
+   for( size_t i = 0; i < ids.size(); ++i )
+   {
+      const object* found = orders.find( ids[i] );
+      if( i % 3 == 0 )
+         BOOST_CHECK( found == nullptr );
+      else
+      {
+         BOOST_REQUIRE( found != nullptr );
+         BOOST_CHECK_EQUAL( static_cast<int64_t>(i), static_cast<const limit_order_object*>(found)->for_sale.value );
+      }
+   }
+   BOOST_CHECK( orders.find( limit_order_id_type( ids.size() + 10 ) ) == nullptr );
+   BOOST_CHECK_EQUAL( orders.get_secondary_index< graphene::db::hashed_id_index<limit_order_object> >().size(),
+                      orders.indices().size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( memory_usage_test )
+{ try {
+   ACTORS( (alice)(bob) );
+
+   auto find_usage = []( const graphene::db::database_memory_usage& usage, uint8_t space, uint8_t type ) {
+      for( const auto& item : usage.indexes )
+         if( item.space_id == space && item.type_id == type )
+            return item;
+      BOOST_FAIL( "index not reported" );
+      return graphene::db::index_memory_usage();
+   };
+
+   auto before = db.get_memory_usage();
+   auto accounts = find_usage( before, account_object::space_id, account_object::type_id );
+   BOOST_CHECK_EQUAL( db.get_index_type<account_index>().indices().size(), accounts.object_count );
+   BOOST_CHECK_GE( accounts.object_bytes, accounts.object_count * sizeof(account_object) );
+   // accounts use direct_index
+   BOOST_CHECK_GT( accounts.secondary_index_bytes, 0u );
+   auto gpo = find_usage( before, global_property_object::space_id, global_property_object::type_id );
+   BOOST_CHECK_EQUAL( 1u, gpo.object_count );
+
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( alice, []( account_object& a ) { a.name = "alice2"; } );
+      auto during = db.get_memory_usage();
+      BOOST_REQUIRE_EQUAL( before.undo_states.size() + 1, during.undo_states.size() );
+      BOOST_CHECK_GE( during.undo_states.back(), sizeof(account_object) );
+      BOOST_CHECK_GT( during.total_bytes(), 0u );
+   }
+   BOOST_CHECK_EQUAL( before.undo_states.size(), db.get_memory_usage().undo_states.size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( state_snapshot_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   transfer( committee_account, alice_id, asset( 100000 ) );
+   generate_blocks( 30 );
+   transfer( alice_id, bob_id, asset( 500 ) );
+   generate_block();
+   const uint32_t lib = db.get_dynamic_global_properties().last_irreversible_block_num;
+   BOOST_REQUIRE_GT( lib, 0u );
+
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = dir.path() / "state.bin";
+   const block_id_type head_id = db.head_block_id();
+   db.write_state_snapshot( file );
+   BOOST_CHECK( db.head_block_id() == head_id );
+   BOOST_CHECK( !fc::exists( dir.path() / "state.bin.tmp" ) );
+
+   // a snapshot kept in memory and written later is the same as one written directly
+   {
+      graphene::db::snapshot_writer direct( dir.path() / "direct.bin", 64 );
+      graphene::db::snapshot_writer kept( 64 );
+      for( uint32_t i = 0; i < 100; ++i )
+      {
+         direct.pack( i );
+         kept.pack( i );
+      }
+      const std::string large( 200, 'x' );
+      direct.pack( large );
+      kept.pack( large );
+      const fc::sha256 checksum = direct.finish();
+      BOOST_CHECK( graphene::db::snapshot_writer::write_file( dir.path() / "kept.bin", kept.release() ) == checksum );
+   }
+   std::string direct_data;
+   std::string kept_data;
+   fc::read_file_contents( dir.path() / "direct.bin", direct_data );
+   fc::read_file_contents( dir.path() / "kept.bin", kept_data );
+   BOOST_CHECK( direct_data == kept_data );
+
+   auto dump = []( const database& d ) {
+      std::vector<std::string> result;
+      for( const auto& usage : d.get_memory_usage().indexes )
+         d.get_index( usage.space_id, usage.type_id ).inspect_all_objects( [&result]( const object& o ) {
+            result.push_back( fc::json::to_string( o.to_variant() ) );
+         });
+      return result;
+   };
+
+   // the snapshot holds the state at the last irreversible block
+   while( db.head_block_num() > lib )
+      db.pop_block();
+   const auto expected = dump( db );
+
+   database restored;
+   const fc::path restored_dir = dir.path() / "restored";
+   restored.load_state_snapshot( file, restored_dir, db.get_chain_id(), "TEST" );
+   restored.open( restored_dir, []{ return genesis_state_type(); }, "TEST" );
+   BOOST_CHECK_EQUAL( restored.head_block_num(), lib );
+   BOOST_CHECK( restored.head_block_id() == db.head_block_id() );
+   BOOST_CHECK( dump( restored ) == expected );
+
+   // syncing continues with the block after the snapshot
+   const signed_block next = generate_block();
+   restored.push_block( next, ~0 );
+   BOOST_CHECK( restored.head_block_id() == db.head_block_id() );
+   restored.close();
+
+   // snapshots are self-verifying
+   {
+      std::fstream f( file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekg( 100 );
+      const char c = f.get();
+      f.seekp( 100 );
+      f.put( ~c );
+   }
+   database corrupted;
+   BOOST_CHECK_THROW( corrupted.load_state_snapshot( file, dir.path() / "corrupted", db.get_chain_id(), "TEST" ),
+                      fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( state_hash_test )
+{ try {
+   db.track_state_hash( 0 );
+   ACTORS( (alice)(bob) );
+   generate_block();
+
+   const block_state_hash before = db.get_block_state_hash();
+   BOOST_CHECK_EQUAL( before.block_num, db.head_block_num() );
+   BOOST_CHECK( before.block_id == db.head_block_id() );
+   BOOST_CHECK( before.state_hash == db.get_state_hash() );
+   // the incrementally maintained digests match digests computed from scratch
+   for( const auto& digest : before.indexes )
+   {
+      graphene::db::index_state_hasher hasher( digest.space_id, digest.type_id );
+      hasher.reset( db.get_index( digest.space_id, digest.type_id ) );
+      BOOST_CHECK_EQUAL( hasher.result().object_count, digest.object_count );
+      BOOST_CHECK_EQUAL( hasher.result().digest, digest.digest );
+   }
+
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( alice, []( account_object& a ) { a.name = "alice2"; } );
+      BOOST_CHECK( db.get_state_hash() != before.state_hash );
+   }
+   BOOST_CHECK( db.get_state_hash() == before.state_hash );
+
+   // popping a block and applying it again ends in the same state
+   transfer( committee_account, bob_id, asset( 1000 ) );
+   const signed_block block = generate_block();
+   const fc::sha256 after = db.get_block_state_hash().state_hash;
+   BOOST_CHECK( after != before.state_hash );
+   db.pop_block();
+   BOOST_CHECK_EQUAL( db.get_block_state_hash().block_num, before.block_num );
+   BOOST_CHECK( db.get_block_state_hash().state_hash == before.state_hash );
+   db.push_block( block, ~0 );
+   BOOST_CHECK( db.get_block_state_hash().state_hash == after );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( direct_index_test )
 { try {
    try {
@@ -194,6 +522,76 @@ BOOST_AUTO_TEST_CASE( direct_index_test )
    // but the secondary has not updated its representation
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( index_snapshot_test )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "accounts";
+   graphene::db::null_safety_check check;
+
+   graphene::db::primary_index< account_index > saved( db, check );
+   for( uint32_t i = 0; i < 100; ++i )
+   {
+      account_object acct;
+      acct.id = account_id_type( i * 2 );
+      acct.name = "account" + std::to_string( i * 2 );
+      saved.load( fc::raw::pack( acct ) );
+   }
+   saved.set_next_id( account_id_type( 200 ) );
+   saved.save( file );
+
+   graphene::db::primary_index< account_index, 8 > loaded( db, check );
+   loaded.open( file );
+   BOOST_CHECK_EQUAL( 100u, loaded.indices().size() );
+   BOOST_CHECK( loaded.get_next_id() == account_id_type( 200 ) );
+   const auto& direct = loaded.get_secondary_index<graphene::db::direct_index< account_object, 8 >>();
+   for( uint32_t i = 0; i < 200; ++i )
+   {
+      const account_object* acct = direct.find( account_id_type( i ) );
+      BOOST_CHECK_EQUAL( i % 2 == 0, acct != nullptr );
+      if( acct != nullptr )
+         BOOST_CHECK_EQUAL( "account" + std::to_string( i ), acct->name );
+   }
+   BOOST_CHECK( loaded.indices().get<by_name>().find( "account42" ) != loaded.indices().get<by_name>().end() );
+
+   // a damaged file is rejected instead of being loaded partially
+   {
+      std::fstream f( file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekg( 100 );
+      const char c = f.get();
+      f.seekp( 100 );
+      f.put( ~c );
+   }
+   graphene::db::primary_index< account_index > corrupted( db, check );
+   GRAPHENE_REQUIRE_THROW( corrupted.open( file ), fc::assert_exception );
+   BOOST_CHECK_EQUAL( 0u, corrupted.indices().size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( direct_index_gap_check_test )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "accounts";
+   graphene::db::null_safety_check check;
+
+   // an index with a gap too large for direct_index is fine in an ordered index
+   graphene::db::primary_index< account_index > saved( db, check );
+   for( uint32_t i : { 0, 1, 2, 500, 501 } )
+   {
+      account_object acct;
+      acct.id = account_id_type( i );
+      acct.name = "account" + std::to_string( i );
+      saved.load( fc::raw::pack( acct ) );
+   }
+   saved.set_next_id( account_id_type( 502 ) );
+   saved.save( file );
+
+   graphene::db::primary_index< account_index > ordered( db, check );
+   ordered.open( file );
+   BOOST_CHECK_EQUAL( 5u, ordered.indices().size() );
+
+   graphene::db::primary_index< account_index, 8 > direct( db, check );
+   GRAPHENE_REQUIRE_THROW( direct.open( file ), fc::assert_exception );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( required_approval_index_test ) // see https://github.com/bitshares/bitshares-core/issues/1719
 { try {
    ACTORS( (alice)(bob)(charlie)(agnetha)(benny)(carlos) );
@@ -281,4 +679,357 @@ BOOST_AUTO_TEST_CASE( required_approval_index_test ) // see https://github.com/b
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( limit_order_book_index_test )
+{ try {
+   database db1;
+   db1.initialize_indexes();
+   const limit_order_book_index& book = db1.get_limit_order_book();
+   const auto& by_price_idx = db1.get_index_type<limit_order_index>().indices().get<by_price>();
+
+   const asset_id_type core_id;
+   const asset_id_type usd_id( 1 );
+
+   // the book must list the same orders as by_price, and sum them up correctly per level
+   auto check_side = [&]( asset_id_type sell, asset_id_type receive ) {
+      vector<limit_order_id_type> expected;
+      for( auto itr = by_price_idx.lower_bound( price::max( sell, receive ) );
+           itr != by_price_idx.end() && itr->sell_asset_id() == sell && itr->receive_asset_id() == receive; ++itr )
+         expected.push_back( itr->id );
+      vector<limit_order_id_type> listed;
+      book.visit_side( sell, receive, [&listed]( const limit_order_object& o ) {
+         listed.push_back( o.id );
+         return true;
+      });
+      BOOST_CHECK( expected == listed );
+      const auto* side = book.find_side( sell, receive );
+      BOOST_CHECK_EQUAL( expected.empty(), side == nullptr );
+      if( side == nullptr )
+         return;
+      for( const auto& level : *side )
+      {
+         share_type total;
+         for( const limit_order_object* o : level.orders )
+         {
+            BOOST_CHECK( o->sell_price == level.level_price );
+            total += o->for_sale;
+         }
+         BOOST_CHECK_EQUAL( total.value, level.for_sale.value );
+      }
+   };
+   auto check_book = [&]() {
+      check_side( core_id, usd_id );
+      check_side( usd_id, core_id );
+   };
+
+   auto create_order = [&db1]( const asset& sell, const asset& receive ) -> const limit_order_object& {
+      return db1.create<limit_order_object>( [&]( limit_order_object& o ) {
+         o.seller = account_id_type();
+         o.for_sale = sell.amount;
+         o.sell_price = sell / receive;
+      });
+   };
+
+   BOOST_CHECK( book.best_order( core_id, usd_id ) == nullptr );
+
+   const auto& bid1 = create_order( asset( 100, core_id ), asset( 10, usd_id ) );
+   const auto& bid2 = create_order( asset( 300, core_id ), asset( 20, usd_id ) );
+   const auto& bid3 = create_order( asset( 200, core_id ), asset( 20, usd_id ) ); // same price as bid1
+   const auto& ask1 = create_order( asset( 10, usd_id ), asset( 200, core_id ) );
+   const limit_order_id_type bid2_id = bid2.id;
+   check_book();
+   BOOST_CHECK( book.best_order( core_id, usd_id ) == &bid2 );
+   BOOST_CHECK( book.best_order( usd_id, core_id ) == &ask1 );
+   BOOST_REQUIRE( book.find_side( core_id, usd_id ) != nullptr );
+   BOOST_CHECK_EQUAL( 2u, book.find_side( core_id, usd_id )->size() );
+   BOOST_CHECK_EQUAL( 300, book.find_side( core_id, usd_id )->front().for_sale.value );
+
+   {
+      auto session = db1._undo_db.start_undo_session();
+
+      // a partial fill changes the amount of the level only
+      db1.modify( bid1, []( limit_order_object& o ) { o.for_sale -= 40; } );
+      check_book();
+      BOOST_CHECK_EQUAL( 260, book.find_side( core_id, usd_id )->front().for_sale.value );
+
+      // a full fill removes the best order
+      db1.remove( bid2 );
+      check_book();
+      BOOST_CHECK( book.best_order( core_id, usd_id ) == &bid1 );
+
+      // repricing moves the order to another level
+      db1.modify( bid3, []( limit_order_object& o ) { o.sell_price = asset( 200, core_id ) / asset( 40, usd_id ); } );
+      check_book();
+      BOOST_CHECK( book.best_order( core_id, usd_id ) == &bid1 );
+      BOOST_CHECK_EQUAL( 2u, book.find_side( core_id, usd_id )->size() );
+
+      db1.remove( ask1 );
+      check_book();
+      BOOST_CHECK( book.best_order( usd_id, core_id ) == nullptr );
+
+      // undoing restores the book
+      session.undo();
+   }
+   check_book();
+   BOOST_REQUIRE( book.best_order( core_id, usd_id ) != nullptr );
+   BOOST_CHECK( book.best_order( core_id, usd_id )->id == bid2_id );
+   BOOST_CHECK( book.best_order( usd_id, core_id ) != nullptr );
+
+   // stopping the visit early
+   uint32_t visited = 0;
+   book.visit_side( core_id, usd_id, [&visited]( const limit_order_object& ) { return ++visited < 2; } );
+   BOOST_CHECK_EQUAL( 2u, visited );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( margin_call_watermarks_test )
+{ try {
+   database db1;
+   db1.initialize_indexes();
+   margin_call_watermarks watermarks;
+   db1.add_secondary_indexer< primary_index<limit_order_index>,
+                              index_observer< limit_order_object, margin_call_watermarks > >( &watermarks );
+   db1.add_secondary_indexer< primary_index<call_order_index>,
+                              index_observer< call_order_object, margin_call_watermarks > >( &watermarks );
+   db1.add_secondary_indexer< primary_index<asset_bitasset_data_index, 13>,
+                              index_observer< asset_bitasset_data_object, margin_call_watermarks > >( &watermarks );
+
+   const asset_id_type core_id;
+   const asset_id_type usd_id( 1 );
+   const asset_id_type other_id( 2 );
+   // orders selling 1 USD for 2 CORE or less would need a margin call check
+   const price watermark = asset( 1, usd_id ) / asset( 2, core_id );
+
+   auto create_order = [&db1]( const asset& sell, const asset& receive ) -> const limit_order_object& {
+      return db1.create<limit_order_object>( [&]( limit_order_object& o ) {
+         o.seller = account_id_type();
+         o.for_sale = sell.amount;
+         o.sell_price = sell / receive;
+      });
+   };
+
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+   watermarks.set( watermark );
+   BOOST_CHECK( watermarks.can_skip( usd_id ) );
+   BOOST_CHECK( !watermarks.can_skip( other_id ) );
+
+   // orders below the watermark, in other markets or on the other side do not matter
+   const auto& low_ask = create_order( asset( 10, usd_id ), asset( 40, core_id ) );
+   create_order( asset( 10, usd_id ), asset( 1, other_id ) );
+   create_order( asset( 10, core_id ), asset( 1, usd_id ) );
+   db1.modify( low_ask, []( limit_order_object& o ) { o.for_sale -= 5; } );
+   db1.remove( low_ask );
+   BOOST_CHECK( watermarks.can_skip( usd_id ) );
+
+   // an order at the watermark does
+   const auto& ask = create_order( asset( 10, usd_id ), asset( 20, core_id ) );
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+   watermarks.set( watermark );
+   db1.modify( ask, []( limit_order_object& o ) { o.for_sale -= 5; } );
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+
+   // so do the call orders of the asset and its bitasset data
+   watermarks.set( watermark );
+   const auto& call = db1.create<call_order_object>( [&]( call_order_object& o ) {
+      o.borrower = account_id_type();
+      o.debt = 100;
+      o.collateral = 300;
+      o.call_price = asset( 300, core_id ) / asset( 100, usd_id );
+   });
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+   watermarks.set( watermark );
+   db1.modify( call, []( call_order_object& o ) { o.collateral += 100; } );
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+   watermarks.set( watermark );
+   db1.create<asset_bitasset_data_object>( [&]( asset_bitasset_data_object& o ) {
+      o.asset_id = usd_id;
+   });
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+
+   // a watermark set after a change stays valid only until the change is undone
+   {
+      auto session = db1._undo_db.start_undo_session();
+      create_order( asset( 10, usd_id ), asset( 10, core_id ) );
+      watermarks.set( watermark );
+      BOOST_CHECK( watermarks.can_skip( usd_id ) );
+      session.undo();
+   }
+   BOOST_CHECK( !watermarks.can_skip( usd_id ) );
+   {
+      auto session = db1._undo_db.start_undo_session();
+      watermarks.set( watermark );
+      create_order( asset( 10, usd_id ), asset( 40, core_id ) );
+      session.undo();
+   }
+   BOOST_CHECK( watermarks.can_skip( usd_id ) );
+
+   const auto stats = watermarks.get_stats();
+   BOOST_CHECK_EQUAL( 1u, stats.size );
+   BOOST_CHECK_EQUAL( 4u, stats.skipped );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( expiration_wheel_test )
+{ try {
+   database db1;
+   db1.initialize_indexes();
+   expiration_wheel wheel;
+   db1.add_secondary_indexer< primary_index<limit_order_index>, index_observer< limit_order_object, expiration_wheel,
+         member< limit_order_object, time_point_sec, &limit_order_object::expiration > > >( &wheel );
+
+   // a multiple of 64 seconds, so that the wheel cascades at start + 64
+   const time_point_sec start( 1000000 );
+
+   auto create_order = [&db1]( time_point_sec expiration ) -> const limit_order_object& {
+      return db1.create<limit_order_object>( [&]( limit_order_object& o ) {
+         o.expiration = expiration;
+         o.seller = account_id_type();
+         o.for_sale = 10;
+         o.sell_price = asset( 10 ) / asset( 20, asset_id_type( 1 ) );
+      });
+   };
+
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start ) );
+   const auto& first = create_order( start + 10 );
+   const auto& second = create_order( start + 70 );
+   const auto& far = create_order( start + 20000000 ); // beyond the wheel levels
+   create_order( time_point_sec::maximum() );
+   BOOST_CHECK_EQUAL( 3u, wheel.get_stats().size );
+
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 9 ) );
+   BOOST_CHECK( wheel.has_due<limit_order_object>( start + 10 ) );
+   BOOST_CHECK( !wheel.has_due<proposal_object>( start + 10 ) );
+   db1.remove( first );
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 10 ) );
+
+   // from level 1 to level 0 to due, one second at a time
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 60 ) );
+   BOOST_CHECK( wheel.has_due<limit_order_object>( start + 70 ) );
+   db1.modify( second, []( limit_order_object& o ) { o.expiration = time_point_sec::maximum(); } );
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 70 ) );
+   db1.modify( second, [start]( limit_order_object& o ) { o.expiration = start + 70; } );
+   BOOST_CHECK( wheel.has_due<limit_order_object>( start + 70 ) );
+   db1.remove( second );
+
+   // undone changes are undone in the wheel too
+   {
+      auto session = db1._undo_db.start_undo_session();
+      create_order( start + 80 );
+      db1.modify( far, [start]( limit_order_object& o ) { o.expiration = start + 80; } );
+      BOOST_CHECK( wheel.has_due<limit_order_object>( start + 80 ) );
+      BOOST_CHECK_EQUAL( 2u, wheel.get_stats().due );
+      session.undo();
+   }
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 80 ) );
+
+   // a large step rebuilds the wheel
+   BOOST_CHECK( !wheel.has_due<limit_order_object>( start + 19999999 ) );
+   BOOST_CHECK( wheel.has_due<limit_order_object>( start + 20000000 ) );
+   // going back in time keeps what is due
+   BOOST_CHECK( wheel.has_due<limit_order_object>( start ) );
+
+   const auto stats = wheel.get_stats();
+   BOOST_CHECK_EQUAL( 1u, stats.size );
+   BOOST_CHECK_EQUAL( 1u, stats.due );
+   BOOST_CHECK_EQUAL( 6u, stats.sweeps );
+   BOOST_CHECK_EQUAL( 8u, stats.skipped_sweeps );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( lottery_schedule_test )
+{ try {
+   database db1;
+   db1.initialize_indexes();
+   lottery_schedule schedule;
+   db1.add_secondary_indexer< primary_index<asset_index, 13>,
+                              index_observer< asset_object, lottery_schedule > >( &schedule );
+   db1.add_secondary_indexer< primary_index<nft_metadata_index>,
+                              index_observer< nft_metadata_object, lottery_schedule > >( &schedule );
+   db1.add_secondary_indexer< primary_index<nft_index>, index_observer< nft_object, lottery_schedule > >( &schedule );
+
+   const time_point_sec start( 1000000 );
+
+   auto create_lottery = [&db1]( const string& symbol, time_point_sec end_date ) -> const asset_object& {
+      return db1.create<asset_object>( [&]( asset_object& a ) {
+         a.symbol = symbol;
+         lottery_asset_options options;
+         options.end_date = end_date;
+         options.ending_on_soldout = false;
+         options.is_active = true;
+         a.lottery_options = options;
+      });
+   };
+   auto create_nft_lottery = [&db1]( const string& name, time_point_sec end_date, bool ending_on_soldout,
+                                     share_type max_supply ) -> const nft_metadata_object& {
+      return db1.create<nft_metadata_object>( [&]( nft_metadata_object& md ) {
+         md.name = name;
+         md.symbol = name;
+         md.max_supply = max_supply;
+         nft_lottery_options options;
+         options.end_date = end_date;
+         options.ending_on_soldout = ending_on_soldout;
+         options.is_active = true;
+         md.lottery_data = nft_lottery_data( options, nft_lottery_balance_id_type() );
+      });
+   };
+   auto create_token = [&db1]( nft_metadata_id_type metadata ) -> const nft_object& {
+      return db1.create<nft_object>( [metadata]( nft_object& t ) {
+         t.nft_metadata_id = metadata;
+      });
+   };
+   auto deactivate = [&db1]( const nft_metadata_object& metadata ) {
+      db1.modify( metadata, []( nft_metadata_object& md ) {
+         md.lottery_data->lottery_options.is_active = false;
+      });
+   };
+
+   // asset lotteries end by date only
+   db1.create<asset_object>( []( asset_object& a ) { a.symbol = "CORE"; } );
+   const auto& first = create_lottery( "FIRST", start + 10 );
+   const auto& second = create_lottery( "SECOND", start + 20 );
+   create_lottery( "UNDATED", time_point_sec() );
+   BOOST_CHECK( !schedule.latest_ending_asset_lottery( start ).valid() );
+   BOOST_CHECK( *schedule.latest_ending_asset_lottery( start + 15 ) == first.get_id() );
+   BOOST_CHECK( *schedule.latest_ending_asset_lottery( start + 30 ) == second.get_id() );
+   db1.modify( second, []( asset_object& a ) { a.lottery_options->is_active = false; } );
+   BOOST_CHECK( *schedule.latest_ending_asset_lottery( start + 30 ) == first.get_id() );
+   {
+      auto session = db1._undo_db.start_undo_session();
+      db1.modify( first, [start]( asset_object& a ) { a.lottery_options->end_date = start + 40; } );
+      BOOST_CHECK( !schedule.latest_ending_asset_lottery( start + 30 ).valid() );
+      session.undo();
+   }
+   BOOST_CHECK( *schedule.latest_ending_asset_lottery( start + 30 ) == first.get_id() );
+
+   // NFT lotteries end by date or when sold out, those without a date come last
+   const auto& dated = create_nft_lottery( "DATED", start + 10, false, 100 );
+   const auto& undated = create_nft_lottery( "UNDATED", time_point_sec(), true, 2 );
+   const auto& late = create_nft_lottery( "LATE", start + 1000, true, 1 );
+   BOOST_CHECK( !schedule.latest_ending_nft_lottery( start ).valid() );
+   create_token( undated.get_id() );
+   BOOST_CHECK( !schedule.is_sold_out( undated.get_id() ) );
+   const auto& last_token = create_token( undated.get_id() );
+   BOOST_CHECK( schedule.is_sold_out( undated.get_id() ) );
+   BOOST_CHECK_EQUAL( 2u, schedule.get_token_supply( undated.get_id() ) );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start ) == undated.get_id() );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start + 10 ) == dated.get_id() );
+   create_token( late.get_id() );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start + 10 ) == late.get_id() );
+   {
+      auto session = db1._undo_db.start_undo_session();
+      db1.remove( last_token );
+      deactivate( late );
+      BOOST_CHECK( !schedule.latest_ending_nft_lottery( start ).valid() );
+      session.undo();
+   }
+   BOOST_CHECK( schedule.is_sold_out( undated.get_id() ) );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start ) == late.get_id() );
+   deactivate( late );
+   BOOST_CHECK( !schedule.is_sold_out( late.get_id() ) );
+   BOOST_CHECK_EQUAL( 1u, schedule.get_token_supply( late.get_id() ) );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start + 10 ) == dated.get_id() );
+   deactivate( dated );
+   BOOST_CHECK( *schedule.latest_ending_nft_lottery( start + 10 ) == undated.get_id() );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -477,4 +477,63 @@ BOOST_AUTO_TEST_CASE( create_vesting_balance_object_test )
 } FC_LOG_AND_RETHROW() }
 
 
+BOOST_AUTO_TEST_CASE( taker_fill_batching_test )
+{
+   try
+   {
+      ACTORS((issuer)(izzyregistrar)(izzyreferrer)(alice));
+      upgrade_to_lifetime_member(izzyregistrar);
+      upgrade_to_lifetime_member(izzyreferrer);
+
+      // bob's rewards are shared between registrar and referrer, carl's all go to the registrar
+      const account_id_type bob_id  = create_account("bob",  izzyregistrar, izzyreferrer, 20*GRAPHENE_1_PERCENT).id;
+      const account_id_type carl_id = create_account("carl", izzyregistrar, izzyregistrar, 20*GRAPHENE_1_PERCENT).id;
+      fund( issuer );
+      fund( alice );
+      fund( bob_id(db) );
+      fund( carl_id(db) );
+
+      price price(asset(1, asset_id_type(1)), asset(1));
+      const asset_id_type jcoin_id = create_user_issued_asset( "JCOIN", issuer, charge_market_fee, price, 2,
+                                                               10*GRAPHENE_1_PERCENT ).id;
+      update_asset( issuer_id, issuer_private_key, jcoin_id, 50*GRAPHENE_1_PERCENT );
+      issue_uia( alice_id, asset( 2100, jcoin_id ) );
+      issue_uia( bob_id, asset( 3, jcoin_id ) );
+
+      // the registrar gets a fee vesting balance before the sweep, the referrer only during it
+      create_sell_order( alice_id, asset( 100, jcoin_id ), asset( 10 ) );
+      BOOST_REQUIRE( create_sell_order( carl_id, asset( 10 ), asset( 100, jcoin_id ) ) == nullptr );
+      BOOST_REQUIRE_GT( get_market_fee_reward( izzyregistrar_id, jcoin_id ), 0 );
+      BOOST_REQUIRE_EQUAL( get_market_fee_reward( izzyreferrer_id, jcoin_id ), 0 );
+
+      // a partial fill leaves bob's ask with 2 JCOIN, which bob's sweep fills down to 1 JCOIN, so it is culled
+      const limit_order_id_type bob_ask_id = create_sell_order( bob_id, asset( 3, jcoin_id ), asset( 2 ) )->id;
+      BOOST_REQUIRE( create_sell_order( carl_id, asset( 1 ), asset( 1, jcoin_id ) ) == nullptr );
+      BOOST_REQUIRE_EQUAL( bob_ask_id(db).for_sale.value, 2 );
+      create_sell_order( alice_id, asset( 1000, jcoin_id ), asset( 100 ) );
+      create_sell_order( alice_id, asset( 1000, jcoin_id ), asset( 110 ) );
+      generate_block();
+
+      db.track_state_hash( 0 );
+      const fc::sha256 head_state = db.get_state_hash();
+      vector<fc::sha256> sweep_states;
+      for( bool batching : { false, true } )
+      {
+         db.enable_taker_fill_batching( batching );
+         BOOST_CHECK( create_sell_order( bob_id, asset( 211 ), asset( 211, jcoin_id ) ) == nullptr );
+         BOOST_CHECK( db.find( bob_ask_id ) == nullptr );
+         BOOST_CHECK_GT( get_market_fee_reward( izzyreferrer_id, jcoin_id ), 0 );
+         sweep_states.push_back( db.get_state_hash() );
+         // drops the sweep, it is in the pending state only
+         db.clear_pending();
+         BOOST_CHECK( db.get_state_hash() == head_state );
+      }
+      db.enable_taker_fill_batching( true );
+
+      BOOST_CHECK( sweep_states[0] != head_state );
+      BOOST_CHECK( sweep_states[0] == sweep_states[1] );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/mempool.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+namespace {
+   mempool_entry make_entry( uint32_t n, account_id_type payer, uint64_t fee_per_kb,
+                             fc::time_point_sec expiration = fc::time_point_sec::maximum() )
+   {
+      mempool_entry entry;
+      entry.id = fc::ripemd160::hash( std::to_string( n ) );
+      entry.fee_payer = payer;
+      entry.fee_per_kb = fee_per_kb;
+      entry.expiration = expiration;
+      entry.size = 100;
+      return entry;
+   }
+
+   vector<transaction_id_type> in_priority_order( const mempool& pool )
+   {
+      vector<transaction_id_type> result;
+      pool.for_each_by_priority( [&result]( const mempool_entry& entry ) { result.push_back( entry.id ); } );
+      return result;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(mempool_tests)
+
+BOOST_AUTO_TEST_CASE( ordering_and_eviction )
+{ try {
+   const account_id_type payer1( 11 ), payer2( 12 ), payer3( 13 ), payer4( 14 );
+   const mempool_entry a = make_entry( 1, payer1, 10 );
+   const mempool_entry b = make_entry( 2, payer2, 30 );
+   const mempool_entry c = make_entry( 3, payer1, 50 );
+   const mempool_entry d = make_entry( 4, payer3, 20 );
+
+   mempool pool;
+   for( const auto& entry : { a, b, c, d } )
+   {
+      BOOST_CHECK( pool.make_room( entry ).empty() );
+      pool.insert( entry );
+   }
+   BOOST_CHECK_EQUAL( pool.size(), 4u );
+   BOOST_CHECK_EQUAL( pool.total_bytes(), 400u );
+
+   vector<transaction_id_type> arrival;
+   pool.for_each( [&arrival]( const mempool_entry& entry ) { arrival.push_back( entry.id ); } );
+   BOOST_CHECK( arrival == vector<transaction_id_type>( { a.id, b.id, c.id, d.id } ) );
+   // c pays the most, but comes after a of the same payer
+   BOOST_CHECK( in_priority_order( pool ) == vector<transaction_id_type>( { b.id, d.id, a.id, c.id } ) );
+
+   pool.set_limits( 400, 2 );
+   // the transaction paying the least per kilobyte makes room
+   const auto evicted = pool.make_room( make_entry( 5, payer4, 25 ) );
+   BOOST_CHECK( evicted == vector<transaction_id_type>( { a.id } ) );
+   // nothing pays less than this one
+   BOOST_CHECK_THROW( pool.make_room( make_entry( 6, payer4, 5 ) ), fc::exception );
+   // payer1 has two transactions already
+   BOOST_CHECK_THROW( pool.make_room( make_entry( 7, payer1, 100 ) ), fc::exception );
+
+   BOOST_CHECK( pool.remove( a.id ) );
+   BOOST_CHECK( !pool.remove( a.id ) );
+   BOOST_CHECK( pool.find( a.id ) == nullptr );
+   BOOST_REQUIRE( pool.find( c.id ) != nullptr );
+   BOOST_CHECK( pool.find( c.id )->fee_payer == payer1 );
+   BOOST_CHECK_EQUAL( pool.total_bytes(), 300u );
+   BOOST_CHECK( in_priority_order( pool ) == vector<transaction_id_type>( { c.id, b.id, d.id } ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( expiration )
+{ try {
+   const fc::time_point_sec now( 1000000 );
+   mempool pool;
+   pool.insert( make_entry( 1, account_id_type( 11 ), 0, now - 1 ) );
+   pool.insert( make_entry( 2, account_id_type( 11 ), 0, now ) );
+   pool.insert( make_entry( 3, account_id_type( 12 ), 0, now - 10 ) );
+   pool.insert( make_entry( 4, account_id_type( 12 ), 0, now + 10 ) );
+
+   BOOST_CHECK_EQUAL( pool.remove_expired( now ), 2u );
+   BOOST_CHECK_EQUAL( pool.size(), 2u );
+   BOOST_CHECK_EQUAL( pool.total_bytes(), 200u );
+   BOOST_CHECK( pool.find( fc::ripemd160::hash( std::to_string( 2 ) ) ) != nullptr );
+   BOOST_CHECK_EQUAL( pool.remove_expired( now ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( pending_transaction_limits, database_fixture )
+{ try {
+   ACTORS( (alice)(bob) );
+   transfer( committee_account, alice_id, asset( 100000 ) );
+   generate_block();
+
+   db.set_mempool_limits( 0, 2 );
+   transfer( alice_id, bob_id, asset( 1 ) );
+   transfer( alice_id, bob_id, asset( 2 ) );
+   BOOST_CHECK_THROW( transfer( alice_id, bob_id, asset( 3 ) ), fc::exception );
+   transfer( committee_account, bob_id, asset( 1 ) );
+   BOOST_CHECK_EQUAL( db.get_pending_transactions().size(), 3u );
+
+   const signed_block block = generate_block();
+   BOOST_CHECK_EQUAL( block.transactions.size(), 3u );
+   // the transactions included in the block leave the mempool
+   BOOST_CHECK( db.get_pending_transactions().empty() );
+   BOOST_CHECK_EQUAL( get_balance( bob_id, asset_id_type() ), 4 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()